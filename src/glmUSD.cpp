@@ -7,6 +7,7 @@
 #include "glmUSD.h"
 #include "glmUSDLogger.h"
 #include "glmUSDPluginProductInformation.h"
+#include "glmUSDLockStats.h"
 
 #include <glmCore.h>
 #include <glmStringOperators.h>
@@ -24,13 +25,13 @@ namespace glm
 {
     namespace usdplugin
     {
-        static glm::Mutex s_initLock;
+        static ProfiledMutex s_initLock(LockStats::INIT);
         static int s_initCount = 0;
 
         //-----------------------------------------------------------------------------
         int init()
         {
-            glm::ScopedLock<glm::Mutex> lock(s_initLock);
+            glm::ScopedLock<ProfiledMutex> lock(s_initLock);
             if (s_initCount == 0)
             {
                 printf("%s\n", usdplugin::getProductInformation().getCString());
@@ -52,7 +53,7 @@ namespace glm
         //-------------------------------------------------------------------------
         void finish()
         {
-            glm::ScopedLock<glm::Mutex> lock(s_initLock);
+            glm::ScopedLock<ProfiledMutex> lock(s_initLock);
             --s_initCount;
             if (s_initCount == 0)
             {
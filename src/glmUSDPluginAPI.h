@@ -10,3 +10,71 @@
 #else
 #define GLM_USDPLUGIN_API __attribute__((visibility("default")))
 #endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        /**
+        * \brief Estimated memory used by a Golaem USD layer, in bytes.
+        *
+        * Arrays shared between frames or layers are counted by each user. The simulation frame data is owned by the
+        * Golaem SDK, only the frames currently used by the entities of the layer are counted.
+        *
+        * Plain data with fixed size buffers, so that it can be passed across the plugin boundary whatever the runtime
+        * library of the caller. Strings are truncated to the buffer size and always null terminated.
+        */
+        struct LayerMemoryUsage
+        {
+            static const uint32_t VERSION = 1;
+            static const size_t MAX_SKIN_MESH_TEMPLATES = 64;
+
+            struct SkinMeshTemplates
+            {
+                int32_t characterIdx;
+                int32_t geometryFileIdx; // LOD level
+                char characterFile[512];
+                uint64_t meshCount;
+                uint64_t bytes;
+            };
+
+            uint32_t version; // VERSION of the plugin filling the struct
+
+            char proceduralFile[1024];
+            char cacheName[256];
+            char crowdFields[1024];
+
+            uint64_t specIndex;       // prim spec paths, child names and time sample times
+            uint64_t entityTables;    // entity, skel animation and mesh lookup tables
+            uint64_t attributeTables; // shader and pp attribute indices, joints and material tables
+            uint64_t skinMeshTemplates;
+            uint64_t frameCache;          // computed entity frames, including compressed frames
+            uint64_t simulationFrameData; // simulation frames owned by the SDK
+
+            // per character and LOD, only the first MAX_SKIN_MESH_TEMPLATES are filled but skinMeshTemplates counts all
+            uint32_t skinMeshTemplatesCount;
+            SkinMeshTemplates skinMeshTemplatesPerCharacterAndLod[MAX_SKIN_MESH_TEMPLATES];
+
+            uint64_t getTotal() const
+            {
+                return specIndex + entityTables + attributeTables + skinMeshTemplates + frameCache + simulationFrameData;
+            }
+        };
+
+        /// Fills the memory usage of the Golaem USD layers currently loaded, up to capacity layers.
+        /// Returns the number of loaded layers, call it with a capacity of 0 to get the count only.
+        extern GLM_USDPLUGIN_API size_t getLayerMemoryUsages(LayerMemoryUsage* memoryUsages, size_t capacity);
+
+        /// Writes a human readable report of a layer memory usage, as logged by the GOLAEMUSD_MEMORY debug code, to
+        /// buffer. The report is truncated to bufferSize - 1 characters and null terminated, returns its full length.
+        extern GLM_USDPLUGIN_API size_t formatLayerMemoryUsage(const LayerMemoryUsage& memoryUsage, char* buffer, size_t bufferSize);
+    } // namespace usdplugin
+} // namespace glm
+
+/// Prints the memory usage report of every Golaem USD layer currently loaded to the standard output, whether the
+/// GOLAEMUSD_MEMORY debug code is enabled or not. Unmangled so it can be called on demand from a debugger or python
+/// (ctypes) in a running session.
+extern "C" GLM_USDPLUGIN_API void glmUsdDumpLayerMemoryUsages();
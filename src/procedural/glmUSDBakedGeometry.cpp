@@ -0,0 +1,463 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDBakedGeometry.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmLog.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifndef _MSC_VER
+#include <sys/stat.h>
+#endif
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        const char* BAKED_GEOMETRY_FILE_EXTENSION = ".glmusdgeo";
+
+        static const char BAKED_GEOMETRY_MAGIC[8] = {'G', 'L', 'M', 'U', 'S', 'D', 'G', 'E'};
+        static const uint32_t BAKED_GEOMETRY_VERSION = 1;
+        static const size_t BAKED_GEOMETRY_ALIGNMENT = 16;
+
+        static_assert(sizeof(BakedGeometryHeader) == 56, "unexpected baked geometry header size");
+        static_assert(sizeof(BakedEntityFrameRecord) == 32, "unexpected baked entity frame record size");
+        static_assert(sizeof(BakedMeshRecord) == 56, "unexpected baked mesh record size");
+
+        //-----------------------------------------------------------------------------
+        inline size_t alignSize(size_t size, size_t alignment)
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        //-----------------------------------------------------------------------------
+        // true if count elements at offset fit in the file, written so that corrupt values cannot overflow the check
+        inline bool isInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+        {
+            return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+        }
+
+        //-----------------------------------------------------------------------------
+        inline size_t getDataStart()
+        {
+            return alignSize(sizeof(BakedGeometryHeader), BAKED_GEOMETRY_ALIGNMENT);
+        }
+
+        //-----------------------------------------------------------------------------
+        inline bool operator<(const BakedEntityFrameRecord& record, const BakedEntityFrameRecord& otherRecord)
+        {
+            return record.entityId < otherRecord.entityId || (record.entityId == otherRecord.entityId && record.frame < otherRecord.frame);
+        }
+
+        //-----------------------------------------------------------------------------
+        BakedGeometryWriter::BakedGeometryWriter(uint64_t paramsHash, bool halfNormals)
+        {
+            memset(&_header, 0, sizeof(_header));
+            memcpy(_header.magic, BAKED_GEOMETRY_MAGIC, sizeof(_header.magic));
+            _header.version = BAKED_GEOMETRY_VERSION;
+            _header.flags = halfNormals ? BakedGeometryFlags::HALF_NORMALS : 0;
+            _header.paramsHash = paramsHash;
+        }
+
+        //-----------------------------------------------------------------------------
+        void BakedGeometryWriter::addEntityFrame(int64_t entityId, int frame, uint32_t geometryFileIdx)
+        {
+            BakedEntityFrameRecord entityFrame;
+            memset(&entityFrame, 0, sizeof(entityFrame));
+            entityFrame.entityId = entityId;
+            entityFrame.frame = frame;
+            entityFrame.geometryFileIdx = geometryFileIdx;
+            entityFrame.firstMesh = _meshes.size();
+            _entityFrames.push_back(entityFrame);
+        }
+
+        //-----------------------------------------------------------------------------
+        void BakedGeometryWriter::addMesh(int gchaMeshId, int meshMaterialIndex, const VtVec3fArray& points, const VtVec3fArray& normals, const VtVec3fArray& extent)
+        {
+            BakedMeshRecord& mesh = _addMeshRecord(gchaMeshId, meshMaterialIndex, points, extent);
+            mesh.normalsOffset = _appendData(normals.cdata(), normals.size() * sizeof(GfVec3f));
+            mesh.normalCount = static_cast<uint32_t>(normals.size());
+        }
+
+        //-----------------------------------------------------------------------------
+        void BakedGeometryWriter::addMesh(int gchaMeshId, int meshMaterialIndex, const VtVec3fArray& points, const VtVec3hArray& normals, const VtVec3fArray& extent)
+        {
+            BakedMeshRecord& mesh = _addMeshRecord(gchaMeshId, meshMaterialIndex, points, extent);
+            mesh.normalsOffset = _appendData(normals.cdata(), normals.size() * sizeof(GfVec3h));
+            mesh.normalCount = static_cast<uint32_t>(normals.size());
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t BakedGeometryWriter::getEntityFrameCount() const
+        {
+            return _entityFrames.size();
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t BakedGeometryWriter::getDataSize() const
+        {
+            return _data.size() + _meshes.size() * sizeof(BakedMeshRecord) + _entityFrames.size() * sizeof(BakedEntityFrameRecord);
+        }
+
+        //-----------------------------------------------------------------------------
+        BakedMeshRecord& BakedGeometryWriter::_addMeshRecord(int gchaMeshId, int meshMaterialIndex, const VtVec3fArray& points, const VtVec3fArray& extent)
+        {
+            GLM_DEBUG_ASSERT(!_entityFrames.empty());
+            ++_entityFrames.back().meshCount;
+
+            _meshes.push_back(BakedMeshRecord());
+            BakedMeshRecord& mesh = _meshes.back();
+            memset(&mesh, 0, sizeof(mesh));
+            mesh.gchaMeshId = gchaMeshId;
+            mesh.meshMaterialIndex = meshMaterialIndex;
+            mesh.pointsOffset = _appendData(points.cdata(), points.size() * sizeof(GfVec3f));
+            mesh.pointCount = static_cast<uint32_t>(points.size());
+            if (extent.size() == 2)
+            {
+                memcpy(mesh.extent, extent.cdata(), sizeof(mesh.extent));
+            }
+            return mesh;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t BakedGeometryWriter::_appendData(const void* data, size_t size)
+        {
+            size_t offset = alignSize(_data.size(), BAKED_GEOMETRY_ALIGNMENT);
+            _data.resize(offset + size);
+            if (size > 0)
+            {
+                memcpy(&_data[offset], data, size);
+            }
+            return getDataStart() + offset;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool BakedGeometryWriter::write(const std::string& filePath, std::string& errorMessage) const
+        {
+            std::vector<BakedEntityFrameRecord> sortedEntityFrames = _entityFrames;
+            std::sort(sortedEntityFrames.begin(), sortedEntityFrames.end());
+
+            BakedGeometryHeader header = _header;
+            header.meshCount = _meshes.size();
+            header.meshesOffset = alignSize(getDataStart() + _data.size(), BAKED_GEOMETRY_ALIGNMENT);
+            header.entityFrameCount = sortedEntityFrames.size();
+            header.entityFramesOffset = header.meshesOffset + _meshes.size() * sizeof(BakedMeshRecord);
+
+            std::string tmpFilePath;
+            int tmpFileDescriptor = ArchMakeTmpFile(TfGetPathName(filePath), TfGetBaseName(filePath), &tmpFilePath);
+            if (tmpFileDescriptor < 0)
+            {
+                errorMessage = "Could not create a temporary file next to '" + filePath + "'";
+                return false;
+            }
+#ifndef _MSC_VER
+            // temporary files are only readable by their owner, baked files can be shared by several users
+            fchmod(tmpFileDescriptor, 0644);
+#endif
+            ArchCloseFile(tmpFileDescriptor);
+
+            {
+                std::ofstream outStream(tmpFilePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+                const char padding[BAKED_GEOMETRY_ALIGNMENT] = {0};
+                outStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                outStream.write(padding, getDataStart() - sizeof(header));
+                if (!_data.empty())
+                {
+                    outStream.write(_data.data(), _data.size());
+                }
+                outStream.write(padding, header.meshesOffset - getDataStart() - _data.size());
+                if (!_meshes.empty())
+                {
+                    outStream.write(reinterpret_cast<const char*>(_meshes.data()), _meshes.size() * sizeof(BakedMeshRecord));
+                }
+                if (!sortedEntityFrames.empty())
+                {
+                    outStream.write(reinterpret_cast<const char*>(sortedEntityFrames.data()), sortedEntityFrames.size() * sizeof(BakedEntityFrameRecord));
+                }
+                if (!outStream.good())
+                {
+                    errorMessage = "Could not write '" + tmpFilePath + "'";
+                    outStream.close();
+                    ArchUnlinkFile(tmpFilePath.c_str());
+                    return false;
+                }
+            }
+
+            if (std::rename(tmpFilePath.c_str(), filePath.c_str()) != 0)
+            {
+                // rename does not replace existing files on Windows
+                ArchUnlinkFile(filePath.c_str());
+                if (std::rename(tmpFilePath.c_str(), filePath.c_str()) != 0)
+                {
+                    errorMessage = "Could not rename '" + tmpFilePath + "' to '" + filePath + "'";
+                    ArchUnlinkFile(tmpFilePath.c_str());
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        BakedGeometryFile::BakedGeometryFile(const std::string& filePath, ArchConstFileMapping&& mapping)
+            : Vt_ArrayForeignDataSource(&BakedGeometryFile::_detached)
+            , _filePath(filePath)
+            , _mapping(std::move(mapping))
+        {
+            const char* fileData = _mapping.get();
+            _header = reinterpret_cast<const BakedGeometryHeader*>(fileData);
+            _entityFrames = reinterpret_cast<const BakedEntityFrameRecord*>(fileData + _header->entityFramesOffset);
+            _meshes = reinterpret_cast<const BakedMeshRecord*>(fileData + _header->meshesOffset);
+            _data = fileData;
+            // the mapping is read only, VtArray copies foreign data before any modification
+            _keepAlive = VtArray<char>(this, const_cast<char*>(fileData), ArchGetFileMappingLength(_mapping));
+        }
+
+        //-----------------------------------------------------------------------------
+        BakedGeometryFile* BakedGeometryFile::open(const std::string& filePath, std::string& errorMessage)
+        {
+            ArchConstFileMapping mapping = ArchMapFileReadOnly(filePath, &errorMessage);
+            if (!mapping)
+            {
+                return nullptr;
+            }
+
+            size_t fileSize = ArchGetFileMappingLength(mapping);
+            const char* fileData = mapping.get();
+            if (fileSize < sizeof(BakedGeometryHeader))
+            {
+                errorMessage = "file is too small";
+                return nullptr;
+            }
+            const BakedGeometryHeader* header = reinterpret_cast<const BakedGeometryHeader*>(fileData);
+            if (memcmp(header->magic, BAKED_GEOMETRY_MAGIC, sizeof(header->magic)) != 0 || header->version != BAKED_GEOMETRY_VERSION)
+            {
+                errorMessage = "not a baked geometry file or unsupported version";
+                return nullptr;
+            }
+            if (!isInFile(header->meshesOffset, header->meshCount, sizeof(BakedMeshRecord), fileSize) ||
+                !isInFile(header->entityFramesOffset, header->entityFrameCount, sizeof(BakedEntityFrameRecord), fileSize))
+            {
+                errorMessage = "file is truncated";
+                return nullptr;
+            }
+
+            // check the mesh arrays once, so lookups do not need to
+            size_t normalSize = (header->flags & BakedGeometryFlags::HALF_NORMALS) ? sizeof(GfVec3h) : sizeof(GfVec3f);
+            const BakedMeshRecord* meshes = reinterpret_cast<const BakedMeshRecord*>(fileData + header->meshesOffset);
+            for (uint64_t iMesh = 0; iMesh < header->meshCount; ++iMesh)
+            {
+                const BakedMeshRecord& mesh = meshes[iMesh];
+                if (!isInFile(mesh.pointsOffset, mesh.pointCount, sizeof(GfVec3f), fileSize) || !isInFile(mesh.normalsOffset, mesh.normalCount, normalSize, fileSize))
+                {
+                    errorMessage = "mesh data is out of the file bounds";
+                    return nullptr;
+                }
+            }
+            const BakedEntityFrameRecord* entityFrames = reinterpret_cast<const BakedEntityFrameRecord*>(fileData + header->entityFramesOffset);
+            for (uint64_t iEntityFrame = 0; iEntityFrame < header->entityFrameCount; ++iEntityFrame)
+            {
+                const BakedEntityFrameRecord& entityFrame = entityFrames[iEntityFrame];
+                if (entityFrame.firstMesh > header->meshCount || entityFrame.meshCount > header->meshCount - entityFrame.firstMesh)
+                {
+                    errorMessage = "entity frame meshes are out of bounds";
+                    return nullptr;
+                }
+            }
+
+            return new BakedGeometryFile(filePath, std::move(mapping));
+        }
+
+        //-----------------------------------------------------------------------------
+        void BakedGeometryFile::release()
+        {
+            // this may delete the file if no other array uses it
+            _keepAlive = VtArray<char>();
+        }
+
+        //-----------------------------------------------------------------------------
+        VtArray<char> BakedGeometryFile::getKeepAlive() const
+        {
+            return _keepAlive;
+        }
+
+        //-----------------------------------------------------------------------------
+        void BakedGeometryFile::_detached(Vt_ArrayForeignDataSource* self)
+        {
+            delete static_cast<BakedGeometryFile*>(self);
+        }
+
+        //-----------------------------------------------------------------------------
+        const BakedGeometryHeader& BakedGeometryFile::getHeader() const
+        {
+            return *_header;
+        }
+
+        //-----------------------------------------------------------------------------
+        const std::string& BakedGeometryFile::getFilePath() const
+        {
+            return _filePath;
+        }
+
+        //-----------------------------------------------------------------------------
+        const BakedEntityFrameRecord* BakedGeometryFile::findEntityFrame(int64_t entityId, int frame) const
+        {
+            BakedEntityFrameRecord key;
+            key.entityId = entityId;
+            key.frame = frame;
+            const BakedEntityFrameRecord* entityFramesEnd = _entityFrames + _header->entityFrameCount;
+            const BakedEntityFrameRecord* entityFrame = std::lower_bound(_entityFrames, entityFramesEnd, key);
+            if (entityFrame != entityFramesEnd && entityFrame->entityId == entityId && entityFrame->frame == frame)
+            {
+                return entityFrame;
+            }
+            return nullptr;
+        }
+
+        //-----------------------------------------------------------------------------
+        const BakedMeshRecord* BakedGeometryFile::getMeshes(const BakedEntityFrameRecord& entityFrame) const
+        {
+            return _meshes + entityFrame.firstMesh;
+        }
+
+        //-----------------------------------------------------------------------------
+        template <typename T>
+        VtArray<T> BakedGeometryFile::_getArray(uint64_t offset, uint32_t count)
+        {
+            if (count == 0)
+            {
+                return VtArray<T>();
+            }
+            T* arrayData = reinterpret_cast<T*>(const_cast<char*>(_data + offset));
+            return VtArray<T>(this, arrayData, count);
+        }
+
+        //-----------------------------------------------------------------------------
+        VtVec3fArray BakedGeometryFile::getPoints(const BakedMeshRecord& mesh)
+        {
+            return _getArray<GfVec3f>(mesh.pointsOffset, mesh.pointCount);
+        }
+
+        //-----------------------------------------------------------------------------
+        VtVec3fArray BakedGeometryFile::getNormals(const BakedMeshRecord& mesh)
+        {
+            if (_header->flags & BakedGeometryFlags::HALF_NORMALS)
+            {
+                VtVec3hArray halfNormals = getHalfNormals(mesh);
+                VtVec3fArray normals(halfNormals.size());
+                std::transform(halfNormals.cbegin(), halfNormals.cend(), normals.begin(), [](const GfVec3h& normal) { return GfVec3f(normal); });
+                return normals;
+            }
+            return _getArray<GfVec3f>(mesh.normalsOffset, mesh.normalCount);
+        }
+
+        //-----------------------------------------------------------------------------
+        VtVec3hArray BakedGeometryFile::getHalfNormals(const BakedMeshRecord& mesh)
+        {
+            if (!(_header->flags & BakedGeometryFlags::HALF_NORMALS))
+            {
+                VtVec3fArray normals = getNormals(mesh);
+                VtVec3hArray halfNormals(normals.size());
+                std::transform(normals.cbegin(), normals.cend(), halfNormals.begin(), [](const GfVec3f& normal) { return GfVec3h(normal); });
+                return halfNormals;
+            }
+            return _getArray<GfVec3h>(mesh.normalsOffset, mesh.normalCount);
+        }
+
+        //-----------------------------------------------------------------------------
+        BakedGeometryReader::~BakedGeometryReader()
+        {
+            close();
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t BakedGeometryReader::open(const std::vector<std::string>& paths, uint64_t paramsHash)
+        {
+            close();
+
+            std::vector<std::string> filePaths;
+            for (const std::string& path : paths)
+            {
+                if (TfIsDir(path))
+                {
+                    std::vector<std::string> dirNames;
+                    std::vector<std::string> fileNames;
+                    TfReadDir(path, &dirNames, &fileNames, nullptr);
+                    std::sort(fileNames.begin(), fileNames.end());
+                    for (const std::string& fileName : fileNames)
+                    {
+                        if (TfStringEndsWith(fileName, BAKED_GEOMETRY_FILE_EXTENSION))
+                        {
+                            filePaths.push_back(TfStringCatPaths(path, fileName));
+                        }
+                    }
+                }
+                else if (!path.empty())
+                {
+                    filePaths.push_back(path);
+                }
+            }
+
+            for (const std::string& filePath : filePaths)
+            {
+                std::string errorMessage;
+                BakedGeometryFile* file = BakedGeometryFile::open(filePath, errorMessage);
+                if (file == nullptr)
+                {
+                    GLM_CROWD_TRACE_WARNING("Could not open baked geometry file '" << filePath << "': " << errorMessage);
+                    continue;
+                }
+                if (file->getHeader().paramsHash != paramsHash)
+                {
+                    GLM_CROWD_TRACE_WARNING("Baked geometry file '" << filePath << "' was baked with different parameters, it will be ignored");
+                    file->release();
+                    continue;
+                }
+                _files.push_back(file);
+            }
+            return _files.size();
+        }
+
+        //-----------------------------------------------------------------------------
+        void BakedGeometryReader::close()
+        {
+            for (BakedGeometryFile* file : _files)
+            {
+                file->release();
+            }
+            _files.clear();
+        }
+
+        //-----------------------------------------------------------------------------
+        bool BakedGeometryReader::empty() const
+        {
+            return _files.empty();
+        }
+
+        //-----------------------------------------------------------------------------
+        const BakedEntityFrameRecord* BakedGeometryReader::findEntityFrame(int64_t entityId, int frame, BakedGeometryFile*& file) const
+        {
+            for (BakedGeometryFile* bakedFile : _files)
+            {
+                if (const BakedEntityFrameRecord* entityFrame = bakedFile->findEntityFrame(entityId, frame))
+                {
+                    file = bakedFile;
+                    return entityFrame;
+                }
+            }
+            return nullptr;
+        }
+    } // namespace usdplugin
+} // namespace glm
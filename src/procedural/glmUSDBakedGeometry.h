@@ -0,0 +1,155 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/arch/fileSystem.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+USD_INCLUDES_END
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        // Baked geometry files (.glmusdgeo) store the deformed meshes of entities for some frames.
+        // Layout: header, mesh arrays, mesh records, entity frame records sorted by entity id and frame.
+        // Arrays are aligned so that they can be used directly from a memory mapping.
+        struct BakedGeometryHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t flags;
+            uint64_t paramsHash; // hash of the layer params used to bake the geometry
+            uint64_t entityFrameCount;
+            uint64_t entityFramesOffset;
+            uint64_t meshCount;
+            uint64_t meshesOffset;
+        };
+
+        struct BakedEntityFrameRecord
+        {
+            int64_t entityId;
+            int32_t frame;
+            uint32_t geometryFileIdx;
+            uint64_t firstMesh;
+            uint32_t meshCount;
+            uint32_t reserved;
+        };
+
+        struct BakedMeshRecord
+        {
+            int32_t gchaMeshId;
+            int32_t meshMaterialIndex;
+            uint64_t pointsOffset;
+            uint64_t normalsOffset;
+            uint32_t pointCount;
+            uint32_t normalCount;
+            float extent[6]; // min, max
+        };
+
+        struct BakedGeometryFlags
+        {
+            enum Value
+            {
+                HALF_NORMALS = 1 << 0, // normals are stored as GfVec3h
+            };
+        };
+
+        // Accumulates baked meshes in memory and writes them to a file
+        class BakedGeometryWriter
+        {
+        public:
+            BakedGeometryWriter(uint64_t paramsHash, bool halfNormals);
+
+            // meshes added after an entity frame belong to it
+            void addEntityFrame(int64_t entityId, int frame, uint32_t geometryFileIdx);
+            void addMesh(int gchaMeshId, int meshMaterialIndex, const VtVec3fArray& points, const VtVec3fArray& normals, const VtVec3fArray& extent);
+            void addMesh(int gchaMeshId, int meshMaterialIndex, const VtVec3fArray& points, const VtVec3hArray& normals, const VtVec3fArray& extent);
+
+            size_t getEntityFrameCount() const;
+            size_t getDataSize() const;
+
+            // the file is written next to its destination then renamed, so readers never see a partial file
+            bool write(const std::string& filePath, std::string& errorMessage) const;
+
+        protected:
+            uint64_t _appendData(const void* data, size_t size);
+            BakedMeshRecord& _addMeshRecord(int gchaMeshId, int meshMaterialIndex, const VtVec3fArray& points, const VtVec3fArray& extent);
+
+            BakedGeometryHeader _header;
+            std::vector<BakedEntityFrameRecord> _entityFrames;
+            std::vector<BakedMeshRecord> _meshes;
+            std::vector<char> _data; // mesh arrays, written right after the header
+        };
+
+        // A memory mapped baked geometry file, arrays returned by this file point directly to the mapping.
+        // The file is deleted when it is released and no array uses it anymore.
+        class BakedGeometryFile : public Vt_ArrayForeignDataSource
+        {
+        public:
+            static BakedGeometryFile* open(const std::string& filePath, std::string& errorMessage);
+            void release();
+            // keeps the file alive while the returned array is held, even if it is released meanwhile
+            VtArray<char> getKeepAlive() const;
+
+            const BakedGeometryHeader& getHeader() const;
+            const BakedEntityFrameRecord* findEntityFrame(int64_t entityId, int frame) const;
+            const BakedMeshRecord* getMeshes(const BakedEntityFrameRecord& entityFrame) const;
+            const std::string& getFilePath() const;
+
+            VtVec3fArray getPoints(const BakedMeshRecord& mesh);
+            VtVec3fArray getNormals(const BakedMeshRecord& mesh);
+            VtVec3hArray getHalfNormals(const BakedMeshRecord& mesh);
+
+        protected:
+            BakedGeometryFile(const std::string& filePath, ArchConstFileMapping&& mapping);
+            static void _detached(Vt_ArrayForeignDataSource* self);
+
+            template <typename T>
+            VtArray<T> _getArray(uint64_t offset, uint32_t count);
+
+            std::string _filePath;
+            ArchConstFileMapping _mapping;
+            VtArray<char> _keepAlive; // keeps the file alive until release is called
+            const BakedGeometryHeader* _header = nullptr;
+            const BakedEntityFrameRecord* _entityFrames = nullptr;
+            const BakedMeshRecord* _meshes = nullptr;
+            const char* _data = nullptr;
+        };
+
+        // Looks up baked meshes in a set of baked geometry files
+        class BakedGeometryReader
+        {
+        public:
+            ~BakedGeometryReader();
+
+            // paths can be files or directories containing .glmusdgeo files, returns the number of files opened
+            size_t open(const std::vector<std::string>& paths, uint64_t paramsHash);
+            void close();
+            bool empty() const;
+
+            const BakedEntityFrameRecord* findEntityFrame(int64_t entityId, int frame, BakedGeometryFile*& file) const;
+
+        protected:
+            std::vector<BakedGeometryFile*> _files;
+        };
+
+        extern const char* BAKED_GEOMETRY_FILE_EXTENSION;
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,146 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDCompressedArrays.h"
+
+#include <cstring>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        // number of bytes needed to store a word, high zero bytes are dropped
+        template <typename Word>
+        inline uint8_t getKeptByteCount(Word word)
+        {
+            uint8_t byteCount = 0;
+            while (word != 0)
+            {
+                ++byteCount;
+                word = static_cast<Word>(word >> 8);
+            }
+            return byteCount;
+        }
+
+        //-----------------------------------------------------------------------------
+        template <typename Word>
+        void encodeWords(const Word* words, size_t wordCount, std::vector<uint8_t>& byteCounts, std::vector<uint8_t>& bytes)
+        {
+            byteCounts.assign((wordCount + 1) / 2, 0);
+            bytes.clear();
+            bytes.reserve(wordCount * sizeof(Word) / 2);
+            for (size_t iWord = 0; iWord < wordCount; ++iWord)
+            {
+                // predicted by the same component of the previous vector
+                Word xoredWord = iWord < 3 ? words[iWord] : static_cast<Word>(words[iWord] ^ words[iWord - 3]);
+                uint8_t byteCount = getKeptByteCount(xoredWord);
+                byteCounts[iWord / 2] |= static_cast<uint8_t>(byteCount << ((iWord % 2) * 4));
+                for (uint8_t iByte = 0; iByte < byteCount; ++iByte)
+                {
+                    bytes.push_back(static_cast<uint8_t>(xoredWord >> (iByte * 8)));
+                }
+            }
+            // the decompression reads whole words
+            bytes.resize(bytes.size() + sizeof(Word) - 1, 0);
+            bytes.shrink_to_fit();
+        }
+
+        //-----------------------------------------------------------------------------
+        template <typename Word>
+        void decodeWords(const std::vector<uint8_t>& byteCounts, const std::vector<uint8_t>& bytes, size_t wordCount, Word* words)
+        {
+            // each word is read whole and masked to its kept bytes, without a loop over its bytes (little endian only)
+            static const uint32_t KEPT_BYTES_MASKS[5] = {0, 0xFF, 0xFFFF, 0xFFFFFF, 0xFFFFFFFF};
+            const uint8_t* srcBytes = bytes.data();
+            for (size_t iWord = 0; iWord < wordCount; ++iWord)
+            {
+                uint8_t byteCount = (byteCounts[iWord / 2] >> ((iWord % 2) * 4)) & 0xF;
+                Word xoredWord;
+                memcpy(&xoredWord, srcBytes, sizeof(Word));
+                words[iWord] = static_cast<Word>(xoredWord & KEPT_BYTES_MASKS[byteCount]);
+                srcBytes += byteCount;
+            }
+            // the prediction is undone in a separate pass, a single xor per word
+            for (size_t iWord = 3; iWord < wordCount; ++iWord)
+            {
+                words[iWord] = static_cast<Word>(words[iWord] ^ words[iWord - 3]);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void CompressedVec3Array::compress(const VtVec3fArray& values)
+        {
+            _vectorCount = values.size();
+            std::vector<uint32_t> words(_vectorCount * 3);
+            if (_vectorCount > 0)
+            {
+                memcpy(words.data(), values.cdata(), words.size() * sizeof(uint32_t));
+            }
+            encodeWords(words.data(), words.size(), _byteCounts, _bytes);
+        }
+
+        //-----------------------------------------------------------------------------
+        void CompressedVec3Array::compress(const VtVec3hArray& values)
+        {
+            _vectorCount = values.size();
+            std::vector<uint16_t> words(_vectorCount * 3);
+            if (_vectorCount > 0)
+            {
+                memcpy(words.data(), values.cdata(), words.size() * sizeof(uint16_t));
+            }
+            encodeWords(words.data(), words.size(), _byteCounts, _bytes);
+        }
+
+        //-----------------------------------------------------------------------------
+        void CompressedVec3Array::decompress(VtVec3fArray& values) const
+        {
+            values.resize(_vectorCount);
+            if (_vectorCount == 0)
+            {
+                return;
+            }
+            std::vector<uint32_t> words(_vectorCount * 3);
+            decodeWords(_byteCounts, _bytes, words.size(), words.data());
+            memcpy(values.data(), words.data(), words.size() * sizeof(uint32_t));
+        }
+
+        //-----------------------------------------------------------------------------
+        void CompressedVec3Array::decompress(VtVec3hArray& values) const
+        {
+            values.resize(_vectorCount);
+            if (_vectorCount == 0)
+            {
+                return;
+            }
+            std::vector<uint16_t> words(_vectorCount * 3);
+            decodeWords(_byteCounts, _bytes, words.size(), words.data());
+            memcpy(values.data(), words.data(), words.size() * sizeof(uint16_t));
+        }
+
+        //-----------------------------------------------------------------------------
+        void CompressedVec3Array::clear()
+        {
+            _vectorCount = 0;
+            _byteCounts.clear();
+            _byteCounts.shrink_to_fit();
+            _bytes.clear();
+            _bytes.shrink_to_fit();
+        }
+
+        //-----------------------------------------------------------------------------
+        bool CompressedVec3Array::empty() const
+        {
+            return _vectorCount == 0;
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t CompressedVec3Array::getMemorySize() const
+        {
+            return _byteCounts.capacity() + _bytes.capacity();
+        }
+    } // namespace usdplugin
+} // namespace glm
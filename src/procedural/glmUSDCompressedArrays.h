@@ -0,0 +1,48 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+USD_INCLUDES_END
+
+#include <vector>
+#include <stdint.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        // Lossless compression of float or half vectors, decompressed arrays are bit identical to the compressed ones.
+        // Each component is xored with the same component of the previous vector, neighbour points and normals of a
+        // mesh share their sign, exponent and high mantissa bits, so only the low non zero bytes are kept.
+        class CompressedVec3Array
+        {
+        public:
+            void compress(const VtVec3fArray& values);
+            void compress(const VtVec3hArray& values);
+            void decompress(VtVec3fArray& values) const;
+            void decompress(VtVec3hArray& values) const;
+            void clear();
+            bool empty() const;
+            size_t getMemorySize() const; // in bytes
+
+        protected:
+            size_t _vectorCount = 0;
+            std::vector<uint8_t> _byteCounts; // kept byte count of each component, 2 per byte
+            std::vector<uint8_t> _bytes;      // kept bytes of the xored components, low bytes first
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -6,9 +6,12 @@
 
 #include "glmUSDData.h"
 #include "glmUSDDataImpl.h"
+#include "glmUSDQueryTrace.h"
+#include "glmUSDRuntimeStats.h"
 
 USD_INCLUDES_START
 #include <pxr/pxr.h>
+#include <pxr/usd/sdf/schema.h>
 USD_INCLUDES_END
 
 #include <glmCoreDefinitions.h>
@@ -128,6 +131,33 @@ namespace glm
             return args;
         }
 
+        // Counts the visited specs of a traced VisitSpecs
+        class _CountingSpecVisitor : public SdfAbstractDataSpecVisitor
+        {
+        public:
+            _CountingSpecVisitor(SdfAbstractDataSpecVisitor* visitor)
+                : _visitor(visitor)
+            {
+            }
+            bool VisitSpec(const SdfAbstractData& data, const SdfPath& path) override
+            {
+                ++_specCount;
+                return _visitor->VisitSpec(data, path);
+            }
+            void Done(const SdfAbstractData& data) override
+            {
+                _visitor->Done(data);
+            }
+            uint64_t getSpecCount() const
+            {
+                return _specCount;
+            }
+
+        protected:
+            SdfAbstractDataSpecVisitor* _visitor;
+            uint64_t _specCount = 0;
+        };
+
         /*static*/
         //-----------------------------------------------------------------------------
         GolaemUSD_DataRefPtr GolaemUSD_Data::New(const GolaemUSD_DataParams& params)
@@ -138,6 +168,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         GolaemUSD_Data::GolaemUSD_Data(const GolaemUSD_DataParams& params)
             : _impl(new GolaemUSD_DataImpl(params))
+            , _trace(QueryTraceWriter::create(params.ToArgs()))
         {
             TfWeakPtr<GolaemUSD_Data> me(this);
             TfNotice::Register(me, &GolaemUSD_Data::_HandleNotice);
@@ -187,8 +218,14 @@ namespace glm
         //-----------------------------------------------------------------------------
         SdfSpecType GolaemUSD_Data::GetSpecType(const SdfPath& path) const
         {
-            GLM_UNREFERENCED(path);
-            return _impl->GetSpecType(path);
+            if (!_trace)
+            {
+                return _impl->GetSpecType(path);
+            }
+            int64_t startTime = RuntimeStats::now();
+            SdfSpecType specType = _impl->GetSpecType(path);
+            _trace->record(QueryTraceCallType::GET_SPEC_TYPE, path, TfToken(), 0, startTime, specType, 0);
+            return specType;
         }
 
         //-----------------------------------------------------------------------------
@@ -202,7 +239,15 @@ namespace glm
         //-----------------------------------------------------------------------------
         void GolaemUSD_Data::_VisitSpecs(SdfAbstractDataSpecVisitor* visitor) const
         {
-            _impl->VisitSpecs(*this, visitor);
+            if (!_trace)
+            {
+                _impl->VisitSpecs(*this, visitor);
+                return;
+            }
+            int64_t startTime = RuntimeStats::now();
+            _CountingSpecVisitor countingVisitor(visitor);
+            _impl->VisitSpecs(*this, &countingVisitor);
+            _trace->record(QueryTraceCallType::VISIT_SPECS, SdfPath(), TfToken(), 0, startTime, countingVisitor.getSpecCount(), 0);
         }
 
         //-----------------------------------------------------------------------------
@@ -211,26 +256,34 @@ namespace glm
             if (value)
             {
                 VtValue val;
-                if (_impl->Has(path, field, &val))
+                if (Has(path, field, &val))
                 {
                     return value->StoreValue(val);
                 }
                 return false;
             }
-            return _impl->Has(path, field, nullptr);
+            return Has(path, field, static_cast<VtValue*>(nullptr));
         }
 
         //-----------------------------------------------------------------------------
         bool GolaemUSD_Data::Has(const SdfPath& path, const TfToken& field, VtValue* value) const
         {
-            return _impl->Has(path, field, value);
+            if (!_trace)
+            {
+                return _impl->Has(path, field, value);
+            }
+            int64_t startTime = RuntimeStats::now();
+            bool result = _impl->Has(path, field, value);
+            uint64_t hash = result && value ? hashQueryTraceValue(field, *value) : 0;
+            _trace->record(value ? QueryTraceCallType::HAS_VALUE : QueryTraceCallType::HAS, path, field, 0, startTime, result, hash);
+            return result;
         }
 
         //-----------------------------------------------------------------------------
         VtValue GolaemUSD_Data::Get(const SdfPath& path, const TfToken& field) const
         {
             VtValue value;
-            _impl->Has(path, field, &value);
+            Has(path, field, &value);
             return value;
         }
 
@@ -263,44 +316,94 @@ namespace glm
         //-----------------------------------------------------------------------------
         std::vector<TfToken> GolaemUSD_Data::List(const SdfPath& path) const
         {
-            return _impl->List(path);
+            if (!_trace)
+            {
+                return _impl->List(path);
+            }
+            int64_t startTime = RuntimeStats::now();
+            std::vector<TfToken> fields = _impl->List(path);
+            _trace->record(QueryTraceCallType::LIST, path, TfToken(), 0, startTime, fields.size(), hashQueryTraceValues(fields));
+            return fields;
         }
 
         //-----------------------------------------------------------------------------
         std::set<double> GolaemUSD_Data::ListAllTimeSamples() const
         {
-            return _impl->ListAllTimeSamples();
+            if (!_trace)
+            {
+                return _impl->ListAllTimeSamples();
+            }
+            int64_t startTime = RuntimeStats::now();
+            std::set<double> times = _impl->ListAllTimeSamples();
+            _trace->record(QueryTraceCallType::LIST_ALL_TIME_SAMPLES, SdfPath(), TfToken(), 0, startTime, times.size(), hashQueryTraceValues(times));
+            return times;
         }
 
         //-----------------------------------------------------------------------------
         std::set<double> GolaemUSD_Data::ListTimeSamplesForPath(const SdfPath& path) const
         {
-            return _impl->ListTimeSamplesForPath(path);
+            if (!_trace)
+            {
+                return _impl->ListTimeSamplesForPath(path);
+            }
+            int64_t startTime = RuntimeStats::now();
+            std::set<double> times = _impl->ListTimeSamplesForPath(path);
+            _trace->record(QueryTraceCallType::LIST_TIME_SAMPLES_FOR_PATH, path, TfToken(), 0, startTime, times.size(), hashQueryTraceValues(times));
+            return times;
         }
 
         //-----------------------------------------------------------------------------
         bool GolaemUSD_Data::GetBracketingTimeSamples(double time, double* tLower, double* tUpper) const
         {
-            return _impl->GetBracketingTimeSamples(time, tLower, tUpper);
+            if (!_trace)
+            {
+                return _impl->GetBracketingTimeSamples(time, tLower, tUpper);
+            }
+            int64_t startTime = RuntimeStats::now();
+            bool result = _impl->GetBracketingTimeSamples(time, tLower, tUpper);
+            _trace->record(QueryTraceCallType::GET_BRACKETING_TIME_SAMPLES, SdfPath(), TfToken(), time, startTime, result, result ? hashQueryTraceValues(std::vector<double>{*tLower, *tUpper}) : 0);
+            return result;
         }
 
         //-----------------------------------------------------------------------------
         size_t GolaemUSD_Data::GetNumTimeSamplesForPath(const SdfPath& path) const
         {
-            return _impl->GetNumTimeSamplesForPath(path);
+            if (!_trace)
+            {
+                return _impl->GetNumTimeSamplesForPath(path);
+            }
+            int64_t startTime = RuntimeStats::now();
+            size_t timeSampleCount = _impl->GetNumTimeSamplesForPath(path);
+            _trace->record(QueryTraceCallType::GET_NUM_TIME_SAMPLES_FOR_PATH, path, TfToken(), 0, startTime, timeSampleCount, 0);
+            return timeSampleCount;
         }
 
         //-----------------------------------------------------------------------------
         bool GolaemUSD_Data::GetBracketingTimeSamplesForPath(
             const SdfPath& path, double time, double* tLower, double* tUpper) const
         {
-            return _impl->GetBracketingTimeSamplesForPath(path, time, tLower, tUpper);
+            if (!_trace)
+            {
+                return _impl->GetBracketingTimeSamplesForPath(path, time, tLower, tUpper);
+            }
+            int64_t startTime = RuntimeStats::now();
+            bool result = _impl->GetBracketingTimeSamplesForPath(path, time, tLower, tUpper);
+            _trace->record(QueryTraceCallType::GET_BRACKETING_TIME_SAMPLES_FOR_PATH, path, TfToken(), time, startTime, result, result ? hashQueryTraceValues(std::vector<double>{*tLower, *tUpper}) : 0);
+            return result;
         }
 
         //-----------------------------------------------------------------------------
         bool GolaemUSD_Data::QueryTimeSample(const SdfPath& path, double time, VtValue* value) const
         {
-            return _impl->QueryTimeSample(path, time, value);
+            if (!_trace)
+            {
+                return _impl->QueryTimeSample(path, time, value);
+            }
+            int64_t startTime = RuntimeStats::now();
+            bool result = _impl->QueryTimeSample(path, time, value);
+            uint64_t hash = result && value ? hashQueryTraceValue(SdfFieldKeys->Default, *value) : 0;
+            _trace->record(value ? QueryTraceCallType::QUERY_TIME_SAMPLE_VALUE : QueryTraceCallType::QUERY_TIME_SAMPLE, path, TfToken(), time, startTime, result, hash);
+            return result;
         }
 
         //-----------------------------------------------------------------------------
@@ -310,7 +413,7 @@ namespace glm
             if (value)
             {
                 VtValue val;
-                if (_impl->QueryTimeSample(path, time, &val))
+                if (QueryTimeSample(path, time, &val))
                 {
                     return value->StoreValue(val);
                 }
@@ -318,7 +421,7 @@ namespace glm
             }
             else
             {
-                return _impl->QueryTimeSample(path, time, nullptr);
+                return QueryTimeSample(path, time, static_cast<VtValue*>(nullptr));
             }
         }
 
@@ -21,6 +21,7 @@ namespace glm
     namespace usdplugin
     {
         class GolaemUSD_DataImpl;
+        class QueryTraceWriter;
         using namespace PXR_INTERNAL_NS;
 
         TF_DECLARE_WEAK_AND_REF_PTRS(GolaemUSD_Data);
@@ -44,6 +45,7 @@ namespace glm
     xx(TfToken, glmLayoutFiles, "")                 \
 	xx(TfToken, glmTerrainFile, "")                 \
     xx(float, glmRenderPercent, 100.f)              \
+    xx(short, glmRenderPercentMode, 0)              \
     xx(short, glmDisplayMode, 2)                    \
     xx(short, glmGeometryTag, 0)                    \
     xx(TfToken, glmDirmap, "")                      \
@@ -52,7 +54,30 @@ namespace glm
     xx(TfToken, glmAttributeNamespace, "")          \
     xx(short, glmLodMode, 0)                        \
     xx(GfVec3f, glmCameraPos, 0)                    \
+    xx(bool, glmFrustumCulling, false)              \
+    xx(GfVec3f, glmCameraRotation, 0)               \
+    xx(float, glmCameraFov, 54.43f)                 \
+    xx(float, glmCameraAspectRatio, 1.7778f)        \
+    xx(float, glmCameraNearClip, 0.1f)              \
+    xx(float, glmCameraFarClip, 10000.f)            \
+    xx(float, glmFrustumPadding, 0.f)               \
     xx(int, glmCachedFramesCount, 3)                \
+    xx(bool, glmFlattenHierarchy, false)            \
+    xx(short, glmExtentsMode, 0)                    \
+    xx(float, glmTileSize, 0.f)                     \
+    xx(short, glmTileMode, 0)                       \
+    xx(TfToken, glmTiles, "")                       \
+    xx(TfToken, glmRegionOfInterest, "")            \
+    xx(TfToken, glmRegionOfInterestFrames, "")      \
+    xx(bool, glmDeduplicateMeshes, false)           \
+    xx(bool, glmReuseUnchangedMeshes, false)        \
+    xx(bool, glmHalfPrecision, false)               \
+    xx(bool, glmCompressCachedFrames, false)        \
+    xx(short, glmNormalsMode, 0)                    \
+    xx(TfToken, glmBakedGeometryFiles, "")          \
+    xx(TfToken, glmGeometryCacheDir, "")            \
+    xx(float, glmGeometryCacheMaxSize, 0.f)         \
+    xx(float, glmGeometryCacheMaxAge, 0.f)          \
     xx(TfToken, glmProceduralFile, "")
         // clang-format on
 
@@ -73,6 +98,7 @@ namespace glm
     (glmLayoutFiles)                    \
 	(glmTerrainFile)                    \
     (glmRenderPercent)                  \
+    (glmRenderPercentMode)              \
     (glmDisplayMode)                    \
     (glmGeometryTag)                    \
     (glmDirmap)                         \
@@ -81,7 +107,30 @@ namespace glm
     (glmAttributeNamespace)             \
     (glmLodMode)                        \
     (glmCameraPos)                      \
+    (glmFrustumCulling)                 \
+    (glmCameraRotation)                 \
+    (glmCameraFov)                      \
+    (glmCameraAspectRatio)              \
+    (glmCameraNearClip)                 \
+    (glmCameraFarClip)                  \
+    (glmFrustumPadding)                 \
     (glmCachedFramesCount)              \
+    (glmFlattenHierarchy)               \
+    (glmExtentsMode)                    \
+    (glmTileSize)                       \
+    (glmTileMode)                       \
+    (glmTiles)                          \
+    (glmRegionOfInterest)               \
+    (glmRegionOfInterestFrames)         \
+    (glmDeduplicateMeshes)              \
+    (glmReuseUnchangedMeshes)           \
+    (glmHalfPrecision)                  \
+    (glmCompressCachedFrames)           \
+    (glmNormalsMode)                    \
+    (glmBakedGeometryFiles)             \
+    (glmGeometryCacheDir)               \
+    (glmGeometryCacheMaxSize)           \
+    (glmGeometryCacheMaxAge)            \
     (glmProceduralFile)
         // clang-format on
 
@@ -123,6 +172,9 @@ namespace glm
             // Pointer to the actual implementation
             std::unique_ptr<GolaemUSD_DataImpl> _impl;
 
+            // Records the calls when GOLAEMUSD_TRACE_DIR is set
+            std::unique_ptr<QueryTraceWriter> _trace;
+
         public:
             /// Factory New. We always create this data with an explicit params object.
             static GolaemUSD_DataRefPtr New(const GolaemUSD_DataParams& params);
@@ -6,18 +6,37 @@
 
 #include "glmUSDDataImpl.h"
 #include "glmUSDFileFormat.h"
+#include "glmUSDDebugCodes.h"
+#include "glmUSDKernels.h"
 
 USD_INCLUDES_START
 #include <pxr/pxr.h>
 #include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/sdf/types.h>
 #include <pxr/usd/sdf/reference.h>
 #include <pxr/usd/usd/prim.h>
 #include <pxr/usd/usd/attribute.h>
 #include <pxr/usd/usdGeom/tokens.h>
 #include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usd/clipsAPI.h>
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/math.h>
+#include <pxr/base/gf/rotation.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/base/arch/hash.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/data.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/relationshipSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/base/tf/fileUtils.h>
 USD_INCLUDES_END
 
 #include <glmCore.h>
+#include <glmCoreDefinitions.h>
 #include <glmLog.h>
 #include <glmFileDir.h>
 #include <glmSimulationCacheLibrary.h>
@@ -38,6 +57,12 @@ USD_INCLUDES_END
 #include <glmIdsFilter.h>
 
 #include <fstream>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
 
 namespace glm
 {
@@ -86,6 +111,7 @@ namespace glm
             ((normals, "normals"))
             ((uvs, "primvars:st"))
             ((velocities, "velocities"))
+            ((extent, "extent"))
         );
 
         TF_DEFINE_PRIVATE_TOKENS(
@@ -117,26 +143,16 @@ namespace glm
             ((__glmNodeId__, "__glmNodeId__"))
             ((__glmNodeType__, "__glmNodeType__"))
             ((glmCameraPos, "glmCameraPos"))
+            ((glmCameraRotation, "glmCameraRotation"))
+            ((glmCameraFov, "glmCameraFov"))
+            ((glmCameraAspectRatio, "glmCameraAspectRatio"))
+            ((glmCameraNearClip, "glmCameraNearClip"))
+            ((glmCameraFarClip, "glmCameraFarClip"))
         );
         // clang-format on
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
-        // We create a static map from property names to the info about them that
-        // we'll be querying for specs.
-        struct _PrimPropertyInfo
-        {
-            VtValue defaultValue;
-            TfToken typeName;
-            // Most of our properties are animated.
-            bool isAnimated = true;
-            bool hasInterpolation = false;
-            TfToken interpolation;
-        };
-
-        using _LeafPrimPropertyMap =
-            std::map<TfToken, _PrimPropertyInfo, TfTokenFastArbitraryLessThan>;
-
         struct _PrimRelationshipInfo
         {
             SdfPathListOp defaultTargetPath;
@@ -256,6 +272,10 @@ namespace glm
             (*_skinMeshProperties)[_skinMeshPropertyTokens->orientation].defaultValue = VtValue(UsdGeomTokens->rightHanded);
             (*_skinMeshProperties)[_skinMeshPropertyTokens->orientation].isAnimated = false;
 
+            // extents are only animated when computed from the deformed points
+            (*_skinMeshProperties)[_skinMeshPropertyTokens->extent].defaultValue = VtValue(VtVec3fArray({GfVec3f(-0.5, -0.5, -0.5), GfVec3f(0.5, 0.5, 0.5)}));
+            (*_skinMeshProperties)[_skinMeshPropertyTokens->extent].isAnimated = false;
+
             // Use the schema to derive the type name tokens from each property's
             // default value.
             for (auto& it : *_skinMeshProperties)
@@ -340,12 +360,17 @@ namespace glm
     }                                        \
     return true;
 
-        static glm::Mutex _fbxMutex;
+        static ProfiledMutex _fbxMutex(LockStats::FBX);
+
+        // entity tiles are shared by all the layers loading the same crowd field, e.g. one layer per tile.
+        // Cleared when the last layer is released.
+        static glm::Mutex _entityTilesCacheLock;
+        static std::map<std::string, glm::Array<TfToken>> _entityTilesCache;
 
         //-----------------------------------------------------------------------------
         glm::crowdio::CrowdFBXStorage& getFbxStorage()
         {
-            glm::ScopedLock<glm::Mutex> lock(_fbxMutex);
+            glm::ScopedLock<ProfiledMutex> lock(_fbxMutex);
             static glm::crowdio::CrowdFBXStorage fbxStorage;
             return fbxStorage;
         }
@@ -354,11 +379,61 @@ namespace glm
         glm::crowdio::CrowdFBXBaker& getFbxBaker()
         {
             glm::crowdio::CrowdFBXStorage& fbxStorage = getFbxStorage();
-            glm::ScopedLock<glm::Mutex> lock(_fbxMutex);
+            glm::ScopedLock<ProfiledMutex> lock(_fbxMutex);
             static glm::crowdio::CrowdFBXBaker fbxBaker(fbxStorage.touchFbxSdkManager());
             return fbxBaker;
         }
 
+        //-----------------------------------------------------------------------------
+        // parses ';' separated boxes of 6 values: "minX minY minZ maxX maxY maxZ"
+        void parseRegionOfInterest(const glm::GlmString& regionStr, std::vector<GfRange3f>& regionBoxes)
+        {
+            glm::Array<glm::GlmString> boxStrings = glm::stringToStringArray(regionStr, ";");
+            for (size_t iBox = 0, boxCount = boxStrings.size(); iBox < boxCount; ++iBox)
+            {
+                std::string boxString = boxStrings[iBox].c_str();
+                std::replace(boxString.begin(), boxString.end(), ',', ' ');
+                float values[6];
+                if (sscanf(boxString.c_str(), "%f %f %f %f %f %f", &values[0], &values[1], &values[2], &values[3], &values[4], &values[5]) != 6)
+                {
+                    GLM_CROWD_TRACE_WARNING("Invalid region of interest box '" << boxStrings[iBox] << "', expected 6 values: minX minY minZ maxX maxY maxZ");
+                    continue;
+                }
+                GfRange3f box;
+                box.UnionWith(GfVec3f(values[0], values[1], values[2]));
+                box.UnionWith(GfVec3f(values[3], values[4], values[5]));
+                regionBoxes.push_back(box);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        // parses a frame range: "first:last", "frame" or "*" for the whole simulation, defaults to the first frame
+        void parseRegionOfInterestFrames(const glm::GlmString& framesStr, const std::pair<int, int>& frameRange, std::pair<int, int>& regionFrameRange)
+        {
+            regionFrameRange = std::make_pair(frameRange.first, frameRange.first);
+            if (framesStr == "*")
+            {
+                regionFrameRange = frameRange;
+            }
+            else if (!framesStr.empty())
+            {
+                int first = 0;
+                int last = 0;
+                int valueCount = sscanf(framesStr.c_str(), "%d:%d", &first, &last);
+                if (valueCount == 1)
+                {
+                    last = first;
+                }
+                else if (valueCount != 2)
+                {
+                    GLM_CROWD_TRACE_WARNING("Invalid region of interest frames '" << framesStr << "', using the first frame");
+                    return;
+                }
+                regionFrameRange.first = std::max(frameRange.first, std::min(first, last));
+                regionFrameRange.second = std::min(frameRange.second, std::max(first, last));
+            }
+        }
+
         //-----------------------------------------------------------------------------
         GolaemUSD_DataImpl::EntityData::~EntityData()
         {
@@ -369,9 +444,13 @@ namespace glm
         void GolaemUSD_DataImpl::EntityData::initEntityLock()
         {
             GLM_DEBUG_ASSERT(entityComputeLock == NULL);
-            entityComputeLock = new glm::Mutex();
+            entityComputeLock = new ProfiledMutex(LockStats::ENTITY_COMPUTE);
         }
 
+        // layers currently loaded, for getLayerMemoryUsages
+        static glm::Mutex s_layersLock;
+        static std::set<const GolaemUSD_DataImpl*> s_layers;
+
         //-----------------------------------------------------------------------------
         GolaemUSD_DataImpl::GolaemUSD_DataImpl(const GolaemUSD_DataParams& params)
             : _params(params)
@@ -380,12 +459,38 @@ namespace glm
             _rootNodeIdInFinalStage = usdplugin::init();
             _usdParams[_golaemTokens->__glmNodeId__] = _rootNodeIdInFinalStage;
             _usdParams[_golaemTokens->__glmNodeType__] = GolaemUSDFileFormatTokens->Id;
-            if (_params.glmLodMode == 2)
+            if (_params.glmLodMode == 2 || _params.glmFrustumCulling)
             {
-                // dynamic lod mode
+                // dynamic lod mode or frustum culling
                 // add camera position parameter
                 _usdParams[_golaemTokens->glmCameraPos] = _params.glmCameraPos;
             }
+            if (_params.glmFrustumCulling)
+            {
+                // add the other camera parameters, they may also be connected to the render camera
+                _usdParams[_golaemTokens->glmCameraRotation] = _params.glmCameraRotation;
+                _usdParams[_golaemTokens->glmCameraFov] = _params.glmCameraFov;
+                _usdParams[_golaemTokens->glmCameraAspectRatio] = _params.glmCameraAspectRatio;
+                _usdParams[_golaemTokens->glmCameraNearClip] = _params.glmCameraNearClip;
+                _usdParams[_golaemTokens->glmCameraFarClip] = _params.glmCameraFarClip;
+            }
+            if (RuntimeStats::isEnabled())
+            {
+                for (int iCounter = 0; iCounter < RuntimeStats::COUNTER_COUNT; ++iCounter)
+                {
+                    _statsAttributes[TfToken(TfStringPrintf("glmStats:%s", RuntimeStats::getName(static_cast<RuntimeStats::Counter>(iCounter))))] = iCounter;
+                }
+                for (int iLockClass = 0; iLockClass < LockStats::LOCK_CLASS_COUNT; ++iLockClass)
+                {
+                    for (int iValue = 0; iValue < LockStats::VALUE_COUNT; ++iValue)
+                    {
+                        std::string attributeName = LockStats::getAttributeName(static_cast<LockStats::LockClass>(iLockClass), static_cast<LockStats::Value>(iValue));
+                        _statsAttributes[TfToken("glmStats:" + attributeName)] = RuntimeStats::COUNTER_COUNT + iLockClass * LockStats::VALUE_COUNT + iValue;
+                    }
+                }
+                // computed when queried, under the lock of every entity
+                _statsAttributes[TfToken("glmStats:frameCacheBytes")] = -1;
+            }
             _shaderAttrTypes.resize(ShaderAttributeType::END);
             _shaderAttrDefaultValues.resize(ShaderAttributeType::END);
             {
@@ -429,14 +534,35 @@ namespace glm
                 _ppAttrTypes[attrTypeIdx] = SdfSchema::GetInstance().FindType(value).GetAsToken();
                 _ppAttrDefaultValues[attrTypeIdx] = value;
             }
+            _InitPropertyInfos();
             _InitFromParams();
+
+            {
+                glm::ScopedLock<glm::Mutex> layersLock(s_layersLock);
+                s_layers.insert(this);
+            }
+            _DebugMemoryUsage("initialized");
+            _lastMemoryDebugTime = RuntimeStats::now();
         }
 
         //-----------------------------------------------------------------------------
         GolaemUSD_DataImpl::~GolaemUSD_DataImpl()
         {
+            bool lastLayer = false;
+            {
+                glm::ScopedLock<glm::Mutex> layersLock(s_layersLock);
+                s_layers.erase(this);
+                lastLayer = s_layers.empty();
+            }
+            _DebugMemoryUsage("released");
+            if (lastLayer)
+            {
+                glm::ScopedLock<glm::Mutex> lock(_entityTilesCacheLock);
+                _entityTilesCache.clear();
+            }
+
             delete _factory;
-            for (glm::Mutex* lock : _cachedSimulationLocks)
+            for (ProfiledMutex* lock : _cachedSimulationLocks)
             {
                 delete lock;
             }
@@ -453,6 +579,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         SdfSpecType GolaemUSD_DataImpl::GetSpecType(const SdfPath& path) const
         {
+            _stats.add(RuntimeStats::SPEC_QUERIES);
             // All specs are generated.
             if (path.IsPropertyPath()) // IsPropertyPath includes relational attributes
             {
@@ -500,7 +627,7 @@ namespace glm
                 }
                 else
                 {
-                    if (TfMapLookupPtr(*_skinMeshEntityProperties, nameToken) != NULL)
+                    if (TfMapLookupPtr(_skinMeshEntityPropertyInfos, nameToken) != NULL)
                     {
                         if (TfMapLookupPtr(_entityDataMap, primPath) != NULL)
                         {
@@ -514,7 +641,7 @@ namespace glm
                             return SdfSpecTypeAttribute;
                         }
                     }
-                    if (TfMapLookupPtr(*_skinMeshProperties, nameToken) != NULL)
+                    if (TfMapLookupPtr(_skinMeshPropertyInfos, nameToken) != NULL)
                     {
                         if (TfMapLookupPtr(_skinMeshDataMap, primPath) != NULL)
                         {
@@ -558,6 +685,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         bool GolaemUSD_DataImpl::Has(const SdfPath& path, const TfToken& field, VtValue* value)
         {
+            _stats.add(RuntimeStats::HAS_QUERIES);
             // If property spec, check property fields
             if (path.IsPropertyPath())
             {
@@ -584,20 +712,9 @@ namespace glm
                     {
                         // Will need to generate the full SdfTimeSampleMap with a
                         // time sample value for each discrete animated frame if the
-                        // value of the TimeSamples field is requested. Use a generator
-                        // function in case we don't need to output the value as this
-                        // can be expensive.
-                        auto _MakeTimeSampleMap = [this, &path]()
-                        {
-                            SdfTimeSampleMap sampleMap;
-                            for (auto& time : _animTimeSampleTimes)
-                            {
-                                QueryTimeSample(path, time, &sampleMap[time]);
-                            }
-                            return sampleMap;
-                        };
-
-                        RETURN_TRUE_WITH_OPTIONAL_VALUE(_MakeTimeSampleMap());
+                        // value of the TimeSamples field is requested. Only generate it
+                        // if we need to output the value as this can be expensive.
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(_MakeTimeSampleMap(path));
                     }
                 }
             }
@@ -789,6 +906,10 @@ namespace glm
                         {
                             usdTokens.push_back(TfToken(itDict.first));
                         }
+                        for (const auto& itStats : _statsAttributes)
+                        {
+                            usdTokens.push_back(itStats.first);
+                        }
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(usdTokens);
                     }
                     // Leaf prims have the same specified set of property children.
@@ -819,7 +940,7 @@ namespace glm
                     {
                         if (EntityData::SP* entityDataPtr = TfMapLookupPtr(_entityDataMap, path))
                         {
-                            std::vector<TfToken> entityTokens = _skinMeshEntityPropertyTokens->allTokens;
+                            std::vector<TfToken> entityTokens = _skinMeshEntityPropertyNames;
                             // add pp attributes
                             for (const auto& itAttr : (*entityDataPtr)->ppAttrIndexes)
                             {
@@ -838,7 +959,7 @@ namespace glm
                         }
                         if (TfMapLookupPtr(_skinMeshDataMap, path) != NULL)
                         {
-                            std::vector<TfToken> meshTokens = _skinMeshPropertyTokens->allTokens;
+                            std::vector<TfToken> meshTokens = _skinMeshPropertyNames;
                             meshTokens.insert(meshTokens.end(), _skinMeshRelationshipTokens->allTokens.begin(), _skinMeshRelationshipTokens->allTokens.end());
                             RETURN_TRUE_WITH_OPTIONAL_VALUE(meshTokens);
                         }
@@ -851,6 +972,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::VisitSpecs(const SdfAbstractData& data, SdfAbstractDataSpecVisitor* visitor) const
         {
+            _stats.add(RuntimeStats::VISIT_SPECS_QUERIES);
             // Visit the pseudoroot.
             if (!visitor->VisitSpec(data, SdfPath::AbsoluteRootPath()))
             {
@@ -864,6 +986,13 @@ namespace glm
                     return;
                 }
             }
+            for (const auto& itStats : _statsAttributes)
+            {
+                if (!visitor->VisitSpec(data, _GetRootPrimPath().AppendProperty(itStats.first)))
+                {
+                    return;
+                }
+            }
 
             // Visit all the cached prim spec paths.
             for (const auto& path : _primSpecPaths)
@@ -925,7 +1054,7 @@ namespace glm
                 // Visit the property specs which exist only on entity prims.
                 for (auto& it : _entityDataMap)
                 {
-                    for (const TfToken& propertyName : _skinMeshEntityPropertyTokens->allTokens)
+                    for (const TfToken& propertyName : _skinMeshEntityPropertyNames)
                     {
                         if (!visitor->VisitSpec(data, it.first.AppendProperty(propertyName)))
                         {
@@ -963,7 +1092,7 @@ namespace glm
                 // Visit the property specs which exist only on entity mesh prims.
                 for (auto& it : _skinMeshDataMap)
                 {
-                    for (const TfToken& propertyName : _skinMeshPropertyTokens->allTokens)
+                    for (const TfToken& propertyName : _skinMeshPropertyNames)
                     {
                         if (!visitor->VisitSpec(data, it.first.AppendProperty(propertyName)))
                         {
@@ -984,6 +1113,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         const std::vector<TfToken>& GolaemUSD_DataImpl::List(const SdfPath& path) const
         {
+            _stats.add(RuntimeStats::LIST_QUERIES);
             if (path.IsPropertyPath())
             {
                 const TfToken& nameToken = path.GetNameToken();
@@ -1068,7 +1198,7 @@ namespace glm
                     }
                     else
                     {
-                        if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshEntityProperties, nameToken))
+                        if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshEntityPropertyInfos, nameToken))
                         {
                             if (TfMapLookupPtr(_entityDataMap, primPath) != NULL)
                             {
@@ -1098,7 +1228,7 @@ namespace glm
                                 }
                             }
                         }
-                        if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshProperties, nameToken))
+                        if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshPropertyInfos, nameToken))
                         {
                             if (TfMapLookupPtr(_skinMeshDataMap, primPath) != NULL)
                             {
@@ -1242,6 +1372,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         const std::set<double>& GolaemUSD_DataImpl::ListAllTimeSamples() const
         {
+            _stats.add(RuntimeStats::TIME_SAMPLE_LIST_QUERIES);
             // The set of all time sample times is cached.
             return _animTimeSampleTimes;
         }
@@ -1249,11 +1380,12 @@ namespace glm
         //-----------------------------------------------------------------------------
         const std::set<double>& GolaemUSD_DataImpl::ListTimeSamplesForPath(const SdfPath& path) const
         {
+            _stats.add(RuntimeStats::TIME_SAMPLE_LIST_QUERIES);
             // All animated properties use the same set of time samples; all other
             // specs return empty.
             if (_IsAnimatedProperty(path))
             {
-                return ListAllTimeSamples();
+                return _animTimeSampleTimes;
             }
             static std::set<double> empty;
             return empty;
@@ -1262,6 +1394,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         bool GolaemUSD_DataImpl::GetBracketingTimeSamples(double time, double* tLower, double* tUpper) const
         {
+            _stats.add(RuntimeStats::TIME_SAMPLE_LIST_QUERIES);
             // A time sample time will exist at each discrete integer frame for the
             // duration of the generated animation and will already be cached.
             if (_animTimeSampleTimes.empty())
@@ -1289,6 +1422,7 @@ namespace glm
         //-----------------------------------------------------------------------------
         size_t GolaemUSD_DataImpl::GetNumTimeSamplesForPath(const SdfPath& path) const
         {
+            _stats.add(RuntimeStats::TIME_SAMPLE_LIST_QUERIES);
             // All animated properties use the same set of time samples; all other specs
             // have no time samples.
             if (_IsAnimatedProperty(path))
@@ -1307,6 +1441,8 @@ namespace glm
                 return GetBracketingTimeSamples(time, tLower, tUpper);
             }
 
+            // animated properties are counted by GetBracketingTimeSamples
+            _stats.add(RuntimeStats::TIME_SAMPLE_LIST_QUERIES);
             return false;
         }
 
@@ -1385,6 +1521,17 @@ namespace glm
         //-----------------------------------------------------------------------------
         bool GolaemUSD_DataImpl::QueryTimeSample(const SdfPath& path, double frame, VtValue* value)
         {
+            return _QueryTimeSample(path, frame, nullptr, value);
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_QueryTimeSample(const SdfPath& path, double frame, EntityData::SP computeEntityData, VtValue* value)
+        {
+            _stats.add(RuntimeStats::TIME_SAMPLE_QUERIES);
+            if (TfDebug::IsEnabled(GOLAEMUSD_MEMORY))
+            {
+                _DebugMemoryUsagePeriodically();
+            }
             SdfPath primPath = path.GetAbsoluteRootOrPrimPath();
             const TfToken& nameToken = path.GetNameToken();
 
@@ -1408,21 +1555,26 @@ namespace glm
                 {
                     return false;
                 }
+                if (computeEntityData == nullptr)
+                {
+                    computeEntityData = entityData;
+                }
 
                 // need to lock the wrapper until all the data is retrieved
-                glm::ScopedLockActivable<glm::Mutex> wrapperLock(_usdWrapper._updateLock);
+                glm::ScopedLockActivable<ProfiledMutex> wrapperLock(_usdWrapper._updateLock);
                 _usdWrapper.update(frame, wrapperLock);
 
                 // need to lock the entity until all the data is retrieved
-                glm::ScopedLock<glm::Mutex> entityComputeLock(*entityData->entityComputeLock);
-                SkelEntityFrameData::SP skelEntityFrameData = _ComputeSkelEntity(entityData, frame);
+                glm::ScopedLock<ProfiledMutex> entityComputeLock(*computeEntityData->entityComputeLock);
+                debugLockWait("entityComputeLock", computeEntityData->entityComputeLock->getLastWaitTime());
+                SkelEntityFrameData::SP skelEntityFrameData = _ComputeSkelEntity(computeEntityData, frame);
 
                 if (isEntityPath)
                 {
                     // this is an entity node
                     if (nameToken == _skelEntityPropertyTokens->visibility)
                     {
-                        RETURN_TRUE_WITH_OPTIONAL_VALUE(skelEntityFrameData->enabled ? UsdGeomTokens->inherited : UsdGeomTokens->invisible);
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(skelEntityFrameData->enabled && !skelEntityFrameData->culled ? UsdGeomTokens->inherited : UsdGeomTokens->invisible);
                     }
                     if (nameToken == _skelEntityPropertyTokens->extent)
                     {
@@ -1481,22 +1633,27 @@ namespace glm
                 {
                     return false;
                 }
+                if (computeEntityData == nullptr)
+                {
+                    computeEntityData = entityData;
+                }
 
                 // need to lock the wrapper until all the data is retrieved
-                glm::ScopedLockActivable<glm::Mutex> wrapperLock(_usdWrapper._updateLock);
+                glm::ScopedLockActivable<ProfiledMutex> wrapperLock(_usdWrapper._updateLock);
                 _usdWrapper.update(frame, wrapperLock);
 
                 // need to lock the entity until all the data is retrieved
-                glm::ScopedLock<glm::Mutex> entityComputeLock(*entityData->entityComputeLock);
+                glm::ScopedLock<ProfiledMutex> entityComputeLock(*computeEntityData->entityComputeLock);
+                debugLockWait("entityComputeLock", computeEntityData->entityComputeLock->getLastWaitTime());
                 SkinMeshEntityFrameData::SP prevFrameData;
 
                 SkinMeshEntityData::SP skinMeshEntityData = glm::staticCast<SkinMeshEntityData>(entityData);
 
                 if (skinMeshEntityData->computeVelocities && frame >= _startFrame + 1)
                 {
-                    prevFrameData = _ComputeSkinMeshEntity(entityData, frame - 1.0);
+                    prevFrameData = _ComputeSkinMeshEntity(computeEntityData, frame - 1.0);
                 }
-                SkinMeshEntityFrameData::SP entityFrameData = _ComputeSkinMeshEntity(entityData, frame);
+                SkinMeshEntityFrameData::SP entityFrameData = _ComputeSkinMeshEntity(computeEntityData, frame);
                 _ComputeEntityVelocities(entityFrameData, prevFrameData);
 
                 if (isEntityPath)
@@ -1509,7 +1666,7 @@ namespace glm
                     }
                     if (nameToken == _skinMeshEntityPropertyTokens->visibility)
                     {
-                        RETURN_TRUE_WITH_OPTIONAL_VALUE(entityFrameData->enabled ? UsdGeomTokens->inherited : UsdGeomTokens->invisible);
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(entityFrameData->enabled && !entityFrameData->culled ? UsdGeomTokens->inherited : UsdGeomTokens->invisible);
                     }
                     if (nameToken == _skinMeshEntityPropertyTokens->geometryFileId)
                     {
@@ -1519,10 +1676,28 @@ namespace glm
                     {
                         RETURN_TRUE_WITH_OPTIONAL_VALUE(entityFrameData->lodName);
                     }
+                    if (nameToken == _skinMeshEntityPropertyTokens->extentsHint)
+                    {
+                        if (entityFrameData->extentsHint.empty())
+                        {
+                            // extents were not computed for this frame
+                            RETURN_TRUE_WITH_OPTIONAL_VALUE(VtVec3fArray({-entityData->extent, entityData->extent}));
+                        }
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(entityFrameData->extentsHint);
+                    }
                     return _QueryEntityAttributes(entityFrameData, nameToken, value);
                 }
                 else if (isMeshLodPath)
                 {
+                    if (entityFrameData->culled || lodIndex >= entityFrameData->meshLodData.size())
+                    {
+                        // no lod data was computed for this frame
+                        if (nameToken == _skinMeshLodPropertyTokens->visibility)
+                        {
+                            RETURN_TRUE_WITH_OPTIONAL_VALUE(UsdGeomTokens->invisible);
+                        }
+                        return false;
+                    }
                     SkinMeshLodData::SP meshLodData = entityFrameData->meshLodData[lodIndex];
                     if (nameToken == _skinMeshLodPropertyTokens->visibility)
                     {
@@ -1534,9 +1709,9 @@ namespace glm
                     // this is a mesh node
 
                     bool useTemplateData = false;
-                    if (!entityFrameData->enabled)
+                    if (!entityFrameData->enabled || entityFrameData->culled)
                     {
-                        // entity is disabled, use the mesh template data
+                        // entity is disabled or outside of the camera frustum, use the mesh template data
                         useTemplateData = true;
                     }
                     else
@@ -1558,16 +1733,28 @@ namespace glm
                                 }
                                 if (nameToken == _skinMeshPropertyTokens->normals)
                                 {
+                                    if (_params.glmHalfPrecision)
+                                    {
+                                        RETURN_TRUE_WITH_OPTIONAL_VALUE(meshData->halfNormals);
+                                    }
                                     RETURN_TRUE_WITH_OPTIONAL_VALUE(meshData->normals);
                                 }
                                 if (nameToken == _skinMeshPropertyTokens->velocities)
                                 {
-                                    if (!skinMeshEntityData->computeVelocities || meshData->velocities.empty())
+                                    if (!skinMeshEntityData->computeVelocities || (meshData->velocities.empty() && meshData->halfVelocities.empty()))
                                     {
                                         return false;
                                     }
+                                    if (_params.glmHalfPrecision)
+                                    {
+                                        RETURN_TRUE_WITH_OPTIONAL_VALUE(meshData->halfVelocities);
+                                    }
                                     RETURN_TRUE_WITH_OPTIONAL_VALUE(meshData->velocities);
                                 }
+                                if (nameToken == _skinMeshPropertyTokens->extent && !meshData->extent.empty())
+                                {
+                                    RETURN_TRUE_WITH_OPTIONAL_VALUE(meshData->extent);
+                                }
                             }
                         }
                     }
@@ -1583,6 +1770,10 @@ namespace glm
                         }
                         if (nameToken == _skinMeshPropertyTokens->normals)
                         {
+                            if (_params.glmHalfPrecision)
+                            {
+                                RETURN_TRUE_WITH_OPTIONAL_VALUE(meshTemplateData->defaultHalfNormals);
+                            }
                             RETURN_TRUE_WITH_OPTIONAL_VALUE(meshTemplateData->defaultNormals);
                         }
                         if (nameToken == _skinMeshPropertyTokens->velocities)
@@ -1591,8 +1782,16 @@ namespace glm
                             {
                                 return false;
                             }
+                            if (_params.glmHalfPrecision)
+                            {
+                                RETURN_TRUE_WITH_OPTIONAL_VALUE(meshTemplateData->defaultHalfVelocities);
+                            }
                             RETURN_TRUE_WITH_OPTIONAL_VALUE(meshTemplateData->defaultVelocities);
                         }
+                        if (nameToken == _skinMeshPropertyTokens->extent)
+                        {
+                            RETURN_TRUE_WITH_OPTIONAL_VALUE(VtVec3fArray({-entityData->extent, entityData->extent}));
+                        }
                     }
                 }
             }
@@ -1600,6 +1799,117 @@ namespace glm
             return false;
         }
 
+        //-----------------------------------------------------------------------------
+        SdfTimeSampleMap GolaemUSD_DataImpl::_MakeTimeSampleMap(const SdfPath& path)
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("MakeTimeSampleMap", GLM_COLOR_CACHE);
+#endif
+            SdfTimeSampleMap sampleMap;
+
+            // all the keys are inserted first, each frame then writes its own value
+            std::vector<double> times(_animTimeSampleTimes.begin(), _animTimeSampleTimes.end());
+            std::vector<VtValue*> values(times.size(), NULL);
+            for (size_t iTime = 0; iTime < times.size(); ++iTime)
+            {
+                values[iTime] = &sampleMap[times[iTime]];
+            }
+
+            SdfPath primPath = path.GetAbsoluteRootOrPrimPath();
+            EntityData::SP entityData = nullptr;
+            if (EntityData::SP* entityDataPtr = TfMapLookupPtr(_entityDataMap, primPath))
+            {
+                entityData = *entityDataPtr;
+            }
+            else if (SkelEntityData::SP* skelEntityDataPtr = TfMapLookupPtr(_skelAnimDataMap, primPath))
+            {
+                entityData = *skelEntityDataPtr;
+            }
+            else if (const SkinMeshMapData* meshMapData = TfMapLookupPtr(_skinMeshDataMap, primPath))
+            {
+                entityData = meshMapData->entityData;
+            }
+            else if (const SkinMeshLodMapData* lodMapData = TfMapLookupPtr(_skinMeshLodDataMap, primPath))
+            {
+                entityData = lodMapData->entityData;
+            }
+            if (entityData == nullptr || entityData->excluded || times.size() < 2)
+            {
+                for (size_t iTime = 0; iTime < times.size(); ++iTime)
+                {
+                    QueryTimeSample(path, times[iTime], values[iTime]);
+                }
+                return sampleMap;
+            }
+
+            // contiguous frame ranges, so that the previous frame used by the velocities is still cached.
+            // Each range computes a copy of the entity with its own frame cache: the frame cache of the entity is not thrashed
+            // and the frames do not wait for each other on the entity lock
+            size_t rangeCount = std::min(times.size(), static_cast<size_t>(std::max(WorkGetConcurrencyLimit(), 1u)));
+            size_t framesPerRange = (times.size() + rangeCount - 1) / rangeCount;
+            WorkParallelForN(
+                rangeCount,
+                [&](size_t start, size_t end)
+                {
+                    for (size_t iRange = start; iRange < end; ++iRange)
+                    {
+                        EntityData::SP rangeEntityData = _CloneEntityData(entityData);
+                        for (size_t iTime = iRange * framesPerRange, endTime = std::min(times.size(), (iRange + 1) * framesPerRange); iTime < endTime; ++iTime)
+                        {
+                            _QueryTimeSample(path, times[iTime], rangeEntityData, values[iTime]);
+                        }
+                        // the frame datas reference the entity
+                        rangeEntityData->frameDataMap.clear();
+                    }
+                });
+            return sampleMap;
+        }
+
+        //-----------------------------------------------------------------------------
+        GolaemUSD_DataImpl::EntityData::SP GolaemUSD_DataImpl::_CloneEntityData(EntityData::SP entityData) const
+        {
+            // the frame data map and the compute lock are not copied
+            EntityData::SP clonedEntityData = NULL;
+            if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
+            {
+                const SkelEntityData* skelEntityData = static_cast<const SkelEntityData*>(entityData.getImpl());
+                SkelEntityData::SP clonedSkelEntityData = new SkelEntityData();
+                clonedSkelEntityData->referencedUsdCharacter = skelEntityData->referencedUsdCharacter;
+                clonedSkelEntityData->geoVariants = skelEntityData->geoVariants;
+                clonedSkelEntityData->animationSourcePath = skelEntityData->animationSourcePath;
+                clonedSkelEntityData->skeletonPath = skelEntityData->skeletonPath;
+                clonedSkelEntityData->scalesAnimated = skelEntityData->scalesAnimated;
+                clonedSkelEntityData->boneSnsOffset = skelEntityData->boneSnsOffset;
+                clonedEntityData = clonedSkelEntityData;
+            }
+            else
+            {
+                const SkinMeshEntityData* skinMeshEntityData = static_cast<const SkinMeshEntityData*>(entityData.getImpl());
+                SkinMeshEntityData::SP clonedSkinMeshEntityData = new SkinMeshEntityData();
+                clonedSkinMeshEntityData->lodEnabled = skinMeshEntityData->lodEnabled;
+                clonedSkinMeshEntityData->computeVelocities = skinMeshEntityData->computeVelocities;
+                clonedEntityData = clonedSkinMeshEntityData;
+            }
+            clonedEntityData->ppAttrIndexes = entityData->ppAttrIndexes;
+            clonedEntityData->shaderAttrIndexes = entityData->shaderAttrIndexes;
+            clonedEntityData->entityPath = entityData->entityPath;
+            clonedEntityData->excluded = entityData->excluded;
+            clonedEntityData->cfIdx = entityData->cfIdx;
+            clonedEntityData->bonePositionOffset = entityData->bonePositionOffset;
+            clonedEntityData->cachedSimulationLock = entityData->cachedSimulationLock;
+            clonedEntityData->initEntityLock();
+            {
+                // inputGeoData is modified by the computes of the entity
+                glm::ScopedLock<ProfiledMutex> entityComputeLock(*entityData->entityComputeLock);
+                clonedEntityData->inputGeoData = entityData->inputGeoData;
+            }
+            clonedEntityData->cachedSimulation = entityData->cachedSimulation;
+            clonedEntityData->extent = entityData->extent;
+            clonedEntityData->defaultGeometryFileIdx = entityData->defaultGeometryFileIdx;
+            clonedEntityData->defaultLodName = entityData->defaultLodName;
+            return clonedEntityData;
+        }
+
         //-----------------------------------------------------------------------------
         void loadSimulationCacheLib(glm::crowdio::SimulationCacheLibrary& simuCacheLibrary, const glm::GlmString& cacheLibPath)
         {
@@ -1623,12 +1933,66 @@ namespace glm
             }
         }
 
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_InitPropertyInfos()
+        {
+            _skinMeshEntityPropertyInfos = *_skinMeshEntityProperties;
+            _skinMeshPropertyInfos = *_skinMeshProperties;
+
+            if (_params.glmDisplayMode == GolaemDisplayMode::SKINMESH && _params.glmExtentsMode == GolaemExtentsMode::DEFORMED_POINTS)
+            {
+                // extents are computed from the deformed points at each frame
+                _skinMeshEntityPropertyInfos[_skinMeshEntityPropertyTokens->extentsHint].isAnimated = true;
+                _skinMeshPropertyInfos[_skinMeshPropertyTokens->extent].isAnimated = true;
+            }
+
+            if (_params.glmHalfPrecision)
+            {
+                // normals and velocities are stored and output as half
+                _PrimPropertyInfo& normalsInfo = _skinMeshPropertyInfos[_skinMeshPropertyTokens->normals];
+                normalsInfo.defaultValue = VtValue(VtVec3hArray());
+                normalsInfo.typeName = SdfSchema::GetInstance().FindType(TfType::Find<VtVec3hArray>(), SdfValueRoleNames->Normal).GetAsToken();
+                _PrimPropertyInfo& velocitiesInfo = _skinMeshPropertyInfos[_skinMeshPropertyTokens->velocities];
+                velocitiesInfo.defaultValue = VtValue(VtVec3hArray());
+                velocitiesInfo.typeName = SdfSchema::GetInstance().FindType(TfType::Find<VtVec3hArray>(), SdfValueRoleNames->Vector).GetAsToken();
+            }
+
+            if (_params.glmNormalsMode == GolaemNormalsMode::VERTEX)
+            {
+                _skinMeshPropertyInfos[_skinMeshPropertyTokens->normals].interpolation = UsdGeomTokens->vertex;
+            }
+            else if (_params.glmNormalsMode == GolaemNormalsMode::NONE)
+            {
+                // subdivisionScheme stays none, the renderer computes the normals without subdividing the meshes
+                _skinMeshPropertyInfos.erase(_skinMeshPropertyTokens->normals);
+            }
+
+            // keep the token order, only list the properties that exist with these params
+            _skinMeshEntityPropertyNames.clear();
+            for (const TfToken& propertyName : _skinMeshEntityPropertyTokens->allTokens)
+            {
+                if (_skinMeshEntityPropertyInfos.find(propertyName) != _skinMeshEntityPropertyInfos.end())
+                {
+                    _skinMeshEntityPropertyNames.push_back(propertyName);
+                }
+            }
+            _skinMeshPropertyNames.clear();
+            for (const TfToken& propertyName : _skinMeshPropertyTokens->allTokens)
+            {
+                if (_skinMeshPropertyInfos.find(propertyName) != _skinMeshPropertyInfos.end())
+                {
+                    _skinMeshPropertyNames.push_back(propertyName);
+                }
+            }
+        }
+
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::_InitFromParams()
         {
 #ifdef TRACY_ENABLE
             ZoneScopedNC("InitFromParams", GLM_COLOR_CACHE);
 #endif
+            DebugPhaseTimer phaseTimer("InitFromParams");
 
             _startFrame = INT_MAX;
             _endFrame = INT_MIN;
@@ -1640,6 +2004,7 @@ namespace glm
             glm::crowdio::SimulationCacheLibrary simuCacheLibrary;
             findDirmappedFile(correctedFilePath, _params.glmCacheLibFile.GetText(), dirmapRules);
             loadSimulationCacheLib(simuCacheLibrary, correctedFilePath);
+            phaseTimer.phase("cache library");
 
             glm::GlmString cfNames;
             glm::GlmString cacheName;
@@ -1703,6 +2068,7 @@ namespace glm
             }
 
             float renderPercent = _params.glmRenderPercent * 0.01f;
+            GolaemRenderPercentMode::Value renderPercentMode = (GolaemRenderPercentMode::Value)_params.glmRenderPercentMode;
 
             // terrain file
             glm::Array<glm::GlmString> crowdFieldNames = glm::stringToStringArray(cfNames.c_str(), ";");
@@ -1737,6 +2103,7 @@ namespace glm
             }
 
             _factory->loadGolaemCharacters(characterFiles.c_str());
+            phaseTimer.phase("characters");
 
             glm::Array<glm::GlmString> layoutFilesArray = glm::stringToStringArray(layoutFiles, ";");
             size_t layoutCount = layoutFilesArray.size();
@@ -1773,11 +2140,53 @@ namespace glm
                 destTerrain = sourceTerrain;
             }
             _factory->setTerrainMeshes(sourceTerrain, destTerrain);
+            phaseTimer.phase("layout and terrain");
 
             // dirmap cache dir
             findDirmappedFile(correctedFilePath, cacheDir, dirmapRules);
             cacheDir = correctedFilePath;
 
+            // baked geometry files, used instead of deforming the meshes when they contain the entity frame
+            _bakedGeometryReader.close();
+            if (displayMode == GolaemDisplayMode::SKINMESH && !_params.glmBakedGeometryFiles.IsEmpty())
+            {
+                if (_params.glmLodMode == 2)
+                {
+                    GLM_CROWD_TRACE_WARNING("Baked geometry files are ignored in dynamic lod mode");
+                }
+                else
+                {
+                    std::vector<std::string> bakedGeometryPaths;
+                    glm::Array<glm::GlmString> bakedGeometryFiles = glm::stringToStringArray(_params.glmBakedGeometryFiles.GetText(), ";");
+                    for (const glm::GlmString& bakedGeometryFile : bakedGeometryFiles)
+                    {
+                        findDirmappedFile(correctedFilePath, bakedGeometryFile, dirmapRules);
+                        bakedGeometryPaths.push_back(correctedFilePath.c_str());
+                    }
+                    size_t bakedFileCount = _bakedGeometryReader.open(bakedGeometryPaths, GetGeometryParamsHash());
+                    TF_DEBUG(GOLAEMUSD_CACHE).Msg("[GolaemUSD] %zu baked geometry files opened\n", bakedFileCount);
+                }
+            }
+
+            // read-through geometry cache, computed entity frames are written to disk for the next sessions
+            _geometryDiskCache.close();
+            if (displayMode == GolaemDisplayMode::SKINMESH && !_params.glmGeometryCacheDir.IsEmpty())
+            {
+                if (_params.glmLodMode == 2)
+                {
+                    GLM_CROWD_TRACE_WARNING("The geometry cache is disabled in dynamic lod mode");
+                }
+                else
+                {
+                    findDirmappedFile(correctedFilePath, _params.glmGeometryCacheDir.GetText(), dirmapRules);
+                    uint64_t maxSize = static_cast<uint64_t>(std::max(_params.glmGeometryCacheMaxSize, 0.f) * 1024.0 * 1024.0 * 1024.0); // in GB
+                    double maxAge = std::max(_params.glmGeometryCacheMaxAge, 0.f) * 24.0 * 3600.0;                                         // in days
+                    _geometryDiskCache.open(correctedFilePath.c_str(), GetGeometryParamsHash(), _params.glmHalfPrecision, maxSize, maxAge);
+                    TF_DEBUG(GOLAEMUSD_CACHE).Msg("[GolaemUSD] geometry cache '%s' %s\n", correctedFilePath.c_str(), _geometryDiskCache.isOpen() ? "opened" : "could not be opened");
+                }
+            }
+            phaseTimer.phase("geometry caches");
+
             glm::Array<std::pair<int, int>> frameRangesPerCrowdField;
 
             // force creating the simulation data (might change golaem characters if there is a CreateEntity node)
@@ -1810,6 +2219,7 @@ namespace glm
                     }
                 }
             }
+            phaseTimer.phase("simulation data");
 
             // Layer always has a root spec that is the default prim of the layer.
             _primSpecPaths.insert(_GetRootPrimPath());
@@ -1818,6 +2228,7 @@ namespace glm
             _sgToSsPerChar.resize(_factory->getGolaemCharacters().size());
             _snsIndicesPerChar.resize(_factory->getGolaemCharacters().size());
             _jointsPerChar.resize(_factory->getGolaemCharacters().size());
+            _fatherBoneIndicesPerChar.resize(_factory->getGolaemCharacters().size());
             for (int iChar = 0, charCount = _factory->getGolaemCharacters().sizeInt(); iChar < charCount; ++iChar)
             {
                 const glm::GolaemCharacter* character = _factory->getGolaemCharacter(iChar);
@@ -1841,6 +2252,8 @@ namespace glm
                 PODArray<int>& characterSnsIndices = _snsIndicesPerChar[iChar];
                 VtTokenArray& characterJoints = _jointsPerChar[iChar];
                 characterJoints.resize(character->_converterMapping._skeletonDescription->getBones().size());
+                PODArray<int>& characterFatherBoneIndices = _fatherBoneIndicesPerChar[iChar];
+                characterFatherBoneIndices.resize(character->_converterMapping._skeletonDescription->getBones().size(), -1);
                 GlmString boneNameWithHierarchy;
                 for (int iBone = 0, boneCount = character->_converterMapping._skeletonDescription->getBones().sizeInt(); iBone < boneCount; ++iBone)
                 {
@@ -1858,6 +2271,10 @@ namespace glm
                         boneNameWithHierarchy = TfMakeValidIdentifier(parentBone->getName().c_str()) + "/" + boneNameWithHierarchy;
                     }
                     characterJoints[iBone] = TfToken(boneNameWithHierarchy.c_str());
+                    if (bone->getFather() != NULL)
+                    {
+                        characterFatherBoneIndices[iBone] = bone->getFather()->getSpecificBoneIndex();
+                    }
                 }
             }
 
@@ -1963,8 +2380,29 @@ namespace glm
                 templateData->faceVertexIndices.push_back(4);
             }
 
+            phaseTimer.phase("characters and mesh templates");
+
             glm::IdsFilter entityIdsFilter(_params.glmEntityIds.GetText());
 
+            // only the entities of these tiles are loaded, all tiles if empty
+            TfToken::HashSet tilesFilter;
+            if (_params.glmTileSize <= 0 && !_params.glmTiles.IsEmpty())
+            {
+                GLM_CROWD_TRACE_WARNING("glmTiles '" << _params.glmTiles.GetText() << "' is ignored, glmTileSize must be greater than 0");
+            }
+            if (_params.glmTileSize > 0)
+            {
+                glm::Array<glm::GlmString> tileNames = glm::stringToStringArray(_params.glmTiles.GetText(), ";");
+                for (size_t iTile = 0, tileCount = tileNames.size(); iTile < tileCount; ++iTile)
+                {
+                    tilesFilter.insert(TfToken(tileNames[iTile].c_str()));
+                }
+            }
+
+            // only the entities entering one of these boxes are loaded
+            std::vector<GfRange3f> regionBoxes;
+            parseRegionOfInterest(_params.glmRegionOfInterest.GetText(), regionBoxes);
+
             TfToken skelAnimName("SkelAnim");
             TfToken animationsGroupName("Animations");
             GlmString meshVariantEnable("Enable");
@@ -2038,10 +2476,32 @@ namespace glm
                 const glm::Array<glm::PODArray<int>>& entityAssets = cachedSimulation.getFinalEntityAssets(frameRange.first);
 
                 // create lock for cached simulation
-                glm::Mutex* cachedSimulationLock = new glm::Mutex();
+                ProfiledMutex* cachedSimulationLock = new ProfiledMutex(LockStats::CACHED_SIMULATION);
                 _cachedSimulationLocks[iCf] = cachedSimulationLock;
 
                 size_t maxEntities = (size_t)floorf(simuData->_entityCount * renderPercent);
+                glm::PODArray<uint8_t> keptEntities;
+                if (renderPercentMode == GolaemRenderPercentMode::SCREEN_SIZE)
+                {
+                    _ComputeScreenSpaceThinning(simuData, cachedSimulation.getFinalFrameData(frameRange.first, UINT32_MAX, true), renderPercent, keptEntities);
+                }
+
+                // spatial tiling: entities are grouped in tile prims under the crowd field
+                glm::Array<TfToken> entityTileNames;
+                if (_params.glmTileSize > 0)
+                {
+                    glm::GlmString tilesCacheKey = cacheDir + "/" + cacheName + "." + glmCfName;
+                    tilesCacheKey += ";" + (enableLayout ? layoutFiles : glm::GlmString()) + ";" + dstTerrainFile;
+                    tilesCacheKey += ";" + glm::toString(_params.glmTileSize) + ";" + glm::toString(_params.glmTileMode);
+                    tilesCacheKey += ";" + glm::toString(frameRange.first) + ":" + glm::toString(frameRange.second);
+                    _ComputeEntityTiles(cachedSimulation, frameRange, tilesCacheKey.c_str(), entityTileNames);
+                }
+
+                glm::PODArray<uint8_t> entitiesInRegion;
+                if (!regionBoxes.empty())
+                {
+                    _ComputeEntitiesInRegion(cachedSimulation, frameRange, regionBoxes, entitiesInRegion);
+                }
                 for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
                 {
                     int64_t entityId = simuData->_entityIds[iEntity];
@@ -2057,6 +2517,18 @@ namespace glm
                         continue;
                     }
 
+                    if (!tilesFilter.empty() && tilesFilter.find(entityTileNames[iEntity]) == tilesFilter.end())
+                    {
+                        // entity tile is not loaded
+                        continue;
+                    }
+
+                    if (!regionBoxes.empty() && entitiesInRegion[iEntity] == 0)
+                    {
+                        // entity never enters the region of interest
+                        continue;
+                    }
+
                     const glm::crowdio::GlmFrameData* firstFrameData = cachedSimulation.getFinalFrameData(frameRange.first, UINT32_MAX, true);
 
                     int32_t entityToBakeIndex = simuData->_entityToBakeIndex[iEntity];
@@ -2071,9 +2543,21 @@ namespace glm
 
                     glm::GlmString entityName = "Entity_" + glm::toString(entityId);
                     TfToken entityNameToken = TfToken(entityName.c_str());
-                    SdfPath entityPath = cfPath.AppendChild(entityNameToken);
+                    SdfPath entityParentPath = cfPath;
+                    std::vector<TfToken>* entityParentChildNames = &cfChildNames;
+                    if (!entityTileNames.empty())
+                    {
+                        const TfToken& tileName = entityTileNames[iEntity];
+                        entityParentPath = cfPath.AppendChild(tileName);
+                        if (_primSpecPaths.insert(entityParentPath).second)
+                        {
+                            cfChildNames.push_back(tileName);
+                        }
+                        entityParentChildNames = &_primChildNames[entityParentPath];
+                    }
+                    SdfPath entityPath = entityParentPath.AppendChild(entityNameToken);
                     _primSpecPaths.insert(entityPath);
-                    cfChildNames.push_back(entityNameToken);
+                    entityParentChildNames->push_back(entityNameToken);
 
                     EntityData::SP entityData = NULL;
                     SkelEntityData::SP skelEntityData = NULL;
@@ -2111,7 +2595,14 @@ namespace glm
 
                     entityData->cachedSimulation = &cachedSimulation;
 
-                    entityData->excluded = iEntity >= maxEntities;
+                    if (renderPercentMode == GolaemRenderPercentMode::SCREEN_SIZE)
+                    {
+                        entityData->excluded = keptEntities[iEntity] == 0;
+                    }
+                    else
+                    {
+                        entityData->excluded = iEntity >= maxEntities;
+                    }
                     entityData->entityPath = entityPath;
 
                     if (entityData->excluded)
@@ -2390,6 +2881,9 @@ namespace glm
                 }
             }
 
+            phaseTimer.phase("entities");
+            TF_DEBUG(GOLAEMUSD_INIT).Msg("[GolaemUSD] InitFromParams: %zu entities, %zu prim specs\n", _entityDataMap.size(), _primSpecPaths.size());
+
             if (_startFrame <= _endFrame)
             {
                 for (int currentFrame = _startFrame; currentFrame <= _endFrame; ++currentFrame)
@@ -2408,6 +2902,8 @@ namespace glm
             const glm::PODArray<int>& gchaMeshIds,
             const glm::PODArray<int>& meshAssetMaterialIndices)
         {
+            // mesh names already used under parentPath when flattening the hierarchy
+            TfToken::HashSet flatMeshNames;
             for (size_t iMesh = 0, meshCount = gchaMeshIds.size(); iMesh < meshCount; ++iMesh)
             {
                 const auto& itMesh = templateDataPerMesh.find({gchaMeshIds[iMesh], meshAssetMaterialIndices[iMesh]});
@@ -2418,8 +2914,16 @@ namespace glm
                 SkinMeshTemplateData::SP meshTemplateData = itMesh->second;
                 entityData->computeVelocities = entityData->computeVelocities || meshTemplateData->velocitiesIntShaderAttributeIndex >= 0;
 
-                GlmMap<GlmString, SdfPath> meshTreePaths;
-                SdfPath lastMeshTransformPath = _CreateHierarchyFor(meshTemplateData->meshAlias, parentPath, meshTreePaths);
+                SdfPath lastMeshTransformPath;
+                if (_params.glmFlattenHierarchy)
+                {
+                    lastMeshTransformPath = _CreateFlatPathFor(meshTemplateData->meshAlias, parentPath, flatMeshNames);
+                }
+                else
+                {
+                    GlmMap<GlmString, SdfPath> meshTreePaths;
+                    lastMeshTransformPath = _CreateHierarchyFor(meshTemplateData->meshAlias, parentPath, meshTreePaths);
+                }
 
                 SkinMeshMapData& meshMapData = _skinMeshDataMap[lastMeshTransformPath];
                 meshMapData.lodIndex = lodIndex;
@@ -2482,7 +2986,7 @@ namespace glm
             else
             {
                 // Check that it's one of our animated property names.
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshEntityProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshEntityPropertyInfos, nameToken))
                 {
                     if (TfMapLookupPtr(_entityDataMap, primPath) != NULL)
                     {
@@ -2496,7 +3000,7 @@ namespace glm
                         return propInfo->isAnimated;
                     }
                 }
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshPropertyInfos, nameToken))
                 {
                     if (TfMapLookupPtr(_skinMeshDataMap, primPath) != NULL)
                     {
@@ -2539,6 +3043,7 @@ namespace glm
                     }
                     return true;
                 }
+                return _GetStatsAttributeValue(nameToken, value);
             }
 
             // Check that it belongs to a leaf prim before getting the default value
@@ -2630,7 +3135,7 @@ namespace glm
             }
             else
             {
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshEntityProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshEntityPropertyInfos, nameToken))
                 {
                     if (const EntityData::SP* entityDataPtr = TfMapLookupPtr(_entityDataMap, primPath))
                     {
@@ -2676,7 +3181,7 @@ namespace glm
 
                     return false;
                 }
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshPropertyInfos, nameToken))
                 {
                     // Check that it belongs to a leaf prim before getting the default value
                     if (const SkinMeshMapData* meshMapData = TfMapLookupPtr(_skinMeshDataMap, primPath))
@@ -2689,7 +3194,14 @@ namespace glm
                             }
                             else if (nameToken == _skinMeshPropertyTokens->normals)
                             {
-                                *value = VtValue(meshMapData->templateData->defaultNormals);
+                                if (_params.glmHalfPrecision)
+                                {
+                                    *value = VtValue(meshMapData->templateData->defaultHalfNormals);
+                                }
+                                else
+                                {
+                                    *value = VtValue(meshMapData->templateData->defaultNormals);
+                                }
                             }
                             else if (nameToken == _skinMeshPropertyTokens->faceVertexCounts)
                             {
@@ -2713,7 +3225,19 @@ namespace glm
                                 {
                                     return false;
                                 }
-                                *value = VtValue(meshMapData->templateData->defaultVelocities);
+                                if (_params.glmHalfPrecision)
+                                {
+                                    *value = VtValue(meshMapData->templateData->defaultHalfVelocities);
+                                }
+                                else
+                                {
+                                    *value = VtValue(meshMapData->templateData->defaultVelocities);
+                                }
+                            }
+                            else if (nameToken == _skinMeshPropertyTokens->extent)
+                            {
+                                // conservative extent from the character, no geometry compute needed
+                                *value = VtValue(VtVec3fArray({-meshMapData->entityData->extent, meshMapData->entityData->extent}));
                             }
                             else
                             {
@@ -2843,7 +3367,7 @@ namespace glm
             }
             else
             {
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshPropertyInfos, nameToken))
                 {
                     // Check that it belongs to a leaf prim before getting the interpolation value
                     if (TfMapLookupPtr(_skinMeshDataMap, primPath) != NULL)
@@ -2865,34 +3389,343 @@ namespace glm
         }
 
         //-----------------------------------------------------------------------------
-        bool GolaemUSD_DataImpl::_HasPropertyTypeNameValue(const SdfPath& path, VtValue* value) const
+        bool GolaemUSD_DataImpl::_GetStatsAttributeValue(const TfToken& nameToken, VtValue* value) const
         {
-            // Check that it is a property id.
-            if (!path.IsPrimPropertyPath())
+            const int* counter = TfMapLookupPtr(_statsAttributes, nameToken);
+            if (counter == NULL)
             {
                 return false;
             }
-
-            // Check that it is one of our property names.
-            const TfToken& nameToken = path.GetNameToken();
-            SdfPath primPath = path.GetAbsoluteRootOrPrimPath();
-
-            if (primPath == _GetRootPrimPath())
+            if (value)
             {
-                if (const VtValue* usdValue = TfMapLookupPtr(_usdParams, nameToken))
+                // the frame cache size is only computed when it is queried, the lock stats are shared by all the layers
+                int64_t counterValue = 0;
+                if (*counter < 0)
                 {
-                    RETURN_TRUE_WITH_OPTIONAL_VALUE(SdfSchema::GetInstance().FindType(*usdValue).GetAsToken());
+                    counterValue = _GetFrameCacheSize();
                 }
+                else if (*counter >= RuntimeStats::COUNTER_COUNT)
+                {
+                    int lockValue = *counter - RuntimeStats::COUNTER_COUNT;
+                    counterValue = LockStats::get(static_cast<LockStats::LockClass>(lockValue / LockStats::VALUE_COUNT), static_cast<LockStats::Value>(lockValue % LockStats::VALUE_COUNT));
+                }
+                else
+                {
+                    counterValue = _stats.get(static_cast<RuntimeStats::Counter>(*counter));
+                }
+                *value = VtValue(counterValue);
             }
+            return true;
+        }
 
-            if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
+        //-----------------------------------------------------------------------------
+        int64_t GolaemUSD_DataImpl::_GetFrameCacheSize() const
+        {
+            // arrays shared by several frames are counted once per frame, arrays of baked frames are not counted as they are mapped files
+            int64_t frameCacheSize = 0;
+            for (const auto& itEntityData : _entityDataMap)
             {
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skelEntityProperties, nameToken))
+                const EntityData::SP& entityData = itEntityData.second;
+                glm::ScopedLock<ProfiledMutex> entityComputeLock(*entityData->entityComputeLock);
+                for (auto itFrameData = entityData->frameDataMap.begin(); itFrameData != entityData->frameDataMap.end(); ++itFrameData)
                 {
-                    // Check that it belongs to a leaf prim before getting the type name value
-                    if (TfMapLookupPtr(_entityDataMap, primPath) != NULL)
+                    const EntityFrameData* entityFrameData = itFrameData.getValue().getImpl();
+                    frameCacheSize += entityFrameData->intShaderAttrValues.size() * sizeof(int) + entityFrameData->floatShaderAttrValues.size() * sizeof(float);
+                    frameCacheSize += entityFrameData->stringShaderAttrValues.size() * sizeof(TfToken) + entityFrameData->vectorShaderAttrValues.size() * sizeof(GfVec3f);
+                    frameCacheSize += entityFrameData->floatPPAttrValues.size() * sizeof(float) + entityFrameData->vectorPPAttrValues.size() * sizeof(GfVec3f);
+                    if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
                     {
-                        RETURN_TRUE_WITH_OPTIONAL_VALUE(propInfo->typeName);
+                        const SkelEntityFrameData* skelEntityFrameData = static_cast<const SkelEntityFrameData*>(itFrameData.getValue().getImpl());
+                        frameCacheSize += skelEntityFrameData->rotations.size() * sizeof(GfQuatf);
+                        frameCacheSize += skelEntityFrameData->scales.size() * sizeof(GfVec3h);
+                        frameCacheSize += skelEntityFrameData->translations.size() * sizeof(GfVec3f);
+                        continue;
+                    }
+                    const SkinMeshEntityFrameData* skinMeshEntityFrameData = static_cast<const SkinMeshEntityFrameData*>(itFrameData.getValue().getImpl());
+                    if (skinMeshEntityFrameData->baked)
+                    {
+                        continue;
+                    }
+                    for (const SkinMeshLodData::SP& lodData : skinMeshEntityFrameData->meshLodData)
+                    {
+                        for (const auto& itMeshData : lodData->meshData)
+                        {
+                            const SkinMeshData::SP& meshData = itMeshData.second;
+                            frameCacheSize += (meshData->points.size() + meshData->normals.size() + meshData->velocities.size()) * sizeof(GfVec3f);
+                            frameCacheSize += (meshData->halfNormals.size() + meshData->halfVelocities.size()) * sizeof(GfVec3h);
+                            frameCacheSize += meshData->compressedPoints.getMemorySize() + meshData->compressedNormals.getMemorySize();
+                        }
+                    }
+                }
+            }
+            return frameCacheSize;
+        }
+
+        //-----------------------------------------------------------------------------
+        // copies a string to a fixed size buffer, truncated and null terminated
+        static void copyTruncatedString(const std::string& str, char* buffer, size_t bufferSize)
+        {
+            if (bufferSize == 0)
+            {
+                return;
+            }
+            size_t length = std::min(str.size(), bufferSize - 1);
+            memcpy(buffer, str.c_str(), length);
+            buffer[length] = '\0';
+        }
+
+        //-----------------------------------------------------------------------------
+        static std::string formatMemoryUsageReport(const LayerMemoryUsage& memoryUsage)
+        {
+            const double MB = 1024.0 * 1024.0;
+            std::string report = TfStringPrintf("  %s (cache %s, crowd fields %s): %.1f MB\n", memoryUsage.proceduralFile, memoryUsage.cacheName, memoryUsage.crowdFields, memoryUsage.getTotal() / MB);
+            report += TfStringPrintf("    spec index            %10.1f MB\n", memoryUsage.specIndex / MB);
+            report += TfStringPrintf("    entity tables         %10.1f MB\n", memoryUsage.entityTables / MB);
+            report += TfStringPrintf("    attribute tables      %10.1f MB\n", memoryUsage.attributeTables / MB);
+            report += TfStringPrintf("    skin mesh templates   %10.1f MB\n", memoryUsage.skinMeshTemplates / MB);
+            uint32_t templatesCount = std::min<uint32_t>(memoryUsage.skinMeshTemplatesCount, static_cast<uint32_t>(LayerMemoryUsage::MAX_SKIN_MESH_TEMPLATES));
+            for (uint32_t iTemplates = 0; iTemplates < templatesCount; ++iTemplates)
+            {
+                const LayerMemoryUsage::SkinMeshTemplates& templatesUsage = memoryUsage.skinMeshTemplatesPerCharacterAndLod[iTemplates];
+                report += TfStringPrintf("      %s lod %d: %llu meshes %10.1f MB\n", templatesUsage.characterFile, templatesUsage.geometryFileIdx, static_cast<unsigned long long>(templatesUsage.meshCount), templatesUsage.bytes / MB);
+            }
+            if (memoryUsage.skinMeshTemplatesCount > templatesCount)
+            {
+                report += TfStringPrintf("      %u more characters and lods\n", memoryUsage.skinMeshTemplatesCount - templatesCount);
+            }
+            report += TfStringPrintf("    frame cache           %10.1f MB\n", memoryUsage.frameCache / MB);
+            report += TfStringPrintf("    simulation frame data %10.1f MB\n", memoryUsage.simulationFrameData / MB);
+            return report;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::GetMemoryUsage(LayerMemoryUsage& memoryUsage) const
+        {
+            // approximate overhead of a node in the hash tables and maps
+            static const size_t HASH_NODE_SIZE = 2 * sizeof(void*);
+            static const size_t MAP_NODE_SIZE = 4 * sizeof(void*);
+
+            memset(&memoryUsage, 0, sizeof(LayerMemoryUsage));
+            memoryUsage.version = LayerMemoryUsage::VERSION;
+            copyTruncatedString(_params.glmProceduralFile.GetString(), memoryUsage.proceduralFile, sizeof(memoryUsage.proceduralFile));
+            copyTruncatedString(_params.glmCacheName.GetString(), memoryUsage.cacheName, sizeof(memoryUsage.cacheName));
+            copyTruncatedString(_params.glmCrowdFields.GetString(), memoryUsage.crowdFields, sizeof(memoryUsage.crowdFields));
+
+            // spec index, the path nodes are shared by all the layers and not counted
+            memoryUsage.specIndex += _primSpecPaths.size() * (sizeof(SdfPath) + HASH_NODE_SIZE);
+            for (const auto& itChildNames : _primChildNames)
+            {
+                memoryUsage.specIndex += sizeof(SdfPath) + sizeof(std::vector<TfToken>) + HASH_NODE_SIZE + itChildNames.second.capacity() * sizeof(TfToken);
+            }
+            memoryUsage.specIndex += _animTimeSampleTimes.size() * (sizeof(double) + MAP_NODE_SIZE);
+
+            // entity tables and the attribute indices of the entities
+            for (const auto& itEntityData : _entityDataMap)
+            {
+                const EntityData::SP& entityData = itEntityData.second;
+                memoryUsage.entityTables += sizeof(SdfPath) + sizeof(EntityData::SP) + HASH_NODE_SIZE;
+                if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
+                {
+                    memoryUsage.entityTables += sizeof(SkelEntityData);
+                }
+                else
+                {
+                    const SkinMeshEntityData* skinMeshEntityData = static_cast<const SkinMeshEntityData*>(entityData.getImpl());
+                    memoryUsage.entityTables += sizeof(SkinMeshEntityData) + skinMeshEntityData->lodEnabled.size() * sizeof(int);
+                }
+                memoryUsage.attributeTables += (entityData->ppAttrIndexes.size() + entityData->shaderAttrIndexes.size()) * (sizeof(TfToken) + sizeof(size_t) + MAP_NODE_SIZE);
+            }
+            memoryUsage.entityTables += _skinMeshDataMap.size() * (sizeof(SdfPath) + sizeof(SkinMeshMapData) + HASH_NODE_SIZE);
+            memoryUsage.entityTables += _skinMeshLodDataMap.size() * (sizeof(SdfPath) + sizeof(SkinMeshLodMapData) + HASH_NODE_SIZE);
+            memoryUsage.entityTables += _skelAnimDataMap.size() * (sizeof(SdfPath) + sizeof(SkelEntityData::SP) + HASH_NODE_SIZE);
+
+            // attribute and character tables
+            for (size_t iChar = 0, charCount = _jointsPerChar.size(); iChar < charCount; ++iChar)
+            {
+                memoryUsage.attributeTables += _jointsPerChar[iChar].size() * sizeof(TfToken);
+            }
+            for (size_t iChar = 0, charCount = _sgToSsPerChar.size(); iChar < charCount; ++iChar)
+            {
+                memoryUsage.attributeTables += _sgToSsPerChar[iChar].size() * sizeof(int);
+            }
+            for (size_t iChar = 0, charCount = _snsIndicesPerChar.size(); iChar < charCount; ++iChar)
+            {
+                memoryUsage.attributeTables += _snsIndicesPerChar[iChar].size() * sizeof(int);
+            }
+            for (size_t iChar = 0, charCount = _fatherBoneIndicesPerChar.size(); iChar < charCount; ++iChar)
+            {
+                memoryUsage.attributeTables += _fatherBoneIndicesPerChar[iChar].size() * sizeof(int);
+            }
+            for (size_t iChar = 0, charCount = _globalToSpecificShaderAttrIdxPerChar.size(); iChar < charCount; ++iChar)
+            {
+                memoryUsage.attributeTables += _globalToSpecificShaderAttrIdxPerChar[iChar].size() * sizeof(size_t);
+            }
+
+            // skin mesh templates, per character and geometry file
+            glm::Array<glm::GlmString> characterFiles;
+            split(glm::GlmString(_params.glmCharacterFiles.GetText()), ";", characterFiles);
+            for (size_t iChar = 0, charCount = _skinMeshTemplateDataPerCharPerGeomFile.size(); iChar < charCount; ++iChar)
+            {
+                const glm::Array<std::map<std::pair<int, int>, SkinMeshTemplateData::SP>>& templatesPerGeomFile = _skinMeshTemplateDataPerCharPerGeomFile[iChar];
+                for (size_t iGeomFile = 0, geomFileCount = templatesPerGeomFile.size(); iGeomFile < geomFileCount; ++iGeomFile)
+                {
+                    const std::map<std::pair<int, int>, SkinMeshTemplateData::SP>& templates = templatesPerGeomFile[iGeomFile];
+                    if (templates.empty())
+                    {
+                        continue;
+                    }
+                    LayerMemoryUsage::SkinMeshTemplates templatesUsage;
+                    memset(&templatesUsage, 0, sizeof(templatesUsage));
+                    templatesUsage.characterIdx = static_cast<int32_t>(iChar);
+                    copyTruncatedString(iChar < characterFiles.size() ? characterFiles[iChar].c_str() : "", templatesUsage.characterFile, sizeof(templatesUsage.characterFile));
+                    templatesUsage.geometryFileIdx = static_cast<int32_t>(iGeomFile);
+                    templatesUsage.meshCount = templates.size();
+                    for (const auto& itTemplate : templates)
+                    {
+                        const SkinMeshTemplateData::SP& templateData = itTemplate.second;
+                        templatesUsage.bytes += sizeof(SkinMeshTemplateData) + MAP_NODE_SIZE;
+                        templatesUsage.bytes += (templateData->faceVertexCounts.size() + templateData->faceVertexIndices.size()) * sizeof(int);
+                        for (size_t iUvSet = 0, uvSetCount = templateData->uvSets.size(); iUvSet < uvSetCount; ++iUvSet)
+                        {
+                            templatesUsage.bytes += templateData->uvSets[iUvSet].size() * sizeof(GfVec2f);
+                        }
+                        templatesUsage.bytes += (templateData->defaultPoints.size() + templateData->defaultNormals.size() + templateData->defaultVelocities.size()) * sizeof(GfVec3f);
+                        templatesUsage.bytes += (templateData->defaultHalfNormals.size() + templateData->defaultHalfVelocities.size()) * sizeof(GfVec3h);
+                    }
+                    memoryUsage.skinMeshTemplates += templatesUsage.bytes;
+                    if (memoryUsage.skinMeshTemplatesCount < LayerMemoryUsage::MAX_SKIN_MESH_TEMPLATES)
+                    {
+                        memoryUsage.skinMeshTemplatesPerCharacterAndLod[memoryUsage.skinMeshTemplatesCount] = templatesUsage;
+                    }
+                    ++memoryUsage.skinMeshTemplatesCount;
+                }
+            }
+
+            memoryUsage.frameCache = static_cast<uint64_t>(_GetFrameCacheSize());
+
+            // simulation frames used by the entities, the sizes are estimated from the simulation data layout
+            std::map<const glm::crowdio::GlmSimulationData*, uint64_t> frameSizePerSimuData;
+            std::set<const glm::crowdio::GlmFrameData*> frameDatas;
+            for (const auto& itEntityData : _entityDataMap)
+            {
+                const EntityData::SP& entityData = itEntityData.second;
+                const glm::crowdio::GlmSimulationData* simuData = entityData->inputGeoData._simuData;
+                if (simuData == NULL)
+                {
+                    continue;
+                }
+                const glm::crowdio::GlmFrameData* frameData = NULL;
+                {
+                    glm::ScopedLock<ProfiledMutex> entityComputeLock(*entityData->entityComputeLock);
+                    frameData = entityData->inputGeoData._frameDatas.size() == 0 ? NULL : entityData->inputGeoData._frameDatas[0];
+                }
+                if (frameData == NULL || !frameDatas.insert(frameData).second)
+                {
+                    continue;
+                }
+                auto itFrameSize = frameSizePerSimuData.find(simuData);
+                if (itFrameSize == frameSizePerSimuData.end())
+                {
+                    uint64_t boneCount = 0, snsCount = 0;
+                    for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+                    {
+                        uint16_t entityType = simuData->_entityTypes[iEntity];
+                        boneCount += simuData->_boneCount[entityType];
+                        snsCount += simuData->_snsCountPerEntityType[entityType];
+                    }
+                    uint64_t frameSize = boneCount * 7 * sizeof(float) + snsCount * 4 * sizeof(float);
+                    frameSize += simuData->_entityCount * (sizeof(uint8_t) + simuData->_ppFloatAttributeCount * sizeof(float) + simuData->_ppVectorAttributeCount * 3 * sizeof(float));
+                    itFrameSize = frameSizePerSimuData.insert(std::make_pair(simuData, frameSize)).first;
+                }
+                memoryUsage.simulationFrameData += itFrameSize->second;
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_DebugMemoryUsage(const char* when) const
+        {
+            if (!TfDebug::IsEnabled(GOLAEMUSD_MEMORY))
+            {
+                return;
+            }
+            LayerMemoryUsage memoryUsage;
+            GetMemoryUsage(memoryUsage);
+            TF_DEBUG(GOLAEMUSD_MEMORY).Msg("[GolaemUSD] layer %s:\n%s", when, formatMemoryUsageReport(memoryUsage).c_str());
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_DebugMemoryUsagePeriodically() const
+        {
+            // checked at query time so that the debug code can also be enabled in a running session
+            int64_t time = RuntimeStats::now();
+            int64_t lastTime = _lastMemoryDebugTime.load(std::memory_order_relaxed);
+            if (time - lastTime < getMemoryDebugPeriod())
+            {
+                return;
+            }
+            // a single query thread logs it
+            if (_lastMemoryDebugTime.compare_exchange_strong(lastTime, time, std::memory_order_relaxed))
+            {
+                _DebugMemoryUsage("queried");
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t getLayerMemoryUsages(LayerMemoryUsage* memoryUsages, size_t capacity)
+        {
+            glm::ScopedLock<glm::Mutex> layersLock(s_layersLock);
+            size_t iLayer = 0;
+            for (const GolaemUSD_DataImpl* layer : s_layers)
+            {
+                if (iLayer == capacity)
+                {
+                    break;
+                }
+                layer->GetMemoryUsage(memoryUsages[iLayer++]);
+            }
+            return s_layers.size();
+        }
+
+        //-----------------------------------------------------------------------------
+        size_t formatLayerMemoryUsage(const LayerMemoryUsage& memoryUsage, char* buffer, size_t bufferSize)
+        {
+            std::string report = formatMemoryUsageReport(memoryUsage);
+            copyTruncatedString(report, buffer, bufferSize);
+            return report.size();
+        }
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_HasPropertyTypeNameValue(const SdfPath& path, VtValue* value) const
+        {
+            // Check that it is a property id.
+            if (!path.IsPrimPropertyPath())
+            {
+                return false;
+            }
+
+            // Check that it is one of our property names.
+            const TfToken& nameToken = path.GetNameToken();
+            SdfPath primPath = path.GetAbsoluteRootOrPrimPath();
+
+            if (primPath == _GetRootPrimPath())
+            {
+                if (const VtValue* usdValue = TfMapLookupPtr(_usdParams, nameToken))
+                {
+                    RETURN_TRUE_WITH_OPTIONAL_VALUE(SdfSchema::GetInstance().FindType(*usdValue).GetAsToken());
+                }
+                if (TfMapLookupPtr(_statsAttributes, nameToken) != NULL)
+                {
+                    RETURN_TRUE_WITH_OPTIONAL_VALUE(SdfValueTypeNames->Int64.GetAsToken());
+                }
+            }
+
+            if (_params.glmDisplayMode == GolaemDisplayMode::SKELETON)
+            {
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skelEntityProperties, nameToken))
+                {
+                    // Check that it belongs to a leaf prim before getting the type name value
+                    if (TfMapLookupPtr(_entityDataMap, primPath) != NULL)
+                    {
+                        RETURN_TRUE_WITH_OPTIONAL_VALUE(propInfo->typeName);
                     }
 
                     return false;
@@ -2937,7 +3770,7 @@ namespace glm
             }
             else
             {
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshEntityProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshEntityPropertyInfos, nameToken))
                 {
                     // Check that it belongs to a leaf prim before getting the type name value
                     if (TfMapLookupPtr(_entityDataMap, primPath) != NULL)
@@ -2957,7 +3790,7 @@ namespace glm
 
                     return false;
                 }
-                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(*_skinMeshProperties, nameToken))
+                if (const _PrimPropertyInfo* propInfo = TfMapLookupPtr(_skinMeshPropertyInfos, nameToken))
                 {
                     // Check that it belongs to a leaf prim before getting the type name value
                     if (TfMapLookupPtr(_skinMeshDataMap, primPath) != NULL)
@@ -3039,10 +3872,47 @@ namespace glm
             return _CreateHierarchyFor(childrenGroupsHierarchy, thisGroupPath, existingPaths);
         }
 
+        //-----------------------------------------------------------------------------
+        SdfPath GolaemUSD_DataImpl::_CreateFlatPathFor(const glm::GlmString& hierarchy, const SdfPath& parentPath, TfToken::HashSet& existingNames)
+        {
+            // ignore trailing separators, like _CreateHierarchyFor ignores empty groups
+            size_t hierarchyEnd = hierarchy.size();
+            while (hierarchyEnd > 0 && hierarchy[hierarchyEnd - 1] == '|')
+            {
+                --hierarchyEnd;
+            }
+            if (hierarchyEnd == 0)
+            {
+                return parentPath;
+            }
+
+            // only keep the last group of the hierarchy, the mesh is created right under parentPath
+            GlmString meshName = hierarchy.substr(0, hierarchyEnd);
+            size_t lastSlash = meshName.find_last_of('|');
+            if (lastSlash != GlmString::npos)
+            {
+                meshName = meshName.substr(lastSlash + 1);
+            }
+
+            // meshes from different groups may have the same name, make it unique
+            std::string validMeshName = TfMakeValidIdentifier(meshName.c_str());
+            TfToken meshToken(validMeshName);
+            for (int suffix = 1; existingNames.find(meshToken) != existingNames.end(); ++suffix)
+            {
+                meshToken = TfToken(validMeshName + "_" + std::to_string(suffix));
+            }
+            existingNames.insert(meshToken);
+
+            SdfPath meshPath = parentPath.AppendChild(meshToken);
+            _primSpecPaths.insert(meshPath);
+            _primChildNames[parentPath].push_back(meshToken);
+            return meshPath;
+        }
+
         //-----------------------------------------------------------------------------
         GolaemUSD_DataImpl::SkelEntityFrameData::SP GolaemUSD_DataImpl::_ComputeSkelEntity(EntityData::SP entityData, double frame)
         {
-            SkelEntityFrameData::SP skelEntityFrameData = entityData->getFrameData<SkelEntityFrameData>(frame, static_cast<size_t>(_params.glmCachedFramesCount));
+            SkelEntityFrameData::SP skelEntityFrameData = entityData->getFrameData<SkelEntityFrameData>(frame, static_cast<size_t>(_params.glmCachedFramesCount), _stats);
 
             if (skelEntityFrameData->entityData != nullptr)
             {
@@ -3052,6 +3922,9 @@ namespace glm
 
             // getFrameData returned a new SkelEntityFrameData, set entityData to mark it as computed
             skelEntityFrameData->entityData = entityData;
+            _stats.add(RuntimeStats::COMPUTED_ENTITIES);
+            RuntimeStats::ScopedTimer computeTimer(_stats, RuntimeStats::COMPUTE_ENTITY_TIME);
+            DebugSlowComputeTimer slowComputeTimer(entityData->inputGeoData._entityId, frame);
 
 #ifdef TRACY_ENABLE
             ZoneScopedNC("ComputeSkelEntity", GLM_COLOR_CACHE);
@@ -3066,12 +3939,16 @@ namespace glm
                 return skelEntityFrameData;
             }
 
+            // joints are still computed when the entity is culled, to keep the skel animation valid
+            skelEntityFrameData->culled = _params.glmFrustumCulling && _IsEntityCulled(entityData, skelEntityFrameData->pos);
+
             SkelEntityData* skelEntityData = static_cast<SkelEntityData*>(entityData.getImpl());
 
             const glm::crowdio::GlmFrameData* frameData = entityData->inputGeoData._frameDatas[0];
             const glm::crowdio::GlmSimulationData* simuData = entityData->inputGeoData._simuData;
 
             const PODArray<int>& characterSnsIndices = _snsIndicesPerChar[entityData->inputGeoData._characterIdx];
+            const PODArray<int>& characterFatherBoneIndices = _fatherBoneIndicesPerChar[entityData->inputGeoData._characterIdx];
 
             float entityScale = simuData->_scales[entityData->inputGeoData._entityIndex];
             uint16_t entityType = simuData->_entityTypes[entityData->inputGeoData._entityIndex];
@@ -3108,69 +3985,19 @@ namespace glm
                     specificBonesWorldScales[specificBoneIndex].setValues(snsCacheValues);
                 }
 
-                // here all scales are WORLD scales. Need to patch back local scales from there :
-                for (uint16_t iBone = 0; iBone < boneCount; ++iBone)
-                {
-                    GfVec3h& scaleValue = skelEntityFrameData->scales[iBone];
-
-                    const HierarchicalBone* currentBone = entityData->inputGeoData._character->_converterMapping._skeletonDescription->getBones()[iBone];
-                    const HierarchicalBone* fatherBone = currentBone->getFather();
-                    // skip scales parented to root, root holds the entityScale and cannot be SnS'ed
-                    if (fatherBone != NULL)
-                    {
-                        const Vector3& fatherScale = specificBonesWorldScales[fatherBone->getSpecificBoneIndex()];
-
-                        scaleValue[0] /= fatherScale[0];
-                        scaleValue[1] /= fatherScale[1];
-                        scaleValue[2] /= fatherScale[2];
-                    }
-                }
+                // here all scales are WORLD scales. Need to patch back local scales from there
+                computeLocalScales(characterFatherBoneIndices, specificBonesWorldScales, skelEntityFrameData->scales);
             }
 
-            for (size_t iBone = 0; iBone < boneCount; ++iBone)
-            {
-                size_t boneIndexInCache = specificToCacheBoneIndices[iBone];
-
-                const HierarchicalBone* currentBone = entityData->inputGeoData._character->_converterMapping._skeletonDescription->getBones()[iBone];
-                const HierarchicalBone* fatherBone = currentBone->getFather();
-
-                // get translation/rotation values as 3 float
-
-                Vector3 currentPosValues(frameData->_bonePositions[entityData->bonePositionOffset + boneIndexInCache]); // default
-                float (&quatValue)[4] = frameData->_boneOrientations[entityData->bonePositionOffset + boneIndexInCache];
-
-                Quaternion boneWOri(quatValue);
-                Quaternion fatherBoneWOri(0, 0, 0, 1);
-                // in joint reference
-                if (fatherBone != NULL)
-                {
-                    int fatherBoneSpecificIndex = fatherBone->getSpecificBoneIndex();
-                    size_t fatherBoneIndexInCache = specificToCacheBoneIndices[fatherBoneSpecificIndex];
-
-                    float (&fatherQuatValue)[4] = frameData->_boneOrientations[entityData->bonePositionOffset + fatherBoneIndexInCache];
-                    Vector3 fatherBoneWPos(frameData->_bonePositions[entityData->bonePositionOffset + fatherBoneIndexInCache]);
-
-                    fatherBoneWOri.setValues(fatherQuatValue);
-
-                    // in local coordinates
-                    currentPosValues = fatherBoneWOri.computeInverse() * (currentPosValues - fatherBoneWPos);
-                    currentPosValues /= entityScale;
-
-                    // also need to take back parent scale value
-                    if (skelEntityData->scalesAnimated && fatherBoneSpecificIndex < specificBonesWorldScales.sizeInt())
-                    {
-                        const Vector3& parentScale = specificBonesWorldScales[fatherBoneSpecificIndex];
-                        currentPosValues[0] /= parentScale.x;
-                        currentPosValues[1] /= parentScale.y;
-                        currentPosValues[2] /= parentScale.z;
-                    }
-                }
-
-                Quaternion boneLOri = fatherBoneWOri.computeInverse() * boneWOri;
-
-                skelEntityFrameData->translations[iBone] = GfVec3f(currentPosValues.getFloatValues());
-                skelEntityFrameData->rotations[iBone] = GfQuatf(boneLOri.w, boneLOri.x, boneLOri.y, boneLOri.z);
-            }
+            computeLocalJoints(
+                frameData,
+                entityData->bonePositionOffset,
+                specificToCacheBoneIndices,
+                characterFatherBoneIndices,
+                entityScale,
+                skelEntityData->scalesAnimated ? &specificBonesWorldScales : NULL,
+                skelEntityFrameData->translations,
+                skelEntityFrameData->rotations);
             return skelEntityFrameData;
         }
 
@@ -3182,7 +4009,8 @@ namespace glm
             const glm::crowdio::GlmFrameData* frameData = NULL;
             const glm::ShaderAssetDataContainer* shaderDataContainer = NULL;
             {
-                glm::ScopedLock<glm::Mutex> cachedSimuLock(*entityData->cachedSimulationLock);
+                glm::ScopedLock<ProfiledMutex> cachedSimuLock(*entityData->cachedSimulationLock);
+                debugLockWait("cachedSimulationLock", entityData->cachedSimulationLock->getLastWaitTime());
                 frameData = entityData->cachedSimulation->getFinalFrameData(frame, UINT32_MAX, true);
                 shaderDataContainer = entityData->cachedSimulation->getFinalShaderData(frame, UINT32_MAX, true);
             }
@@ -3214,50 +4042,20 @@ namespace glm
             entityFrameData->vectorShaderAttrValues.resize(characterSpecificShaderAttrCounters[glm::ShaderAttributeType::VECTOR], GfVec3f(0));
 
             // compute shader data
-            glm::Vector3 vectValue;
-            for (size_t iShaderAttr = 0, shaderAttrCount = entityData->inputGeoData._character->_shaderAttributes.size(); iShaderAttr < shaderAttrCount; ++iShaderAttr)
-            {
-                const glm::ShaderAttribute& shaderAttribute = entityData->inputGeoData._character->_shaderAttributes[iShaderAttr];
-                size_t specificAttrIdx = globalToSpecificShaderAttrIdx[iShaderAttr];
-                switch (shaderAttribute._type)
-                {
-                case glm::ShaderAttributeType::INT:
-                {
-                    entityFrameData->intShaderAttrValues[specificAttrIdx] = entityIntShaderData[specificAttrIdx];
-                }
-                break;
-                case glm::ShaderAttributeType::FLOAT:
-                {
-                    entityFrameData->floatShaderAttrValues[specificAttrIdx] = entityFloatShaderData[specificAttrIdx];
-                }
-                break;
-                case glm::ShaderAttributeType::STRING:
-                {
-                    entityFrameData->stringShaderAttrValues[specificAttrIdx] = TfToken(entityStringShaderData[specificAttrIdx].c_str());
-                }
-                break;
-                case glm::ShaderAttributeType::VECTOR:
-                {
-                    entityFrameData->vectorShaderAttrValues[specificAttrIdx].Set(entityVectorShaderData[specificAttrIdx].getFloatValues());
-                }
-                break;
-                default:
-                    break;
-                }
-            }
-
-            entityFrameData->floatPPAttrValues.resize(simuData->_ppFloatAttributeCount, 0);
-            entityFrameData->vectorPPAttrValues.resize(simuData->_ppVectorAttributeCount, GfVec3f(0));
+            copyShaderAttributes(
+                entityData->inputGeoData._character->_shaderAttributes,
+                globalToSpecificShaderAttrIdx,
+                entityIntShaderData,
+                entityFloatShaderData,
+                entityStringShaderData,
+                entityVectorShaderData,
+                entityFrameData->intShaderAttrValues,
+                entityFrameData->floatShaderAttrValues,
+                entityFrameData->stringShaderAttrValues,
+                entityFrameData->vectorShaderAttrValues);
 
             // update pp attributes
-            for (uint8_t iFloatPPAttr = 0; iFloatPPAttr < simuData->_ppFloatAttributeCount; ++iFloatPPAttr)
-            {
-                entityFrameData->floatPPAttrValues[iFloatPPAttr] = frameData->_ppFloatAttributeData[iFloatPPAttr][entityData->inputGeoData._entityToBakeIndex];
-            }
-            for (uint8_t iVectPPAttr = 0; iVectPPAttr < simuData->_ppVectorAttributeCount; ++iVectPPAttr)
-            {
-                entityFrameData->vectorPPAttrValues[iVectPPAttr].Set(frameData->_ppVectorAttributeData[iVectPPAttr][entityData->inputGeoData._entityToBakeIndex]);
-            }
+            copyPPAttributes(simuData, frameData, entityData->inputGeoData._entityToBakeIndex, entityFrameData->floatPPAttrValues, entityFrameData->vectorPPAttrValues);
 
             // update frame before computing geometry
             entityData->inputGeoData._frames.resize(1);
@@ -3333,10 +4131,13 @@ namespace glm
                                          currentFrameData->intShaderAttrValues[currentMeshData->templateData->velocitiesIntShaderAttributeIndex] == 1;
                 if (velocitiesEnabled)
                 {
-                    currentMeshData->velocities.resize(currentPoints.size());
-                    for (size_t iPoint = 0; iPoint < currentPoints.size(); ++iPoint)
+                    if (_params.glmHalfPrecision)
+                    {
+                        computeVelocities(currentPoints, prevPoints, _fps, currentMeshData->halfVelocities);
+                    }
+                    else
                     {
-                        currentMeshData->velocities[iPoint] = (currentPoints[iPoint] - prevPoints[iPoint]) * _fps;
+                        computeVelocities(currentPoints, prevPoints, _fps, currentMeshData->velocities);
                     }
                     currentFrameData->velocitiesComputed = true;
                 }
@@ -3344,36 +4145,267 @@ namespace glm
         }
 
         //-----------------------------------------------------------------------------
-        GolaemUSD_DataImpl::SkinMeshEntityFrameData::SP GolaemUSD_DataImpl::_ComputeSkinMeshEntity(EntityData::SP entityData, double frame)
+        void GolaemUSD_DataImpl::_CompressEntityFrame(SkinMeshEntityFrameData::SP entityFrameData)
         {
-            SkinMeshEntityFrameData::SP skinMeshEntityFrameData = entityData->getFrameData<SkinMeshEntityFrameData>(frame, static_cast<size_t>(_params.glmCachedFramesCount));
-
-            if (skinMeshEntityFrameData->entityData != nullptr)
+            if (entityFrameData->compressed || entityFrameData->baked || entityFrameData->entityData == nullptr || _params.glmDisplayMode != GolaemDisplayMode::SKINMESH)
             {
-                // getFrameData returned an existing SkelEntityFrameData
-                return skinMeshEntityFrameData;
+                // baked frames are already stored in the file mapping
+                return;
             }
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("CompressEntityFrame", GLM_COLOR_CACHE);
+#endif
+            for (const SkinMeshLodData::SP& lodData : entityFrameData->meshLodData)
+            {
+                for (const auto& itMeshData : lodData->meshData)
+                {
+                    SkinMeshData::SP meshData = itMeshData.second;
+                    if (meshData->sharedArrays)
+                    {
+                        // the buffers are still referenced by other meshes or by the sharing table
+                        continue;
+                    }
+                    meshData->compressedPoints.compress(meshData->points);
+                    meshData->points = VtVec3fArray();
+                    if (_params.glmHalfPrecision)
+                    {
+                        meshData->compressedNormals.compress(meshData->halfNormals);
+                        meshData->halfNormals = VtVec3hArray();
+                    }
+                    else
+                    {
+                        meshData->compressedNormals.compress(meshData->normals);
+                        meshData->normals = VtVec3fArray();
+                    }
+                    // velocities are computed again from the decompressed points
+                    meshData->velocities = VtVec3fArray();
+                    meshData->halfVelocities = VtVec3hArray();
+                    meshData->compressed = true;
+                }
+            }
+            entityFrameData->velocitiesComputed = false;
+            entityFrameData->compressed = true;
+        }
 
-            // getFrameData returned a new SkinMeshEntityFrameData, set entityData to mark it as computed
-            skinMeshEntityFrameData->entityData = entityData;
-
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_DecompressEntityFrame(SkinMeshEntityFrameData::SP entityFrameData)
+        {
 #ifdef TRACY_ENABLE
-            ZoneScopedNC("ComputeSkinMeshEntity", GLM_COLOR_CACHE);
-            glm::GlmString entityIdStr = "EntityId=" + glm::toString(entityData->inputGeoData._entityId);
-            ZoneText(entityIdStr.c_str(), entityIdStr.size());
-            glm::GlmString frameStr = "Frame=" + glm::toString(frame);
-            ZoneText(frameStr.c_str(), frameStr.size());
+            ZoneScopedNC("DecompressEntityFrame", GLM_COLOR_CACHE);
 #endif
+            for (const SkinMeshLodData::SP& lodData : entityFrameData->meshLodData)
+            {
+                for (const auto& itMeshData : lodData->meshData)
+                {
+                    SkinMeshData::SP meshData = itMeshData.second;
+                    if (!meshData->compressed)
+                    {
+                        continue;
+                    }
+                    meshData->compressedPoints.decompress(meshData->points);
+                    meshData->compressedPoints.clear();
+                    if (_params.glmHalfPrecision)
+                    {
+                        meshData->compressedNormals.decompress(meshData->halfNormals);
+                    }
+                    else
+                    {
+                        meshData->compressedNormals.decompress(meshData->normals);
+                    }
+                    meshData->compressedNormals.clear();
+                    meshData->compressed = false;
+                }
+            }
+            entityFrameData->compressed = false;
+        }
 
-            _ComputeEntity(skinMeshEntityFrameData, frame);
-            if (!skinMeshEntityFrameData->enabled)
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_LoadBakedGeometry(SkinMeshEntityFrameData::SP entityFrameData, double frame)
+        {
+            int intFrame = static_cast<int>(std::floor(frame));
+            if ((_bakedGeometryReader.empty() && !_geometryDiskCache.isOpen()) || intFrame != frame)
             {
-                return skinMeshEntityFrameData;
+                // only integer frames are baked
+                return false;
             }
 
-            SkinMeshEntityData::SP skinMeshEntityData = glm::staticCast<SkinMeshEntityData>(entityData);
+            int64_t entityId = entityFrameData->entityData->inputGeoData._entityId;
+            BakedGeometryFile* bakedFile = NULL;
+            const BakedEntityFrameRecord* bakedEntityFrame = _bakedGeometryReader.findEntityFrame(entityId, intFrame, bakedFile);
+            if (bakedEntityFrame != NULL)
+            {
+                TF_DEBUG(GOLAEMUSD_CACHE).Msg("[GolaemUSD] entity %lld frame %d read from '%s'\n", static_cast<long long>(entityId), intFrame, bakedFile->getFilePath().c_str());
+                return _LoadBakedEntityFrame(entityFrameData, *bakedFile, *bakedEntityFrame);
+            }
 
-            const glm::crowdio::GlmFrameData* frameData = entityData->inputGeoData._frameDatas[0];
+            // the file stays mapped while it is loaded, even if the cache evicts it meanwhile, then while the loaded arrays use it
+            BakedGeometryFile* cachedFile = NULL;
+            VtArray<char> cachedFileKeepAlive;
+            bakedEntityFrame = _geometryDiskCache.findEntityFrame(entityId, intFrame, cachedFile, cachedFileKeepAlive);
+            if (bakedEntityFrame == NULL)
+            {
+                return false;
+            }
+            TF_DEBUG(GOLAEMUSD_CACHE).Msg("[GolaemUSD] entity %lld frame %d read from '%s'\n", static_cast<long long>(entityId), intFrame, cachedFile->getFilePath().c_str());
+            return _LoadBakedEntityFrame(entityFrameData, *cachedFile, *bakedEntityFrame);
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_LoadBakedEntityFrame(SkinMeshEntityFrameData::SP entityFrameData, BakedGeometryFile& bakedFile, const BakedEntityFrameRecord& bakedEntityFrame)
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("LoadBakedGeometry", GLM_COLOR_CACHE);
+#endif
+            EntityData::SP entityData = entityFrameData->entityData;
+            auto& characterTemplateData = _skinMeshTemplateDataPerCharPerGeomFile[entityData->inputGeoData._characterIdx];
+            size_t geometryFileIdx = bakedEntityFrame.geometryFileIdx;
+            if (geometryFileIdx >= characterTemplateData.size())
+            {
+                return false;
+            }
+            auto& lodTemplateData = characterTemplateData[geometryFileIdx];
+            GolaemNormalsMode::Value normalsMode = (GolaemNormalsMode::Value)_params.glmNormalsMode;
+
+            // check the baked meshes against the templates before using them, the character files may have changed
+            const BakedMeshRecord* bakedMeshes = bakedFile.getMeshes(bakedEntityFrame);
+            for (uint32_t iMesh = 0; iMesh < bakedEntityFrame.meshCount; ++iMesh)
+            {
+                const BakedMeshRecord& bakedMesh = bakedMeshes[iMesh];
+                auto itTemplateData = lodTemplateData.find({bakedMesh.gchaMeshId, bakedMesh.meshMaterialIndex});
+                if (itTemplateData == lodTemplateData.end() || itTemplateData->second->defaultPoints.size() != bakedMesh.pointCount ||
+                    (normalsMode != GolaemNormalsMode::NONE && itTemplateData->second->defaultNormals.size() != bakedMesh.normalCount))
+                {
+                    GLM_CROWD_TRACE_WARNING("Baked geometry file '" << bakedFile.getFilePath() << "' does not match the character meshes, the geometry will be computed");
+                    return false;
+                }
+            }
+
+            entityFrameData->geometryFileIdx = geometryFileIdx;
+            const GeometryAsset* geometryAsset = entityData->inputGeoData._character->getGeometryAsset(entityData->inputGeoData._geometryTag, geometryFileIdx);
+            if (geometryAsset)
+            {
+                GlmString lodLevelString;
+                getStringFromLODLevel(static_cast<LODLevelFlags::Value>(geometryAsset->_lodLevel), lodLevelString);
+                entityFrameData->lodName = TfToken(lodLevelString.c_str());
+            }
+
+            entityFrameData->meshLodData.resize(characterTemplateData.size());
+            for (size_t iLod = 0; iLod < characterTemplateData.size(); ++iLod)
+            {
+                SkinMeshLodData::SP skinMeshLodData = new SkinMeshLodData();
+                skinMeshLodData->enabled = false;
+                skinMeshLodData->entityData = entityData;
+                entityFrameData->meshLodData[iLod] = skinMeshLodData;
+            }
+            size_t lodLevel = _params.glmLodMode == 0 ? 0 : geometryFileIdx;
+            SkinMeshLodData::SP lodData = entityFrameData->meshLodData[lodLevel];
+            lodData->enabled = true;
+
+            GfRange3f entityExtent;
+            for (uint32_t iMesh = 0; iMesh < bakedEntityFrame.meshCount; ++iMesh)
+            {
+                const BakedMeshRecord& bakedMesh = bakedMeshes[iMesh];
+                std::pair<int, int> meshKey = {bakedMesh.gchaMeshId, bakedMesh.meshMaterialIndex};
+
+                SkinMeshData::SP meshData = new SkinMeshData();
+                lodData->meshData[meshKey] = meshData;
+                meshData->templateData = lodTemplateData.at(meshKey);
+
+                // no copy, the arrays point to the file mapping
+                meshData->points = bakedFile.getPoints(bakedMesh);
+                if (normalsMode != GolaemNormalsMode::NONE)
+                {
+                    if (_params.glmHalfPrecision)
+                    {
+                        meshData->halfNormals = bakedFile.getHalfNormals(bakedMesh);
+                    }
+                    else
+                    {
+                        meshData->normals = bakedFile.getNormals(bakedMesh);
+                    }
+                }
+                GfRange3f meshExtent(GfVec3f(bakedMesh.extent), GfVec3f(bakedMesh.extent + 3));
+                if (!meshExtent.IsEmpty())
+                {
+                    meshData->extent = VtVec3fArray({meshExtent.GetMin(), meshExtent.GetMax()});
+                    entityExtent.UnionWith(meshExtent);
+                }
+            }
+            if (!entityExtent.IsEmpty())
+            {
+                entityFrameData->extentsHint = VtVec3fArray({entityExtent.GetMin(), entityExtent.GetMax()});
+            }
+            entityFrameData->baked = true;
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        template <typename T>
+        bool isSameArrayContent(const VtArray<T>& array, const VtArray<T>& otherArray)
+        {
+            // empty arrays, e.g. the unused normals of the other precision, are not shared content
+            if (array.empty())
+            {
+                return false;
+            }
+            if (array.IsIdentical(otherArray))
+            {
+                return true;
+            }
+            return array.size() == otherArray.size() && memcmp(array.cdata(), otherArray.cdata(), array.size() * sizeof(T)) == 0;
+        }
+
+        //-----------------------------------------------------------------------------
+        GolaemUSD_DataImpl::SkinMeshEntityFrameData::SP GolaemUSD_DataImpl::_ComputeSkinMeshEntity(EntityData::SP entityData, double frame)
+        {
+            // the cached frames are only compressed when a new frame pushes them out of the hot frames, not on every query
+            std::vector<EntityFrameData::SP> pushedDownFrameDatas;
+            SkinMeshEntityFrameData::SP skinMeshEntityFrameData = entityData->getFrameData<SkinMeshEntityFrameData>(frame, static_cast<size_t>(_params.glmCachedFramesCount), _stats, _params.glmCompressCachedFrames ? &pushedDownFrameDatas : NULL);
+            for (const EntityFrameData::SP& pushedDownFrameData : pushedDownFrameDatas)
+            {
+                _CompressEntityFrame(glm::staticCast<SkinMeshEntityFrameData>(pushedDownFrameData));
+            }
+
+            if (skinMeshEntityFrameData->entityData != nullptr)
+            {
+                // getFrameData returned an existing SkelEntityFrameData
+                if (skinMeshEntityFrameData->compressed)
+                {
+                    _DecompressEntityFrame(skinMeshEntityFrameData);
+                }
+                return skinMeshEntityFrameData;
+            }
+
+            // getFrameData returned a new SkinMeshEntityFrameData, set entityData to mark it as computed
+            skinMeshEntityFrameData->entityData = entityData;
+            _stats.add(RuntimeStats::COMPUTED_ENTITIES);
+            RuntimeStats::ScopedTimer computeTimer(_stats, RuntimeStats::COMPUTE_ENTITY_TIME);
+            DebugSlowComputeTimer slowComputeTimer(entityData->inputGeoData._entityId, frame);
+
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("ComputeSkinMeshEntity", GLM_COLOR_CACHE);
+            glm::GlmString entityIdStr = "EntityId=" + glm::toString(entityData->inputGeoData._entityId);
+            ZoneText(entityIdStr.c_str(), entityIdStr.size());
+            glm::GlmString frameStr = "Frame=" + glm::toString(frame);
+            ZoneText(frameStr.c_str(), frameStr.size());
+#endif
+
+            _ComputeEntity(skinMeshEntityFrameData, frame);
+            if (!skinMeshEntityFrameData->enabled)
+            {
+                return skinMeshEntityFrameData;
+            }
+
+            if (_params.glmFrustumCulling && _IsEntityCulled(entityData, skinMeshEntityFrameData->pos))
+            {
+                // the entity is not seen by the camera, skip the geometry computation
+                skinMeshEntityFrameData->culled = true;
+                return skinMeshEntityFrameData;
+            }
+
+            SkinMeshEntityData::SP skinMeshEntityData = glm::staticCast<SkinMeshEntityData>(entityData);
+
+            const glm::crowdio::GlmFrameData* frameData = entityData->inputGeoData._frameDatas[0];
 
             GolaemDisplayMode::Value displayMode = (GolaemDisplayMode::Value)_params.glmDisplayMode;
 
@@ -3393,13 +4425,25 @@ namespace glm
                 auto& lodTemplateData = characterTemplateData[0];
                 meshData->templateData = lodTemplateData.at({0, 0});
                 meshData->points = meshData->templateData->defaultPoints;
-                meshData->normals = meshData->templateData->defaultNormals;
+                if (_params.glmHalfPrecision)
+                {
+                    meshData->halfNormals = meshData->templateData->defaultHalfNormals;
+                }
+                else
+                {
+                    meshData->normals = meshData->templateData->defaultNormals;
+                }
+            }
+            else if (displayMode == GolaemDisplayMode::SKINMESH && _LoadBakedGeometry(skinMeshEntityFrameData, frame))
+            {
+                // the meshes were read from a baked geometry file
             }
             else if (displayMode == GolaemDisplayMode::SKINMESH)
             {
                 // these variables must be available when glmPrepareEntityGeometry is called below
                 float entityPos[3] = {0, 0, 0};
                 float cameraPos[3] = {0, 0, 0};
+                GolaemNormalsMode::Value normalsMode = (GolaemNormalsMode::Value)_params.glmNormalsMode;
                 glm::crowdio::OutputEntityGeoData outputData; // TODO: see if storage is better
 
                 if (entityData->inputGeoData._enableLOD)
@@ -3438,7 +4482,9 @@ namespace glm
                     skinMeshEntityFrameData->meshLodData[iLod] = skinMeshLodData;
                 }
 
+                int64_t prepareGeometryStartTime = RuntimeStats::now();
                 glm::crowdio::GlmGeometryGenerationStatus geoStatus = glm::crowdio::glmPrepareEntityGeometry(&entityData->inputGeoData, &outputData);
+                _stats.addTimeSince(RuntimeStats::PREPARE_GEOMETRY_TIME, prepareGeometryStartTime);
                 if (geoStatus == glm::crowdio::GIO_SUCCESS)
                 {
                     skinMeshEntityFrameData->geometryFileIdx = outputData._geometryFileIndexes[0];
@@ -3461,6 +4507,7 @@ namespace glm
                     glm::Array<glm::Array<glm::Vector3>>& frameDeformedVertices = outputData._deformedVertices[0];
                     glm::Array<glm::Array<glm::Vector3>>& frameDeformedNormals = outputData._deformedNormals[0];
 
+                    int64_t gatherStartTime = RuntimeStats::now();
                     if (outputData._geoType == glm::crowdio::GeometryType::FBX)
                     {
                         crowdio::CrowdFBXCharacter* fbxCharacter = outputData._fbxCharacters[0];
@@ -3470,7 +4517,6 @@ namespace glm
                         FbxAMatrix identityMatrix;
                         identityMatrix.SetIdentity();
                         FbxTime fbxTime;
-                        FbxVector4 fbxVect;
                         // ----- end FBX specific data
 
                         // Extract frame
@@ -3538,7 +4584,23 @@ namespace glm
                             meshData->templateData = lodTemplateData.at(meshKey);
 
                             meshData->points.resize(meshData->templateData->defaultPoints.size());
-                            meshData->normals.resize(meshData->templateData->defaultNormals.size());
+                            if (normalsMode == GolaemNormalsMode::VERTEX)
+                            {
+                                // accumulated in float, even in half precision mode
+                                meshData->normals.assign(meshData->templateData->defaultNormals.size(), GfVec3f(0.0f, 0.0f, 0.0f));
+                            }
+                            else if (normalsMode == GolaemNormalsMode::FACE_VARYING)
+                            {
+                                if (_params.glmHalfPrecision)
+                                {
+                                    meshData->halfNormals.resize(meshData->templateData->defaultNormals.size());
+                                }
+                                else
+                                {
+                                    meshData->normals.resize(meshData->templateData->defaultNormals.size());
+                                }
+                            }
+                            const int* vertexNormalIndices = normalsMode == GolaemNormalsMode::VERTEX ? meshData->templateData->faceVertexIndices.cdata() : NULL;
 
                             // check material id and reconstruct data
                             for (unsigned int iFbxPoly = 0; iFbxPoly < fbxPolyCount; ++iFbxPoly)
@@ -3574,36 +4636,15 @@ namespace glm
                                 }
                             }
 
-                            unsigned int iActualVertex = 0;
-                            for (unsigned int iFbxVertex = 0; iFbxVertex < fbxVertexCount; ++iFbxVertex)
+                            // meshDeformedVertices contains all fbx points, not just the ones that were filtered by vertexMasks
+                            GfRange3f meshExtent;
+                            gatherPoints(meshDeformedVertices, &vertexMasks, hasTransform ? &nodeTransform : NULL, skinMeshEntityFrameData->pos, meshData->points, meshExtent);
+                            if (!meshExtent.IsEmpty())
                             {
-                                int& vertexMask = vertexMasks[iFbxVertex];
-                                if (vertexMask >= 0)
-                                {
-                                    // meshDeformedVertices contains all fbx points, not just the ones that were filtered by vertexMasks
-                                    GfVec3f& point = meshData->points[iActualVertex];
-                                    // vertices
-                                    if (hasTransform)
-                                    {
-                                        const Vector3& glmVect = meshDeformedVertices[iFbxVertex];
-                                        fbxVect.Set(glmVect.x, glmVect.y, glmVect.z);
-                                        // transform vertex in case of local transformation
-                                        fbxVect = nodeTransform.MultT(fbxVect);
-                                        point.Set((float)fbxVect[0], (float)fbxVect[1], (float)fbxVect[2]);
-                                    }
-                                    else
-                                    {
-                                        const Vector3& meshVertex = meshDeformedVertices[iFbxVertex];
-                                        point.Set(meshVertex.getFloatValues());
-                                    }
-
-                                    point -= skinMeshEntityFrameData->pos;
-
-                                    ++iActualVertex;
-                                }
+                                meshData->extent = VtVec3fArray({meshExtent.GetMin(), meshExtent.GetMax()});
                             }
 
-                            if (hasNormals)
+                            if (hasNormals && normalsMode != GolaemNormalsMode::NONE)
                             {
                                 FbxAMatrix globalRotate(identityMatrix);
                                 globalRotate.SetR(nodeTransform.GetR());
@@ -3612,36 +4653,12 @@ namespace glm
                                 const glm::Array<glm::Vector3>& meshDeformedNormals = frameDeformedNormals[iGeoFileMesh];
 
                                 // normals are always stored per polygon vertex
-                                for (unsigned int iFbxPoly = 0, iFbxNormal = 0, iActualPolyVertex = 0; iFbxPoly < fbxPolyCount; ++iFbxPoly)
-                                {
-                                    int polySize = fbxMesh->GetPolygonSize(iFbxPoly);
-                                    if (polygonMasks[iFbxPoly])
-                                    {
-                                        for (int iPolyVertex = 0; iPolyVertex < polySize; ++iPolyVertex, ++iFbxNormal, ++iActualPolyVertex)
-                                        {
-                                            // meshDeformedNormals contains all fbx normals, not just the ones that were filtered by polygonMasks
-                                            // do not reverse polygon order
-                                            if (hasRotate)
-                                            {
-                                                const Vector3& glmVect = meshDeformedNormals[iFbxNormal];
-                                                fbxVect.Set(glmVect.x, glmVect.y, glmVect.z);
-                                                fbxVect = globalRotate.MultT(fbxVect);
-                                                meshData->normals[iActualPolyVertex].Set(
-                                                    (float)fbxVect[0], (float)fbxVect[1], (float)fbxVect[2]);
-                                            }
-                                            else
-                                            {
-                                                const glm::Vector3& deformedNormal = meshDeformedNormals[iFbxNormal];
-                                                meshData->normals[iActualPolyVertex].Set(
-                                                    deformedNormal.getFloatValues());
-                                            }
-                                        }
-                                    }
-                                    else
-                                    {
-                                        iFbxNormal += polySize;
-                                    }
-                                }
+                                gatherFbxPolygonVertexNormals(meshDeformedNormals, fbxMesh, polygonMasks, hasRotate ? &globalRotate : NULL, vertexNormalIndices, meshData->normals, meshData->halfNormals);
+                            }
+
+                            if (normalsMode == GolaemNormalsMode::VERTEX)
+                            {
+                                finalizeVertexNormals(meshData->normals, meshData->halfNormals, _params.glmHalfPrecision);
                             }
                         }
                     }
@@ -3666,83 +4683,604 @@ namespace glm
                             meshData->templateData = lodTemplateData.at(meshKey);
 
                             meshData->points.resize(meshData->templateData->defaultPoints.size());
-                            meshData->normals.resize(meshData->templateData->defaultNormals.size());
-
-                            for (size_t iVertex = 0; iVertex < vertexCount; ++iVertex)
+                            if (normalsMode == GolaemNormalsMode::VERTEX)
                             {
-                                const glm::Vector3& meshVertex = meshDeformedVertices[iVertex];
-                                GfVec3f& point = meshData->points[iVertex];
-                                point.Set(meshVertex.getFloatValues());
-                                point -= skinMeshEntityFrameData->pos;
+                                // accumulated in float, even in half precision mode
+                                meshData->normals.assign(meshData->templateData->defaultNormals.size(), GfVec3f(0.0f, 0.0f, 0.0f));
+                            }
+                            else if (normalsMode == GolaemNormalsMode::FACE_VARYING)
+                            {
+                                if (_params.glmHalfPrecision)
+                                {
+                                    meshData->halfNormals.resize(meshData->templateData->defaultNormals.size());
+                                }
+                                else
+                                {
+                                    meshData->normals.resize(meshData->templateData->defaultNormals.size());
+                                }
                             }
+                            const int* vertexNormalIndices = normalsMode == GolaemNormalsMode::VERTEX ? meshData->templateData->faceVertexIndices.cdata() : NULL;
+
+                            GfRange3f meshExtent;
+                            gatherPoints(meshDeformedVertices, NULL, NULL, skinMeshEntityFrameData->pos, meshData->points, meshExtent);
+                            meshData->extent = VtVec3fArray({meshExtent.GetMin(), meshExtent.GetMax()});
 
                             const glm::Array<glm::Vector3>& meshDeformedNormals = frameDeformedNormals[iRenderMesh];
 
                             glm::crowdio::GlmFileMeshTransform& assetFileMeshTransform = gcgCharacter->getGeometry()._transforms[outputData._transformIndicesInGcgFile[iRenderMesh]];
                             glm::crowdio::GlmFileMesh& assetFileMesh = gcgCharacter->getGeometry()._meshes[assetFileMeshTransform._meshIndex];
+                            uint32_t polygonVertexCount = 0;
+                            for (uint32_t iPoly = 0; iPoly < assetFileMesh._polygonCount; ++iPoly)
+                            {
+                                polygonVertexCount += assetFileMesh._polygonsVertexCount[iPoly];
+                            }
 
                             // add normals
-                            if (assetFileMesh._normalMode == glm::crowdio::GLM_NORMAL_PER_POLYGON_VERTEX)
+                            if (normalsMode == GolaemNormalsMode::NONE)
+                            {
+                                // the renderer computes the normals
+                            }
+                            else if (assetFileMesh._normalMode == glm::crowdio::GLM_NORMAL_PER_POLYGON_VERTEX)
+                            {
+                                gatherPolygonVertexNormals(meshDeformedNormals, NULL, polygonVertexCount, vertexNormalIndices, meshData->normals, meshData->halfNormals);
+                            }
+                            else
+                            {
+                                uint32_t* polygonNormalIndices = assetFileMesh._normalMode == glm::crowdio::GLM_NORMAL_PER_CONTROL_POINT ? assetFileMesh._polygonsVertexIndices : assetFileMesh._polygonsNormalIndices;
+                                gatherPolygonVertexNormals(meshDeformedNormals, polygonNormalIndices, polygonVertexCount, vertexNormalIndices, meshData->normals, meshData->halfNormals);
+                            }
+
+                            if (normalsMode == GolaemNormalsMode::VERTEX)
+                            {
+                                finalizeVertexNormals(meshData->normals, meshData->halfNormals, _params.glmHalfPrecision);
+                            }
+                        }
+                    }
+                    _stats.addTimeSince(RuntimeStats::GATHER_TIME, gatherStartTime);
+
+                    if (_params.glmReuseUnchangedMeshes)
+                    {
+                        // idle entities produce the same local space meshes as in the closest computed frame
+                        SkinMeshLodData::SP closestLodData = NULL;
+                        double closestFrameDistance = DBL_MAX;
+                        for (auto itFrameData = entityData->frameDataMap.begin(); itFrameData != entityData->frameDataMap.end(); ++itFrameData)
+                        {
+                            double frameDistance = std::abs(itFrameData.getKey() - frame);
+                            SkinMeshEntityFrameData::SP otherFrameData = glm::staticCast<SkinMeshEntityFrameData>(itFrameData.getValue());
+                            if (frameDistance == 0 || frameDistance >= closestFrameDistance || otherFrameData->entityData == nullptr ||
+                                otherFrameData->geometryFileIdx != skinMeshEntityFrameData->geometryFileIdx || otherFrameData->meshLodData.size() <= lodLevel)
+                            {
+                                continue;
+                            }
+                            SkinMeshLodData::SP otherLodData = otherFrameData->meshLodData[lodLevel];
+                            if (otherLodData->enabled)
                             {
-                                for (uint32_t iPoly = 0, iVertex = 0; iPoly < assetFileMesh._polygonCount; ++iPoly)
+                                closestLodData = otherLodData;
+                                closestFrameDistance = frameDistance;
+                            }
+                        }
+
+                        if (closestLodData != NULL)
+                        {
+                            for (const auto& itMeshData : lodData->meshData)
+                            {
+                                auto itClosestMeshData = closestLodData->meshData.find(itMeshData.first);
+                                if (itClosestMeshData == closestLodData->meshData.end())
                                 {
-                                    uint32_t polySize = assetFileMesh._polygonsVertexCount[iPoly];
-                                    for (uint32_t iPolyVtx = 0; iPolyVtx < polySize; ++iPolyVtx, ++iVertex)
-                                    {
-                                        // do not reverse polygon order
-                                        const glm::Vector3& vtxNormal = meshDeformedNormals[iVertex];
-                                        meshData->normals[iVertex].Set(vtxNormal.getFloatValues());
-                                    }
+                                    continue;
+                                }
+                                SkinMeshData::SP meshData = itMeshData.second;
+                                SkinMeshData::SP closestMeshData = itClosestMeshData->second;
+                                bool shared = false;
+                                if (isSameArrayContent(meshData->points, closestMeshData->points))
+                                {
+                                    meshData->points = closestMeshData->points;
+                                    shared = true;
+                                }
+                                if (isSameArrayContent(meshData->normals, closestMeshData->normals))
+                                {
+                                    meshData->normals = closestMeshData->normals;
+                                    shared = true;
+                                }
+                                if (isSameArrayContent(meshData->halfNormals, closestMeshData->halfNormals))
+                                {
+                                    meshData->halfNormals = closestMeshData->halfNormals;
+                                    shared = true;
+                                }
+                                if (shared)
+                                {
+                                    meshData->sharedArrays = true;
+                                    closestMeshData->sharedArrays = true;
                                 }
                             }
-                            else
+                        }
+                    }
+
+                    if (_params.glmDeduplicateMeshes)
+                    {
+                        // entities playing the same animation in lockstep produce identical local space meshes
+                        for (const auto& itMeshData : lodData->meshData)
+                        {
+                            // only the meshes reusing the arrays of another mesh are flagged, the first user keeps its arrays
+                            bool shared = _ShareMeshArray(itMeshData.second->points, frame);
+                            shared = _ShareMeshArray(itMeshData.second->normals, frame) || shared;
+                            shared = _ShareMeshArray(itMeshData.second->halfNormals, frame) || shared;
+                            if (shared)
+                            {
+                                itMeshData.second->sharedArrays = true;
+                            }
+                        }
+                    }
+
+                    // entity extents are the union of the extents of its meshes
+                    GfRange3f entityExtent;
+                    for (const auto& itMeshData : lodData->meshData)
+                    {
+                        const VtVec3fArray& meshExtent = itMeshData.second->extent;
+                        if (meshExtent.size() == 2)
+                        {
+                            entityExtent.UnionWith(GfRange3f(meshExtent[0], meshExtent[1]));
+                        }
+                    }
+                    if (!entityExtent.IsEmpty())
+                    {
+                        skinMeshEntityFrameData->extentsHint = VtVec3fArray({entityExtent.GetMin(), entityExtent.GetMax()});
+                    }
+
+                    if (_geometryDiskCache.isOpen())
+                    {
+                        _WriteGeometryDiskCache(skinMeshEntityFrameData, lodLevel, frame);
+                    }
+                }
+            }
+            return skinMeshEntityFrameData;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_WriteGeometryDiskCache(SkinMeshEntityFrameData::SP entityFrameData, size_t lodLevel, double frame)
+        {
+            int intFrame = static_cast<int>(std::floor(frame));
+            if (intFrame != frame)
+            {
+                // only integer frames are cached
+                return;
+            }
+            // the arrays are shared with the entity frame, the file is written in the background
+            GeometryDiskCache::EntityFrameEntry entityFrame;
+            entityFrame.entityId = entityFrameData->entityData->inputGeoData._entityId;
+            entityFrame.frame = intFrame;
+            entityFrame.geometryFileIdx = static_cast<uint32_t>(entityFrameData->geometryFileIdx);
+            for (const auto& itMeshData : entityFrameData->meshLodData[lodLevel]->meshData)
+            {
+                GeometryDiskCache::MeshEntry mesh;
+                mesh.meshKey = itMeshData.first;
+                mesh.points = itMeshData.second->points;
+                mesh.normals = itMeshData.second->normals;
+                mesh.halfNormals = itMeshData.second->halfNormals;
+                mesh.extent = itMeshData.second->extent;
+                entityFrame.meshes.push_back(mesh);
+            }
+            _geometryDiskCache.write(std::move(entityFrame));
+        }
+
+        //-----------------------------------------------------------------------------
+        template <typename T>
+        bool GolaemUSD_DataImpl::_ShareMeshArray(VtArray<T>& meshArray, double frame)
+        {
+            if (meshArray.empty())
+            {
+                return false;
+            }
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("ShareMeshArray", GLM_COLOR_CACHE);
+#endif
+            uint64_t hash = ArchHash64(reinterpret_cast<const char*>(meshArray.cdata()), meshArray.size() * sizeof(T));
+
+            SharedMeshArrays::Shard& shard = _sharedMeshArrays.shards[hash % SharedMeshArrays::SHARD_COUNT];
+            glm::ScopedLock<glm::Mutex> lock(shard.lock);
+            std::map<double, std::multimap<uint64_t, VtValue>>& arraysPerFrame = shard.arraysPerFrame;
+            std::multimap<uint64_t, VtValue>& frameArrays = arraysPerFrame[frame];
+            auto hashRange = frameArrays.equal_range(hash);
+            for (auto itArray = hashRange.first; itArray != hashRange.second; ++itArray)
+            {
+                const VtValue& sharedValue = itArray->second;
+                if (sharedValue.IsHolding<VtArray<T>>() && isSameArrayContent(meshArray, sharedValue.UncheckedGet<VtArray<T>>()))
+                {
+                    meshArray = sharedValue.UncheckedGet<VtArray<T>>();
+                    return true;
+                }
+            }
+            frameArrays.insert({hash, VtValue(meshArray)});
+
+            // only keep the frames close to the current one, like the entity frame data, each shard trims its own frames
+            size_t maxFrameCount = std::max(_params.glmCachedFramesCount, 1);
+            while (arraysPerFrame.size() > maxFrameCount)
+            {
+                if (frame - arraysPerFrame.begin()->first > arraysPerFrame.rbegin()->first - frame)
+                {
+                    arraysPerFrame.erase(arraysPerFrame.begin());
+                }
+                else
+                {
+                    arraysPerFrame.erase(std::prev(arraysPerFrame.end()));
+                }
+            }
+            return false;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_InvalidateEntity(EntityFrameData::SP entityFrameData)
+        {
+            EntityData::SP entityData = entityFrameData->entityData;
+            entityFrameData->enabled = false;
+            entityData->inputGeoData._frames.clear();
+            entityData->inputGeoData._frameDatas.clear();
+            entityFrameData->intShaderAttrValues.clear();
+            entityFrameData->floatShaderAttrValues.clear();
+            entityFrameData->stringShaderAttrValues.clear();
+            entityFrameData->vectorShaderAttrValues.clear();
+        }
+
+        //-----------------------------------------------------------------------------
+        // half extents of a character scaled by the entity scale
+        void getScaledCharacterExtent(const glm::GolaemCharacter* character, short geometryTag, float characterScale, GfVec3f& extent)
+        {
+            glm::Vector3 halfExtents(1, 1, 1);
+            size_t geoIdx = 0;
+            const glm::GeometryAsset* geoAsset = character->getGeometryAsset(geometryTag, geoIdx); // any LOD should have same extents !
+            if (geoAsset != NULL)
+            {
+                halfExtents = geoAsset->_halfExtentsYUp;
+            }
+            halfExtents *= characterScale;
+            extent.Set(halfExtents[0], halfExtents[1], halfExtents[2]);
+        }
+
+        //-----------------------------------------------------------------------------
+        // deterministic pseudo random value in [0, 1[ for an entity, stable across sessions
+        float getEntityRandomValue(int64_t entityId)
+        {
+            // splitmix64 finalizer
+            uint64_t value = static_cast<uint64_t>(entityId) + 0x9E3779B97F4A7C15ull;
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+            value = value ^ (value >> 31);
+            return static_cast<float>(value >> 40) / static_cast<float>(1ull << 24);
+        }
+
+        //-----------------------------------------------------------------------------
+        // calls fn(entityIndex, entityPos) in parallel for each entity enabled in the frame
+        template <typename Fn>
+        void forEachEnabledEntityPosition(const glm::crowdio::GlmSimulationData* simuData, const glm::crowdio::GlmFrameData* frameData, const Fn& fn)
+        {
+            WorkParallelForN(
+                simuData->_entityCount,
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t iEntity = begin; iEntity < end; ++iEntity)
+                    {
+                        if (simuData->_entityIds[iEntity] < 0)
+                        {
+                            continue;
+                        }
+                        int32_t entityToBakeIndex = simuData->_entityToBakeIndex[iEntity];
+                        if (entityToBakeIndex < 0 || frameData->_entityEnabled[entityToBakeIndex] == 0)
+                        {
+                            continue;
+                        }
+                        uint16_t entityType = simuData->_entityTypes[iEntity];
+                        uint32_t bonePositionOffset = simuData->_iBoneOffsetPerEntityType[entityType] + simuData->_indexInEntityType[iEntity] * simuData->_boneCount[entityType];
+                        const float* bonePosition = frameData->_bonePositions[bonePositionOffset];
+                        fn(iEntity, GfVec3f(bonePosition[0], bonePosition[1], bonePosition[2]));
+                    }
+                });
+        }
+
+        //-----------------------------------------------------------------------------
+        // name of the XZ grid tile containing a position
+        TfToken getTileName(const GfVec3f& position, float tileSize)
+        {
+            int tileIndices[2] = {(int)floorf(position[0] / tileSize), (int)floorf(position[2] / tileSize)};
+            glm::GlmString tileName = "Tile";
+            for (int tileIndex : tileIndices)
+            {
+                // prim names can't contain '-'
+                tileName += tileIndex < 0 ? "_n" + glm::toString(-tileIndex) : "_" + glm::toString(tileIndex);
+            }
+            return TfToken(tileName.c_str());
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_getCharacterExtent(EntityData::SP entityData, GfVec3f& extent) const
+        {
+            float characterScale = entityData->inputGeoData._simuData->_scales[entityData->inputGeoData._entityIndex];
+            getScaledCharacterExtent(entityData->inputGeoData._character, entityData->inputGeoData._geometryTag, characterScale, extent);
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_ComputeScreenSpaceThinning(
+            const glm::crowdio::GlmSimulationData* simuData,
+            const glm::crowdio::GlmFrameData* frameData,
+            float renderPercent,
+            glm::PODArray<uint8_t>& keptEntities) const
+        {
+            // computed once when the layer is initialized, from the static camera params and the positions at the first
+            // frame: the kept entities define the prims of the layer, so they do not follow an animated camera
+            keptEntities.assign(simuData->_entityCount, 1);
+            if (frameData == NULL || renderPercent >= 1.f)
+            {
+                return;
+            }
+
+            GfFrustum frustum;
+            _GetCameraFrustum(frustum);
+            GfMatrix4d viewMatrix = frustum.ComputeViewMatrix();
+            float aspectRatio = _params.glmCameraAspectRatio > 0 ? _params.glmCameraAspectRatio : 1.f;
+            double tanHalfVerticalFov = tan(GfDegreesToRadians(_params.glmCameraFov) * 0.5) / aspectRatio;
+
+            // projected size of each entity, relative to the image height
+            glm::PODArray<float> screenSizes;
+            screenSizes.assign(simuData->_entityCount, 0.f);
+            size_t validEntityCount = 0;
+            for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+            {
+                if (simuData->_entityIds[iEntity] < 0)
+                {
+                    continue;
+                }
+                ++validEntityCount;
+
+                const glm::GolaemCharacter* character = _factory->getGolaemCharacter(simuData->_characterIdx[iEntity]);
+                if (character == NULL)
+                {
+                    continue;
+                }
+                GfVec3f halfExtents;
+                getScaledCharacterExtent(character, _params.glmGeometryTag, simuData->_scales[iEntity], halfExtents);
+                double radius = halfExtents.GetLength();
+
+                uint16_t entityType = simuData->_entityTypes[iEntity];
+                uint32_t bonePositionOffset = simuData->_iBoneOffsetPerEntityType[entityType] + simuData->_indexInEntityType[iEntity] * simuData->_boneCount[entityType];
+                GfVec3d entityPos(frameData->_bonePositions[bonePositionOffset][0], frameData->_bonePositions[bonePositionOffset][1], frameData->_bonePositions[bonePositionOffset][2]);
+
+                // the camera looks down -Z in view space
+                double depth = -viewMatrix.Transform(entityPos)[2];
+                if (depth <= radius)
+                {
+                    // close to the camera or behind it
+                    screenSizes[iEntity] = depth > -radius ? 1.f : 0.f;
+                }
+                else
+                {
+                    screenSizes[iEntity] = static_cast<float>(std::min(1.0, radius / (depth * tanHalfVerticalFov)));
+                }
+            }
+
+            // keep probability is min(1, scale * screenSize), find the scale that keeps renderPercent of the entities
+            double targetCount = validEntityCount * std::max(renderPercent, 0.f);
+            auto computeKeptCount = [&](double scale) {
+                double keptCount = 0;
+                for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+                {
+                    keptCount += std::min(1.0, scale * screenSizes[iEntity]);
+                }
+                return keptCount;
+            };
+            double minScale = 0;
+            double maxScale = 1;
+            while (computeKeptCount(maxScale) < targetCount && maxScale < 1e12)
+            {
+                maxScale *= 2;
+            }
+            for (int iIteration = 0; iIteration < 32; ++iIteration)
+            {
+                double scale = 0.5 * (minScale + maxScale);
+                if (computeKeptCount(scale) < targetCount)
+                {
+                    minScale = scale;
+                }
+                else
+                {
+                    maxScale = scale;
+                }
+            }
+
+            for (uint32_t iEntity = 0; iEntity < simuData->_entityCount; ++iEntity)
+            {
+                int64_t entityId = simuData->_entityIds[iEntity];
+                if (entityId < 0)
+                {
+                    continue;
+                }
+                double keepProbability = std::min(1.0, maxScale * screenSizes[iEntity]);
+                keptEntities[iEntity] = getEntityRandomValue(entityId) < keepProbability ? 1 : 0;
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_ComputeEntitiesInRegion(
+            glm::crowdio::CachedSimulation& cachedSimulation,
+            const std::pair<int, int>& frameRange,
+            const std::vector<GfRange3f>& regionBoxes,
+            glm::PODArray<uint8_t>& entitiesInRegion) const
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("ComputeEntitiesInRegion", GLM_COLOR_CACHE);
+#endif
+            const glm::crowdio::GlmSimulationData* simuData = cachedSimulation.getFinalSimulationData();
+            size_t entityCount = simuData->_entityCount;
+            entitiesInRegion.assign(entityCount, 0);
+
+            // entities are tested with their character extents
+            std::vector<GfVec3f> entityHalfExtents(entityCount, GfVec3f(0));
+            for (size_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                const glm::GolaemCharacter* character = _factory->getGolaemCharacter(simuData->_characterIdx[iEntity]);
+                if (simuData->_entityIds[iEntity] >= 0 && character != NULL)
+                {
+                    getScaledCharacterExtent(character, _params.glmGeometryTag, simuData->_scales[iEntity], entityHalfExtents[iEntity]);
+                }
+            }
+
+            std::pair<int, int> regionFrameRange;
+            parseRegionOfInterestFrames(_params.glmRegionOfInterestFrames.GetText(), frameRange, regionFrameRange);
+            for (int frame = regionFrameRange.first; frame <= regionFrameRange.second; ++frame)
+            {
+                const glm::crowdio::GlmFrameData* frameData = cachedSimulation.getFinalFrameData(frame, UINT32_MAX, true);
+                if (frameData == NULL)
+                {
+                    continue;
+                }
+                forEachEnabledEntityPosition(
+                    simuData, frameData,
+                    [&](size_t iEntity, const GfVec3f& entityPos)
+                    {
+                        if (entitiesInRegion[iEntity] != 0)
+                        {
+                            return;
+                        }
+                        GfRange3f entityBounds(entityPos - entityHalfExtents[iEntity], entityPos + entityHalfExtents[iEntity]);
+                        for (const GfRange3f& regionBox : regionBoxes)
+                        {
+                            if (!GfRange3f::GetIntersection(entityBounds, regionBox).IsEmpty())
+                            {
+                                entitiesInRegion[iEntity] = 1;
+                                return;
+                            }
+                        }
+                    });
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::_ComputeEntityTiles(
+            glm::crowdio::CachedSimulation& cachedSimulation,
+            const std::pair<int, int>& frameRange,
+            const std::string& cacheKey,
+            glm::Array<TfToken>& entityTileNames) const
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("ComputeEntityTiles", GLM_COLOR_CACHE);
+#endif
+            {
+                glm::ScopedLock<glm::Mutex> lock(_entityTilesCacheLock);
+                std::map<std::string, glm::Array<TfToken>>::const_iterator itTiles = _entityTilesCache.find(cacheKey);
+                if (itTiles != _entityTilesCache.end())
+                {
+                    entityTileNames = itTiles->second;
+                    return;
+                }
+            }
+
+            const glm::crowdio::GlmSimulationData* simuData = cachedSimulation.getFinalSimulationData();
+            size_t entityCount = simuData->_entityCount;
+            size_t remainingEntityCount = 0;
+            for (size_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                if (simuData->_entityIds[iEntity] >= 0)
+                {
+                    ++remainingEntityCount;
+                }
+            }
+
+            // positions of the entities over the frame range
+            std::vector<GfRange3f> entityBounds(entityCount);
+            GolaemTileMode::Value tileMode = (GolaemTileMode::Value)_params.glmTileMode;
+            for (int frame = frameRange.first; frame <= frameRange.second && remainingEntityCount > 0; ++frame)
+            {
+                const glm::crowdio::GlmFrameData* frameData = cachedSimulation.getFinalFrameData(frame, UINT32_MAX, true);
+                if (frameData == NULL)
+                {
+                    continue;
+                }
+                if (tileMode == GolaemTileMode::TRAJECTORY_BOUNDS)
+                {
+                    forEachEnabledEntityPosition(
+                        simuData, frameData,
+                        [&](size_t iEntity, const GfVec3f& entityPos)
+                        {
+                            entityBounds[iEntity].UnionWith(entityPos);
+                        });
+                }
+                else
+                {
+                    // stop as soon as all entities have appeared
+                    std::atomic<size_t> placedEntityCount(0);
+                    forEachEnabledEntityPosition(
+                        simuData, frameData,
+                        [&](size_t iEntity, const GfVec3f& entityPos)
+                        {
+                            if (entityBounds[iEntity].IsEmpty())
                             {
-                                uint32_t* polygonNormalIndices = assetFileMesh._normalMode == glm::crowdio::GLM_NORMAL_PER_CONTROL_POINT ? assetFileMesh._polygonsVertexIndices : assetFileMesh._polygonsNormalIndices;
-                                for (uint32_t iPoly = 0, iVertex = 0; iPoly < assetFileMesh._polygonCount; ++iPoly)
-                                {
-                                    uint32_t polySize = assetFileMesh._polygonsVertexCount[iPoly];
-                                    for (uint32_t iPolyVtx = 0; iPolyVtx < polySize; ++iPolyVtx, ++iVertex)
-                                    {
-                                        // do not reverse polygon order
-                                        uint32_t normalIdx = polygonNormalIndices[iVertex];
-                                        const glm::Vector3& vtxNormal = meshDeformedNormals[normalIdx];
-                                        meshData->normals[iVertex].Set(vtxNormal.getFloatValues());
-                                    }
-                                }
+                                entityBounds[iEntity].UnionWith(entityPos);
+                                ++placedEntityCount;
                             }
-                        }
-                    }
+                        });
+                    remainingEntityCount -= std::min(remainingEntityCount, placedEntityCount.load());
                 }
             }
-            return skinMeshEntityFrameData;
+
+            entityTileNames.resize(entityCount);
+            WorkParallelForN(
+                entityCount,
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t iEntity = begin; iEntity < end; ++iEntity)
+                    {
+                        const GfRange3f& bounds = entityBounds[iEntity];
+                        entityTileNames[iEntity] = getTileName(bounds.IsEmpty() ? GfVec3f(0) : bounds.GetMidpoint(), _params.glmTileSize);
+                    }
+                });
+
+            glm::ScopedLock<glm::Mutex> lock(_entityTilesCacheLock);
+            _entityTilesCache[cacheKey] = entityTileNames;
         }
 
         //-----------------------------------------------------------------------------
-        void GolaemUSD_DataImpl::_InvalidateEntity(EntityFrameData::SP entityFrameData)
+        template <typename T>
+        const T& GolaemUSD_DataImpl::_GetUsdParamValue(const TfToken& paramName, const T& defaultValue) const
         {
-            EntityData::SP entityData = entityFrameData->entityData;
-            entityFrameData->enabled = false;
-            entityData->inputGeoData._frames.clear();
-            entityData->inputGeoData._frameDatas.clear();
-            entityFrameData->intShaderAttrValues.clear();
-            entityFrameData->floatShaderAttrValues.clear();
-            entityFrameData->stringShaderAttrValues.clear();
-            entityFrameData->vectorShaderAttrValues.clear();
+            // usd params may be connected to another attribute - usdWrapper will do the update
+            const VtValue* usdValue = TfMapLookupPtr(_usdParams, paramName);
+            if (usdValue != NULL && usdValue->IsHolding<T>())
+            {
+                return usdValue->UncheckedGet<T>();
+            }
+            return defaultValue;
         }
 
         //-----------------------------------------------------------------------------
-        void GolaemUSD_DataImpl::_getCharacterExtent(EntityData::SP entityData, GfVec3f& extent) const
+        void GolaemUSD_DataImpl::_GetCameraFrustum(GfFrustum& frustum) const
         {
-            glm::Vector3 halfExtents(1, 1, 1);
-            size_t geoIdx = 0;
-            const glm::GeometryAsset* geoAsset = entityData->inputGeoData._character->getGeometryAsset(entityData->inputGeoData._geometryTag, geoIdx); // any LOD should have same extents !
-            if (geoAsset != NULL)
-            {
-                halfExtents = geoAsset->_halfExtentsYUp;
-            }
-            float characterScale = entityData->inputGeoData._simuData->_scales[entityData->inputGeoData._entityIndex];
-            halfExtents *= characterScale;
-            extent.Set(halfExtents[0], halfExtents[1], halfExtents[2]);
+            const GfVec3f& cameraPos = _GetUsdParamValue(_golaemTokens->glmCameraPos, _params.glmCameraPos);
+            const GfVec3f& cameraRotation = _GetUsdParamValue(_golaemTokens->glmCameraRotation, _params.glmCameraRotation);
+            float cameraFov = _GetUsdParamValue(_golaemTokens->glmCameraFov, _params.glmCameraFov);
+            float cameraAspectRatio = _GetUsdParamValue(_golaemTokens->glmCameraAspectRatio, _params.glmCameraAspectRatio);
+            float cameraNearClip = _GetUsdParamValue(_golaemTokens->glmCameraNearClip, _params.glmCameraNearClip);
+            float cameraFarClip = _GetUsdParamValue(_golaemTokens->glmCameraFarClip, _params.glmCameraFarClip);
+
+            // rotation angles are in degrees, XYZ rotation order
+            GfRotation rotation =
+                GfRotation(GfVec3d::XAxis(), cameraRotation[0]) *
+                GfRotation(GfVec3d::YAxis(), cameraRotation[1]) *
+                GfRotation(GfVec3d::ZAxis(), cameraRotation[2]);
+
+            frustum.SetPosition(GfVec3d(cameraPos));
+            frustum.SetRotation(rotation);
+            // the field of view is horizontal
+            frustum.SetPerspective(cameraFov, false, cameraAspectRatio > 0 ? cameraAspectRatio : 1.0, cameraNearClip, cameraFarClip);
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::_IsEntityCulled(EntityData::SP entityData, const GfVec3f& entityPos) const
+        {
+            GfFrustum frustum;
+            _GetCameraFrustum(frustum);
+
+            // padding avoids popping when the animation goes out of the character extents
+            GfVec3d halfExtents = GfVec3d(entityData->extent) + GfVec3d(_params.glmFrustumPadding);
+            GfRange3d entityBounds(GfVec3d(entityPos) - halfExtents, GfVec3d(entityPos) + halfExtents);
+            return !frustum.Intersects(GfBBox3d(entityBounds));
         }
 
         //-----------------------------------------------------------------------------
@@ -3765,88 +5303,12 @@ namespace glm
             _getCharacterExtent(entityData, halfExtents);
 
             // create the shape of the bounding box
-            VtVec3fArray& points = meshMapData.templateData->defaultPoints;
-            points.resize(8);
-
-            points[0].Set(
-                -halfExtents[0],
-                -halfExtents[1],
-                +halfExtents[2]);
-
-            points[1].Set(
-                +halfExtents[0],
-                -halfExtents[1],
-                +halfExtents[2]);
-
-            points[2].Set(
-                +halfExtents[0],
-                -halfExtents[1],
-                -halfExtents[2]);
-
-            points[3].Set(
-                -halfExtents[0],
-                -halfExtents[1],
-                -halfExtents[2]);
-
-            points[4].Set(
-                -halfExtents[0],
-                +halfExtents[1],
-                +halfExtents[2]);
-
-            points[5].Set(
-                +halfExtents[0],
-                +halfExtents[1],
-                +halfExtents[2]);
-
-            points[6].Set(
-                +halfExtents[0],
-                +halfExtents[1],
-                -halfExtents[2]);
-
-            points[7].Set(
-                -halfExtents[0],
-                +halfExtents[1],
-                -halfExtents[2]);
-
             VtVec3fArray& vertexNormals = meshMapData.templateData->defaultNormals;
-            vertexNormals.resize(24);
-
-            int vertexIdx = 0;
-
-            // face 0
-            for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
-            {
-                vertexNormals[vertexIdx].Set(0, -1, 0);
-            }
-
-            // face 1
-            for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
-            {
-                vertexNormals[vertexIdx].Set(1, 0, 0);
-            }
-
-            // face 2
-            for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
-            {
-                vertexNormals[vertexIdx].Set(0, 0, -1);
-            }
-
-            // face 3
-            for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
-            {
-                vertexNormals[vertexIdx].Set(-1, 0, 0);
-            }
-
-            // face 4
-            for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
-            {
-                vertexNormals[vertexIdx].Set(0, 0, 1);
-            }
+            computeBoxMesh(halfExtents, meshMapData.templateData->faceVertexIndices, _params.glmNormalsMode == GolaemNormalsMode::VERTEX, meshMapData.templateData->defaultPoints, vertexNormals);
 
-            // face 5
-            for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
+            if (_params.glmHalfPrecision)
             {
-                vertexNormals[vertexIdx].Set(0, 1, 0);
+                toHalfArray(vertexNormals, meshMapData.templateData->defaultHalfNormals);
             }
         }
 
@@ -3855,6 +5317,7 @@ namespace glm
         {
             glm::GlmString materialPath = _params.glmMaterialPath.GetText();
             GolaemMaterialAssignMode::Value materialAssignMode = (GolaemMaterialAssignMode::Value)_params.glmMaterialAssignMode;
+            GolaemNormalsMode::Value normalsMode = (GolaemNormalsMode::Value)_params.glmNormalsMode;
 
             int velocitiesShaderAttributeIndex = inputGeoData._character->findShaderAttributeIdx("glmEnableUsdVelocities");
             int velocitiesIntShaderAttributeIndex = -1;
@@ -3988,7 +5451,7 @@ namespace glm
                         }
                     }
 
-                    meshTemplateData->defaultNormals.assign(meshTemplateData->faceVertexIndices.size(), GfVec3f(0.0f, 0.0f, 0.0f));
+                    meshTemplateData->defaultNormals.assign(normalsMode == GolaemNormalsMode::VERTEX ? meshTemplateData->defaultPoints.size() : meshTemplateData->faceVertexIndices.size(), GfVec3f(0.0f, 0.0f, 0.0f));
 
                     // find how many uv layers are available
                     int uvSetCount = fbxMesh->GetLayerCount(FbxLayerElement::eUV);
@@ -4075,7 +5538,7 @@ namespace glm
                         }
                     }
 
-                    meshTemplateData->defaultNormals.assign(meshTemplateData->faceVertexIndices.size(), GfVec3f(0.0f, 0.0f, 0.0f));
+                    meshTemplateData->defaultNormals.assign(normalsMode == GolaemNormalsMode::VERTEX ? meshTemplateData->defaultPoints.size() : meshTemplateData->faceVertexIndices.size(), GfVec3f(0.0f, 0.0f, 0.0f));
 
                     meshTemplateData->uvSets.resize(assetFileMesh._uvSetCount);
                     for (size_t iUVSet = 0; iUVSet < assetFileMesh._uvSetCount; ++iUVSet)
@@ -4169,6 +5632,15 @@ namespace glm
                     }
                 }
             }
+
+            if (_params.glmHalfPrecision)
+            {
+                for (auto& itTemplateData : lodTemplateData)
+                {
+                    toHalfArray(itTemplateData.second->defaultNormals, itTemplateData.second->defaultHalfNormals);
+                    toHalfArray(itTemplateData.second->defaultVelocities, itTemplateData.second->defaultHalfVelocities);
+                }
+            }
         }
 
         //-----------------------------------------------------------------------------
@@ -4216,6 +5688,422 @@ namespace glm
             }
         }
 
+        //-----------------------------------------------------------------------------
+        uint64_t GolaemUSD_DataImpl::GetGeometryParamsHash() const
+        {
+            // the dirmap rules are left out so that files baked on another platform can be used
+            std::string geometryParams = TfStringify(_params.glmCacheLibFile) + ";" + TfStringify(_params.glmCacheLibItem) + ";" +
+                                         TfStringify(_params.glmCrowdFields) + ";" + TfStringify(_params.glmCacheName) + ";" +
+                                         TfStringify(_params.glmCacheDir) + ";" + TfStringify(_params.glmCharacterFiles) + ";" +
+                                         TfStringify(_params.glmEnableLayout) + ";" + TfStringify(_params.glmLayoutFiles) + ";" +
+                                         TfStringify(_params.glmTerrainFile) + ";" + TfStringify(_params.glmDisplayMode) + ";" +
+                                         TfStringify(_params.glmGeometryTag) + ";" + TfStringify(_params.glmLodMode) + ";" +
+                                         TfStringify(_params.glmNormalsMode);
+            if (_params.glmLodMode == 1)
+            {
+                // the static lod depends on the camera position
+                geometryParams += ";" + TfStringify(_params.glmCameraPos);
+            }
+            return ArchHash64(geometryParams.c_str(), geometryParams.size());
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::GetSkinMeshEntityIds(std::vector<int64_t>& entityIds) const
+        {
+            entityIds.clear();
+            if (_params.glmDisplayMode != GolaemDisplayMode::SKINMESH)
+            {
+                return;
+            }
+            for (const auto& itEntityData : _entityDataMap)
+            {
+                if (!itEntityData.second->excluded)
+                {
+                    entityIds.push_back(itEntityData.second->inputGeoData._entityId);
+                }
+            }
+            std::sort(entityIds.begin(), entityIds.end());
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::GetFrameRange(int& startFrame, int& endFrame) const
+        {
+            startFrame = _startFrame;
+            endFrame = _endFrame;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GolaemUSD_DataImpl::BakeGeometry(const std::vector<int64_t>& entityIds, int frame, BakedGeometryWriter& writer)
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("BakeGeometry", GLM_COLOR_CACHE);
+#endif
+            if (_params.glmDisplayMode != GolaemDisplayMode::SKINMESH)
+            {
+                return;
+            }
+
+            // entityIds is sorted, keep the same order in the file
+            std::vector<EntityData::SP> entitiesToBake;
+            for (const auto& itEntityData : _entityDataMap)
+            {
+                EntityData::SP entityData = itEntityData.second;
+                if (!entityData->excluded && std::binary_search(entityIds.begin(), entityIds.end(), entityData->inputGeoData._entityId))
+                {
+                    entitiesToBake.push_back(entityData);
+                }
+            }
+            std::sort(entitiesToBake.begin(), entitiesToBake.end(), [](const EntityData::SP& entityData, const EntityData::SP& otherEntityData)
+                      { return entityData->inputGeoData._entityId < otherEntityData->inputGeoData._entityId; });
+
+            std::vector<SkinMeshEntityFrameData::SP> entityFrameDatas(entitiesToBake.size());
+            WorkParallelForN(
+                entitiesToBake.size(),
+                [&](size_t begin, size_t end)
+                {
+                    for (size_t iEntity = begin; iEntity < end; ++iEntity)
+                    {
+                        EntityData::SP entityData = entitiesToBake[iEntity];
+                        glm::ScopedLock<ProfiledMutex> entityComputeLock(*entityData->entityComputeLock);
+                        entityFrameDatas[iEntity] = _ComputeSkinMeshEntity(entityData, frame);
+                    }
+                });
+
+            for (size_t iEntity = 0, entityCount = entitiesToBake.size(); iEntity < entityCount; ++iEntity)
+            {
+                SkinMeshEntityFrameData::SP entityFrameData = entityFrameDatas[iEntity];
+                if (!entityFrameData->enabled || entityFrameData->culled)
+                {
+                    continue;
+                }
+                for (const SkinMeshLodData::SP& lodData : entityFrameData->meshLodData)
+                {
+                    if (!lodData->enabled)
+                    {
+                        continue;
+                    }
+                    writer.addEntityFrame(entitiesToBake[iEntity]->inputGeoData._entityId, frame, static_cast<uint32_t>(entityFrameData->geometryFileIdx));
+                    for (const auto& itMeshData : lodData->meshData)
+                    {
+                        SkinMeshData::SP meshData = itMeshData.second;
+                        if (_params.glmHalfPrecision)
+                        {
+                            writer.addMesh(itMeshData.first.first, itMeshData.first.second, meshData->points, meshData->halfNormals, meshData->extent);
+                        }
+                        else
+                        {
+                            writer.addMesh(itMeshData.first.first, itMeshData.first.second, meshData->points, meshData->normals, meshData->extent);
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        // collects the visited spec paths
+        class SpecPathsCollector : public SdfAbstractDataSpecVisitor
+        {
+        public:
+            bool VisitSpec(const SdfAbstractData& data, const SdfPath& path) override
+            {
+                GLM_UNREFERENCED(data);
+                paths.push_back(path);
+                return true;
+            }
+            void Done(const SdfAbstractData& data) override
+            {
+                GLM_UNREFERENCED(data);
+            }
+
+            SdfPathVector paths;
+        };
+
+        //-----------------------------------------------------------------------------
+        bool GolaemUSD_DataImpl::ExportToUsd(const std::string& filePath, int framesPerClip, std::string& errorMessage)
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedNC("ExportToUsd", GLM_COLOR_CACHE);
+#endif
+            SpecPathsCollector specPathsCollector;
+            SdfDataRefPtr emptyData = TfCreateRefPtr(new SdfData());
+            VisitSpecs(*emptyData, &specPathsCollector);
+            SdfPathVector& specPaths = specPathsCollector.paths;
+            // runtime stats are not part of the generated scene
+            specPaths.erase(std::remove_if(specPaths.begin(), specPaths.end(), [this](const SdfPath& path)
+                                           { return path.IsPropertyPath() && path.GetAbsoluteRootOrPrimPath() == _GetRootPrimPath() && _statsAttributes.count(path.GetNameToken()) > 0; }),
+                            specPaths.end());
+            // parent prims must be created before their children and properties
+            std::sort(specPaths.begin(), specPaths.end(), [](const SdfPath& path, const SdfPath& otherPath)
+                      {
+                          bool isProperty = path.IsPropertyPath();
+                          bool isOtherProperty = otherPath.IsPropertyPath();
+                          if (isProperty != isOtherProperty)
+                          {
+                              return isOtherProperty;
+                          }
+                          size_t elementCount = path.GetPathElementCount();
+                          size_t otherElementCount = otherPath.GetPathElementCount();
+                          return elementCount < otherElementCount || (elementCount == otherElementCount && path < otherPath);
+                      });
+
+            if (TfIsFile(filePath))
+            {
+                ArchUnlinkFile(filePath.c_str());
+            }
+            SdfLayerRefPtr layer = SdfLayer::CreateNew(filePath);
+            if (!layer)
+            {
+                errorMessage = "Could not create layer '" + filePath + "'";
+                return false;
+            }
+
+            // fields set through the spec constructors, or managed by the layer
+            TfToken::HashSet skippedFields(SdfChildrenKeys->allTokens.begin(), SdfChildrenKeys->allTokens.end());
+            skippedFields.insert({SdfFieldKeys->Specifier, SdfFieldKeys->TypeName, SdfFieldKeys->Variability, SdfFieldKeys->Custom, SdfFieldKeys->TimeSamples});
+
+            // animated properties, grouped by entity so that the entities can be computed in parallel
+            std::map<SdfPath, size_t> groupIndexPerEntity;
+            std::vector<SdfPathVector> animatedPathsPerGroup;
+            auto getEntityPath = [this](const SdfPath& primPath) -> SdfPath
+            {
+                if (const EntityData::SP* entityDataPtr = TfMapLookupPtr(_entityDataMap, primPath))
+                {
+                    return (*entityDataPtr)->entityPath;
+                }
+                if (const SkinMeshMapData* meshMapData = TfMapLookupPtr(_skinMeshDataMap, primPath))
+                {
+                    return meshMapData->entityData->entityPath;
+                }
+                if (const SkinMeshLodMapData* lodMapData = TfMapLookupPtr(_skinMeshLodDataMap, primPath))
+                {
+                    return lodMapData->entityData->entityPath;
+                }
+                if (const SkelEntityData::SP* skelEntityDataPtr = TfMapLookupPtr(_skelAnimDataMap, primPath))
+                {
+                    return (*skelEntityDataPtr)->entityPath;
+                }
+                return SdfPath();
+            };
+
+            {
+                SdfChangeBlock changeBlock;
+                for (const SdfPath& path : specPaths)
+                {
+                    VtValue value;
+                    SdfSpecType specType = GetSpecType(path);
+                    if (specType == SdfSpecTypePrim)
+                    {
+                        SdfSpecifier specifier = SdfSpecifierDef;
+                        if (Has(path, SdfFieldKeys->Specifier, &value) && value.IsHolding<SdfSpecifier>())
+                        {
+                            specifier = value.UncheckedGet<SdfSpecifier>();
+                        }
+                        std::string typeName;
+                        if (Has(path, SdfFieldKeys->TypeName, &value) && value.IsHolding<TfToken>())
+                        {
+                            typeName = value.UncheckedGet<TfToken>().GetString();
+                        }
+                        SdfPath parentPath = path.GetParentPath();
+                        SdfPrimSpecHandle parentSpec = parentPath.IsAbsoluteRootPath() ? layer->GetPseudoRoot() : layer->GetPrimAtPath(parentPath);
+                        if (!parentSpec || !SdfPrimSpec::New(parentSpec, path.GetName(), specifier, typeName))
+                        {
+                            errorMessage = "Could not create prim '" + path.GetString() + "'";
+                            return false;
+                        }
+                    }
+                    else if (specType == SdfSpecTypeAttribute || specType == SdfSpecTypeRelationship)
+                    {
+                        SdfPrimSpecHandle primSpec = layer->GetPrimAtPath(path.GetPrimPath());
+                        SdfVariability variability = specType == SdfSpecTypeAttribute ? SdfVariabilityVarying : SdfVariabilityUniform;
+                        if (Has(path, SdfFieldKeys->Variability, &value) && value.IsHolding<SdfVariability>())
+                        {
+                            variability = value.UncheckedGet<SdfVariability>();
+                        }
+                        bool custom = false;
+                        if (Has(path, SdfFieldKeys->Custom, &value) && value.IsHolding<bool>())
+                        {
+                            custom = value.UncheckedGet<bool>();
+                        }
+                        bool created = false;
+                        if (primSpec && specType == SdfSpecTypeAttribute)
+                        {
+                            SdfValueTypeName typeName;
+                            if (Has(path, SdfFieldKeys->TypeName, &value) && value.IsHolding<TfToken>())
+                            {
+                                typeName = SdfSchema::GetInstance().FindType(value.UncheckedGet<TfToken>());
+                            }
+                            created = SdfAttributeSpec::New(primSpec, path.GetName(), typeName, variability, custom);
+                        }
+                        else if (primSpec)
+                        {
+                            created = SdfRelationshipSpec::New(primSpec, path.GetName(), custom, variability);
+                        }
+                        if (!created)
+                        {
+                            errorMessage = "Could not create property '" + path.GetString() + "'";
+                            return false;
+                        }
+
+                        if (_IsAnimatedProperty(path))
+                        {
+                            auto itGroup = groupIndexPerEntity.insert({getEntityPath(path.GetPrimPath()), animatedPathsPerGroup.size()}).first;
+                            if (itGroup->second == animatedPathsPerGroup.size())
+                            {
+                                animatedPathsPerGroup.emplace_back();
+                            }
+                            animatedPathsPerGroup[itGroup->second].push_back(path);
+                        }
+                    }
+                    else if (specType != SdfSpecTypePseudoRoot)
+                    {
+                        continue;
+                    }
+
+                    for (const TfToken& field : List(path))
+                    {
+                        if (skippedFields.find(field) == skippedFields.end() && Has(path, field, &value))
+                        {
+                            layer->SetField(path, field, value);
+                        }
+                    }
+                }
+            }
+
+            // with framesPerClip, the time samples are written to value clip layers of framesPerClip frames, each clip is
+            // saved and released once complete, so that only the samples of one clip stay in memory
+            SdfPath rootPath = _GetRootPrimPath();
+            std::string layerBasePath = TfStringGetBeforeSuffix(filePath);
+            std::string layerExtension = TfStringGetSuffix(filePath);
+            // clip layers only hold the animated attributes, as overs
+            auto createClipLayer = [&](const std::string& clipFilePath) -> SdfLayerRefPtr
+            {
+                if (TfIsFile(clipFilePath))
+                {
+                    ArchUnlinkFile(clipFilePath.c_str());
+                }
+                SdfLayerRefPtr clipLayer = SdfLayer::CreateNew(clipFilePath);
+                if (!clipLayer)
+                {
+                    return clipLayer;
+                }
+                SdfChangeBlock changeBlock;
+                for (const SdfPathVector& animatedPaths : animatedPathsPerGroup)
+                {
+                    for (const SdfPath& path : animatedPaths)
+                    {
+                        SdfAttributeSpecHandle attributeSpec = layer->GetAttributeAtPath(path);
+                        if (!attributeSpec || !SdfJustCreatePrimInLayer(clipLayer, path.GetPrimPath()) ||
+                            !SdfAttributeSpec::New(clipLayer->GetPrimAtPath(path.GetPrimPath()), path.GetName(), attributeSpec->GetTypeName(), attributeSpec->GetVariability(), attributeSpec->IsCustom()))
+                        {
+                            return SdfLayerRefPtr();
+                        }
+                    }
+                }
+                return clipLayer;
+            };
+
+            std::vector<std::vector<VtValue>> valuesPerGroup(animatedPathsPerGroup.size());
+            SdfLayerRefPtr samplesLayer = framesPerClip > 0 ? SdfLayerRefPtr() : layer;
+            VtArray<SdfAssetPath> clipAssetPaths;
+            VtVec2dArray clipActives;
+            int framesInClip = 0;
+            size_t frameIndex = 0;
+            for (double frame : _animTimeSampleTimes)
+            {
+                ++frameIndex;
+                if (!samplesLayer)
+                {
+                    std::string clipFilePath = TfStringPrintf("%s.clip%04zu.%s", layerBasePath.c_str(), clipAssetPaths.size(), layerExtension.c_str());
+                    samplesLayer = createClipLayer(clipFilePath);
+                    if (!samplesLayer)
+                    {
+                        errorMessage = "Could not create clip layer '" + clipFilePath + "'";
+                        return false;
+                    }
+                    clipActives.push_back(GfVec2d(frame, static_cast<double>(clipAssetPaths.size())));
+                    clipAssetPaths.push_back(SdfAssetPath("./" + TfGetBaseName(clipFilePath)));
+                    framesInClip = 0;
+                }
+
+                WorkParallelForN(
+                    animatedPathsPerGroup.size(),
+                    [&](size_t begin, size_t end)
+                    {
+                        for (size_t iGroup = begin; iGroup < end; ++iGroup)
+                        {
+                            const SdfPathVector& animatedPaths = animatedPathsPerGroup[iGroup];
+                            std::vector<VtValue>& values = valuesPerGroup[iGroup];
+                            values.resize(animatedPaths.size());
+                            for (size_t iPath = 0, pathCount = animatedPaths.size(); iPath < pathCount; ++iPath)
+                            {
+                                values[iPath] = VtValue();
+                                QueryTimeSample(animatedPaths[iPath], frame, &values[iPath]);
+                            }
+                        }
+                    });
+
+                {
+                    SdfChangeBlock changeBlock;
+                    for (size_t iGroup = 0, groupCount = animatedPathsPerGroup.size(); iGroup < groupCount; ++iGroup)
+                    {
+                        const SdfPathVector& animatedPaths = animatedPathsPerGroup[iGroup];
+                        std::vector<VtValue>& values = valuesPerGroup[iGroup];
+                        for (size_t iPath = 0, pathCount = animatedPaths.size(); iPath < pathCount; ++iPath)
+                        {
+                            if (!values[iPath].IsEmpty())
+                            {
+                                samplesLayer->SetTimeSample(animatedPaths[iPath], frame, values[iPath]);
+                            }
+                            values[iPath] = VtValue();
+                        }
+                    }
+                }
+
+                if (framesPerClip > 0 && (++framesInClip >= framesPerClip || frameIndex == _animTimeSampleTimes.size()))
+                {
+                    if (!samplesLayer->Save())
+                    {
+                        errorMessage = "Could not save layer '" + samplesLayer->GetRealPath() + "'";
+                        return false;
+                    }
+                    // the samples of the clip are released with its layer
+                    samplesLayer = SdfLayerRefPtr();
+                }
+            }
+
+            if (!clipAssetPaths.empty())
+            {
+                // the manifest declares the attributes found in the clips, so that the clips are only opened when their samples are read
+                std::string manifestFilePath = TfStringPrintf("%s.manifest.%s", layerBasePath.c_str(), layerExtension.c_str());
+                SdfLayerRefPtr manifestLayer = createClipLayer(manifestFilePath);
+                if (!manifestLayer || !manifestLayer->Save())
+                {
+                    errorMessage = "Could not save layer '" + manifestFilePath + "'";
+                    return false;
+                }
+
+                VtDictionary clipSet;
+                clipSet[UsdClipsAPIInfoKeys->assetPaths] = VtValue(clipAssetPaths);
+                clipSet[UsdClipsAPIInfoKeys->primPath] = VtValue(rootPath.GetString());
+                clipSet[UsdClipsAPIInfoKeys->active] = VtValue(clipActives);
+                // stage times are clip times
+                VtVec2dArray clipTimes = {GfVec2d(*_animTimeSampleTimes.begin()), GfVec2d(*_animTimeSampleTimes.rbegin())};
+                clipSet[UsdClipsAPIInfoKeys->times] = VtValue(clipTimes);
+                clipSet[UsdClipsAPIInfoKeys->manifestAssetPath] = VtValue(SdfAssetPath("./" + TfGetBaseName(manifestFilePath)));
+                VtDictionary clips;
+                clips[UsdClipsAPISetNames->default_] = VtValue(clipSet);
+                layer->SetField(rootPath, UsdTokens->clips, VtValue(clips));
+            }
+
+            if (!layer->Save())
+            {
+                errorMessage = "Could not save layer '" + filePath + "'";
+                return false;
+            }
+            return true;
+        }
+
         //-----------------------------------------------------------------------------
         void GolaemUSD_DataImpl::RefreshUsdStage(UsdStagePtr usdStage)
         {
@@ -4268,6 +6156,12 @@ namespace glm
                                 if (!sourcePaths.empty())
                                 {
                                     _usdWrapper._connectedUsdParams.push_back({&itUsdParam.second, sourcePaths[0]});
+                                    if (_params.glmRenderPercentMode == GolaemRenderPercentMode::SCREEN_SIZE &&
+                                        (itUsdParam.first == _golaemTokens->glmCameraPos || itUsdParam.first == _golaemTokens->glmCameraRotation ||
+                                         itUsdParam.first == _golaemTokens->glmCameraFov || itUsdParam.first == _golaemTokens->glmCameraAspectRatio))
+                                    {
+                                        GLM_CROWD_TRACE_WARNING("The screen size render percent mode ignores the connection of '" << itUsdParam.first.GetText() << "': the entities are thinned once, from the static camera params at the first frame.");
+                                    }
                                 }
                             }
                         }
@@ -4277,9 +6171,10 @@ namespace glm
         }
 
         //-----------------------------------------------------------------------------
-        void GolaemUSD_DataImpl::UsdWrapper::update(const double& frame, glm::ScopedLockActivable<glm::Mutex>& scopedLock)
+        void GolaemUSD_DataImpl::UsdWrapper::update(const double& frame, glm::ScopedLockActivable<ProfiledMutex>& scopedLock)
         {
             scopedLock.lock();
+            debugLockWait("usd wrapper _updateLock", _updateLock.getLastWaitTime());
             if (glm::approxDiff(_currentFrame, frame, static_cast<double>(GLM_NUMERICAL_PRECISION)))
             {
                 _currentFrame = frame;
@@ -4322,3 +6217,19 @@ namespace glm
 
     } // namespace usdplugin
 } // namespace glm
+
+//-----------------------------------------------------------------------------
+void glmUsdDumpLayerMemoryUsages()
+{
+    using namespace glm::usdplugin;
+    glm::ScopedLock<glm::Mutex> layersLock(s_layersLock);
+    std::string report = TfStringPrintf("[GolaemUSD] %zu layers loaded:\n", s_layers.size());
+    LayerMemoryUsage memoryUsage;
+    for (const GolaemUSD_DataImpl* layer : s_layers)
+    {
+        layer->GetMemoryUsage(memoryUsage);
+        report += formatMemoryUsageReport(memoryUsage);
+    }
+    fputs(report.c_str(), stdout);
+    fflush(stdout);
+}
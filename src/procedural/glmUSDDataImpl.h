@@ -8,6 +8,17 @@
 
 #include "glmUSD.h"
 #include "glmUSDData.h"
+#include "glmUSDPluginAPI.h"
+#include "glmUSDCompressedArrays.h"
+#include "glmUSDBakedGeometry.h"
+#include "glmUSDGeometryDiskCache.h"
+#include "glmUSDRuntimeStats.h"
+#include "glmUSDLockStats.h"
+
+USD_INCLUDES_START
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/range3f.h>
+USD_INCLUDES_END
 
 #include <glmSimulationCacheFactory.h>
 #include <glmSmartPointer.h>
@@ -41,6 +52,62 @@ namespace glm
             };
         };
 
+        struct GolaemExtentsMode
+        {
+            enum Value
+            {
+                CHARACTER_EXTENTS, // static, from the character extents
+                DEFORMED_POINTS,   // animated, from the deformed mesh points
+                END
+            };
+        };
+
+        struct GolaemRenderPercentMode
+        {
+            enum Value
+            {
+                ENTITY_INDEX, // keep the first entities
+                SCREEN_SIZE,  // randomly thin entities that are small on screen, from the static camera params at the first frame
+                END
+            };
+        };
+
+        struct GolaemNormalsMode
+        {
+            enum Value
+            {
+                FACE_VARYING, // deformed normals of each polygon vertex
+                VERTEX,       // deformed normals averaged per point
+                NONE,         // no normals, computed by the renderer
+                END
+            };
+        };
+
+        struct GolaemTileMode
+        {
+            enum Value
+            {
+                FIRST_FRAME,       // tile of the entity position when it first appears
+                TRAJECTORY_BOUNDS, // tile of the center of the entity trajectory bounds
+                END
+            };
+        };
+
+        // We create a static map from property names to the info about them that
+        // we'll be querying for specs.
+        struct _PrimPropertyInfo
+        {
+            VtValue defaultValue;
+            TfToken typeName;
+            // Most of our properties are animated.
+            bool isAnimated = true;
+            bool hasInterpolation = false;
+            TfToken interpolation;
+        };
+
+        using _LeafPrimPropertyMap =
+            std::map<TfToken, _PrimPropertyInfo, TfTokenFastArbitraryLessThan>;
+
         class GolaemUSD_DataImpl
         {
         private:
@@ -50,6 +117,7 @@ namespace glm
                 typedef SmartPointer<EntityFrameData> SP;
 
                 bool enabled = true; // can vary during simulation (kill, emit)
+                bool culled = false;  // outside of the camera frustum, the geometry is not computed
 
                 GfVec3f pos{0, 0, 0};
 
@@ -80,8 +148,8 @@ namespace glm
                 bool excluded = false; // excluded by layout - the entity will always be empty
                 size_t cfIdx = 0;      // index of the crowd field this entity belongs to
                 uint32_t bonePositionOffset = 0;
-                glm::Mutex* cachedSimulationLock = NULL;
-                glm::Mutex* entityComputeLock = NULL; // do not allow simultaneous computes of the same entity
+                ProfiledMutex* cachedSimulationLock = NULL;
+                ProfiledMutex* entityComputeLock = NULL; // do not allow simultaneous computes of the same entity
 
                 glm::crowdio::InputEntityGeoData inputGeoData;
                 glm::crowdio::CachedSimulation* cachedSimulation = NULL;
@@ -99,8 +167,9 @@ namespace glm
                 template <class FrameDataType>
                 SmartPointer<FrameDataType> findFrameData(const double& frame) const;
 
+                // on a cache miss, the cached frames further than one frame from the new one are added to pushedDownFrameDatas if not NULL
                 template <class FrameDataType>
-                SmartPointer<FrameDataType> getFrameData(const double& frame, size_t cachedFramesCount);
+                SmartPointer<FrameDataType> getFrameData(const double& frame, size_t cachedFramesCount, RuntimeStats& stats, std::vector<EntityFrameData::SP>* pushedDownFrameDatas = NULL);
             };
 
             struct SkinMeshTemplateData : public glm::ReferenceCounter
@@ -114,6 +183,8 @@ namespace glm
                 VtVec3fArray defaultPoints;
                 VtVec3fArray defaultNormals;
                 VtVec3fArray defaultVelocities;
+                VtVec3hArray defaultHalfNormals;    // half precision mode only
+                VtVec3hArray defaultHalfVelocities; // half precision mode only
                 // int normalsCount; // not needed, = faceVertexIndices.size();
                 SdfPathListOp materialPath;
                 int velocitiesIntShaderAttributeIndex = -1; // index of the enableUsdVelocities int attribute if found, -1 otherwise
@@ -127,6 +198,15 @@ namespace glm
                 VtVec3fArray points;
                 VtVec3fArray normals; // stored by polygon vertex
                 VtVec3fArray velocities;
+                VtVec3fArray extent; // bounds of the deformed points
+                VtVec3hArray halfNormals;    // replaces normals in half precision mode
+                VtVec3hArray halfVelocities; // replaces velocities in half precision mode
+
+                // points and normals of the cached frames pushed out of the hot frames by a new frame, losslessly compressed
+                CompressedVec3Array compressedPoints;
+                CompressedVec3Array compressedNormals;
+                bool compressed = false;
+                bool sharedArrays = false; // arrays shared with other meshes, compressing them would not release them
 
                 SkinMeshTemplateData::SP templateData = NULL;
             };
@@ -145,7 +225,10 @@ namespace glm
                 typedef SmartPointer<SkinMeshEntityFrameData> SP;
 
                 glm::Array<SkinMeshLodData::SP> meshLodData;
+                VtVec3fArray extentsHint; // bounds of the deformed meshes, empty when not computed
                 bool velocitiesComputed = false;
+                bool compressed = false; // mesh points and normals are compressed, velocities are dropped
+                bool baked = false;      // mesh points and normals point to a baked geometry file, never compressed
             };
 
             struct SkinMeshEntityData : public EntityData
@@ -200,14 +283,27 @@ namespace glm
             public:
                 glm::Array<std::pair<VtValue*, SdfPath>> _connectedUsdParams;
                 UsdStagePtr _usdStage = NULL; // from GolaemUSD_DataImpl
-                glm::Mutex _updateLock;
+                ProfiledMutex _updateLock{LockStats::USD_WRAPPER_UPDATE};
 
             protected:
                 double _currentFrame = -FLT_MAX;
 
             public:
                 inline const double& getCurrentFrame() const;
-                void update(const double& frame, glm::ScopedLockActivable<glm::Mutex>& scopedLock);
+                void update(const double& frame, glm::ScopedLockActivable<ProfiledMutex>& scopedLock);
+            };
+
+            // identical deformed mesh arrays of a frame share the same buffer.
+            // Sharded by content hash so that the parallel entity computes rarely wait for each other.
+            struct SharedMeshArrays
+            {
+                struct alignas(64) Shard
+                {
+                    glm::Mutex lock;
+                    std::map<double, std::multimap<uint64_t, VtValue>> arraysPerFrame; // arrays by content hash
+                };
+                static const size_t SHARD_COUNT = 64;
+                Shard shards[SHARD_COUNT];
             };
 
         private:
@@ -219,6 +315,7 @@ namespace glm
             glm::Array<glm::PODArray<int>> _sgToSsPerChar;
             glm::Array<PODArray<int>> _snsIndicesPerChar;
             glm::Array<VtTokenArray> _jointsPerChar;
+            glm::Array<PODArray<int>> _fatherBoneIndicesPerChar; // specific index of the father of each bone, -1 for the root
             glm::Array<glm::Array<std::map<std::pair<int, int>, SkinMeshTemplateData::SP>>> _skinMeshTemplateDataPerCharPerGeomFile;
 
             glm::Array<GlmString> _shaderAttrTypes;
@@ -250,14 +347,29 @@ namespace glm
 
             TfHashMap<SdfPath, SkelEntityData::SP, SdfPath::Hash> _skelAnimDataMap;
 
-            glm::PODArray<glm::Mutex*> _cachedSimulationLocks;
+            glm::PODArray<ProfiledMutex*> _cachedSimulationLocks;
 
             glm::Array<PODArray<size_t>> _globalToSpecificShaderAttrIdxPerChar;
 
             UsdWrapper _usdWrapper;
 
+            SharedMeshArrays _sharedMeshArrays;
+
+            BakedGeometryReader _bakedGeometryReader;
+            GeometryDiskCache _geometryDiskCache;
+
             std::map<TfToken, VtValue, TfTokenFastArbitraryLessThan> _usdParams; // additional usd params and their value
 
+            mutable RuntimeStats _stats;
+            std::map<TfToken, int, TfTokenFastArbitraryLessThan> _statsAttributes; // glmStats:* root attributes and their counter, -1 for the frame cache size, from COUNTER_COUNT for the lock stats
+            mutable std::atomic<int64_t> _lastMemoryDebugTime{0};                 // last periodic GOLAEMUSD_MEMORY log, in ns
+
+            // Leaf prim properties may differ from the static ones depending on the params
+            _LeafPrimPropertyMap _skinMeshEntityPropertyInfos;
+            _LeafPrimPropertyMap _skinMeshPropertyInfos;
+            TfTokenVector _skinMeshEntityPropertyNames;
+            TfTokenVector _skinMeshPropertyNames;
+
             SdfPath _rootPathInFinalStage;
             int _rootNodeIdInFinalStage = -1;
 
@@ -316,7 +428,31 @@ namespace glm
 
             void RefreshUsdStage(UsdStagePtr usdStage);
 
+            /// Returns a hash of the params that change the deformed meshes, baked geometry files are only used if they match
+            uint64_t GetGeometryParamsHash() const;
+
+            /// Returns the ids of the entities with deformed meshes, sorted
+            void GetSkinMeshEntityIds(std::vector<int64_t>& entityIds) const;
+
+            /// Returns the frame range of the simulation caches
+            void GetFrameRange(int& startFrame, int& endFrame) const;
+
+            /// Computes the deformed meshes of some entities at a frame in parallel, and adds them to the writer.
+            /// Disabled and culled entities are skipped.
+            void BakeGeometry(const std::vector<int64_t>& entityIds, int frame, BakedGeometryWriter& writer);
+
+            /// Estimates the memory used by the layer, by category
+            void GetMemoryUsage(LayerMemoryUsage& memoryUsage) const;
+
+            /// Writes the generated layer to a usd file, usually a .usdc file. The time samples are computed frame by frame,
+            /// the entities of a frame in parallel. With framesPerClip, the samples are written to value clip layers of
+            /// framesPerClip frames next to the file (file.clip0000.usdc..., with a file.manifest.usdc manifest), so that
+            /// only one clip is in memory at a time. With 0, every sample is written to the file itself.
+            bool ExportToUsd(const std::string& filePath, int framesPerClip, std::string& errorMessage);
+
         private:
+            // Initializes the leaf prim property infos from the params object.
+            void _InitPropertyInfos();
             // Initializes the cached data from the params object.
             void _InitFromParams();
 
@@ -326,14 +462,53 @@ namespace glm
             bool _HasTargetPathValue(const SdfPath& path, VtValue* value) const;
             bool _HasPropertyTypeNameValue(const SdfPath& path, VtValue* value) const;
             bool _HasPropertyInterpolation(const SdfPath& path, VtValue* value) const;
+            bool _GetStatsAttributeValue(const TfToken& nameToken, VtValue* value) const;
+            int64_t _GetFrameCacheSize() const;
+            // logs the memory usage if GOLAEMUSD_MEMORY is enabled
+            void _DebugMemoryUsage(const char* when) const;
+            // logs the memory usage if GOLAEMUSD_MEMORY is enabled and it was not logged for GOLAEMUSD_MEMORY_PERIOD_S
+            void _DebugMemoryUsagePeriodically() const;
 
             SdfPath _CreateHierarchyFor(const glm::GlmString& hierarchy, const SdfPath& parentPath, GlmMap<GlmString, SdfPath>& existingPaths);
+            SdfPath _CreateFlatPathFor(const glm::GlmString& hierarchy, const SdfPath& parentPath, TfToken::HashSet& existingNames);
+            // computeEntityData replaces the entity of the path when computing the frame, to compute a copy of the entity
+            bool _QueryTimeSample(const SdfPath& path, double frame, EntityData::SP computeEntityData, VtValue* value);
+            // evaluates the frames in parallel, without using the frame cache of the entity
+            SdfTimeSampleMap _MakeTimeSampleMap(const SdfPath& path);
+            EntityData::SP _CloneEntityData(EntityData::SP entityData) const;
             SkelEntityFrameData::SP _ComputeSkelEntity(EntityData::SP entityData, double frame);
             SkinMeshEntityFrameData::SP _ComputeSkinMeshEntity(EntityData::SP entityData, double frame);
             void _ComputeEntityVelocities(SkinMeshEntityFrameData::SP currentFrameData, SkinMeshEntityFrameData::SP prevFrameData);
+            void _CompressEntityFrame(SkinMeshEntityFrameData::SP entityFrameData);
+            void _DecompressEntityFrame(SkinMeshEntityFrameData::SP entityFrameData);
+            bool _LoadBakedGeometry(SkinMeshEntityFrameData::SP entityFrameData, double frame);
+            bool _LoadBakedEntityFrame(SkinMeshEntityFrameData::SP entityFrameData, BakedGeometryFile& bakedFile, const BakedEntityFrameRecord& bakedEntityFrame);
+            void _WriteGeometryDiskCache(SkinMeshEntityFrameData::SP entityFrameData, size_t lodLevel, double frame);
             void _ComputeEntity(EntityFrameData::SP entityFrameData, double frame);
+            // returns true if the array was replaced by the identical array of another mesh
+            template <typename T>
+            bool _ShareMeshArray(VtArray<T>& meshArray, double frame);
             void _InvalidateEntity(EntityFrameData::SP entityFrameData);
             void _getCharacterExtent(EntityData::SP entityData, GfVec3f& extent) const;
+            template <typename T>
+            const T& _GetUsdParamValue(const TfToken& paramName, const T& defaultValue) const;
+            void _GetCameraFrustum(GfFrustum& frustum) const;
+            bool _IsEntityCulled(EntityData::SP entityData, const GfVec3f& entityPos) const;
+            void _ComputeScreenSpaceThinning(
+                const glm::crowdio::GlmSimulationData* simuData,
+                const glm::crowdio::GlmFrameData* frameData,
+                float renderPercent,
+                glm::PODArray<uint8_t>& keptEntities) const;
+            void _ComputeEntityTiles(
+                glm::crowdio::CachedSimulation& cachedSimulation,
+                const std::pair<int, int>& frameRange,
+                const std::string& cacheKey,
+                glm::Array<TfToken>& entityTileNames) const;
+            void _ComputeEntitiesInRegion(
+                glm::crowdio::CachedSimulation& cachedSimulation,
+                const std::pair<int, int>& frameRange,
+                const std::vector<GfRange3f>& regionBoxes,
+                glm::PODArray<uint8_t>& entitiesInRegion) const;
             void _ComputeBboxData(SkinMeshEntityData::SP entityData);
             void _ComputeSkinMeshTemplateData(
                 std::map<std::pair<int, int>, SkinMeshTemplateData::SP>& lodTemplateData,
@@ -371,11 +546,16 @@ namespace glm
 
         //-----------------------------------------------------------------------------
         template <class FrameDataType>
-        SmartPointer<FrameDataType> GolaemUSD_DataImpl::EntityData::getFrameData(const double& frame, size_t cachedFramesCount)
+        SmartPointer<FrameDataType> GolaemUSD_DataImpl::EntityData::getFrameData(const double& frame, size_t cachedFramesCount, RuntimeStats& stats, std::vector<EntityFrameData::SP>* pushedDownFrameDatas)
         {
             SmartPointer<FrameDataType> frameData = findFrameData<FrameDataType>(frame);
-            if (!frameData)
+            if (frameData)
+            {
+                stats.add(RuntimeStats::FRAME_CACHE_HITS);
+            }
+            else
             {
+                stats.add(RuntimeStats::FRAME_CACHE_MISSES);
                 frameData = new FrameDataType();
 
                 // remove the furthest frame data if we reached the maximum number of cached frames, then add the new one
@@ -390,6 +570,18 @@ namespace glm
                         }
                     }
                     frameDataMap.erase(itFurthestFrame);
+                    stats.add(RuntimeStats::FRAME_CACHE_EVICTIONS);
+                }
+                if (pushedDownFrameDatas != NULL)
+                {
+                    // the neighbour frames and subframes of the shutter interval and of the velocities stay hot
+                    for (auto it = frameDataMap.begin(); it != frameDataMap.end(); ++it)
+                    {
+                        if (std::abs(it.getKey() - frame) > 1.0)
+                        {
+                            pushedDownFrameDatas->push_back(it.getValue());
+                        }
+                    }
                 }
                 frameDataMap[frame] = frameData;
             }
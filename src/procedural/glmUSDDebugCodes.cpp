@@ -0,0 +1,123 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDDebugCodes.h"
+#include "glmUSDRuntimeStats.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/registryManager.h>
+#include <pxr/base/tf/getenv.h>
+#include <pxr/base/tf/envSetting.h>
+USD_INCLUDES_END
+
+PXR_NAMESPACE_OPEN_SCOPE
+TF_REGISTRY_FUNCTION(TfDebug)
+{
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GOLAEMUSD_INIT, "Golaem USD layer initialization phase timings");
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GOLAEMUSD_COMPUTE, "Golaem USD slow entity frame computes");
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GOLAEMUSD_CACHE, "Golaem USD baked geometry and geometry disk cache");
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GOLAEMUSD_LOCKS, "Golaem USD slow lock waits");
+    TF_DEBUG_ENVIRONMENT_SYMBOL(GOLAEMUSD_MEMORY, "Golaem USD layer memory usage");
+}
+
+TF_DEFINE_ENV_SETTING(GOLAEMUSD_SLOW_COMPUTE_MS, 50, "Entity frame computes slower than this are logged by GOLAEMUSD_COMPUTE");
+TF_DEFINE_ENV_SETTING(GOLAEMUSD_SLOW_LOCK_MS, 10, "Lock waits longer than this are logged by GOLAEMUSD_LOCKS");
+TF_DEFINE_ENV_SETTING(GOLAEMUSD_MEMORY_PERIOD_S, 30, "Queried layers log their memory usage this often with GOLAEMUSD_MEMORY");
+PXR_NAMESPACE_CLOSE_SCOPE
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        int64_t getSlowComputeThreshold()
+        {
+            static int64_t threshold = static_cast<int64_t>(TfGetEnvSetting(GOLAEMUSD_SLOW_COMPUTE_MS)) * 1000000;
+            return threshold;
+        }
+
+        //-----------------------------------------------------------------------------
+        int64_t getSlowLockThreshold()
+        {
+            static int64_t threshold = static_cast<int64_t>(TfGetEnvSetting(GOLAEMUSD_SLOW_LOCK_MS)) * 1000000;
+            return threshold;
+        }
+
+        //-----------------------------------------------------------------------------
+        int64_t getMemoryDebugPeriod()
+        {
+            static int64_t period = static_cast<int64_t>(TfGetEnvSetting(GOLAEMUSD_MEMORY_PERIOD_S)) * 1000000000;
+            return period;
+        }
+
+        //-----------------------------------------------------------------------------
+        DebugPhaseTimer::DebugPhaseTimer(const char* scopeName)
+            : _enabled(TfDebug::IsEnabled(GOLAEMUSD_INIT))
+            , _scopeName(scopeName)
+        {
+            if (_enabled)
+            {
+                _startTime = _phaseStartTime = RuntimeStats::now();
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        DebugPhaseTimer::~DebugPhaseTimer()
+        {
+            if (_enabled)
+            {
+                TF_DEBUG(GOLAEMUSD_INIT).Msg("[GolaemUSD] %s: %.3f ms total\n", _scopeName, (RuntimeStats::now() - _startTime) * 1e-6);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void DebugPhaseTimer::phase(const char* phaseName)
+        {
+            if (!_enabled)
+            {
+                return;
+            }
+            int64_t time = RuntimeStats::now();
+            TF_DEBUG(GOLAEMUSD_INIT).Msg("[GolaemUSD] %s: %s %.3f ms\n", _scopeName, phaseName, (time - _phaseStartTime) * 1e-6);
+            _phaseStartTime = time;
+        }
+
+        //-----------------------------------------------------------------------------
+        DebugSlowComputeTimer::DebugSlowComputeTimer(int64_t entityId, double frame)
+            : _enabled(TfDebug::IsEnabled(GOLAEMUSD_COMPUTE))
+            , _entityId(entityId)
+            , _frame(frame)
+        {
+            if (_enabled)
+            {
+                _startTime = RuntimeStats::now();
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        DebugSlowComputeTimer::~DebugSlowComputeTimer()
+        {
+            if (!_enabled)
+            {
+                return;
+            }
+            int64_t computeTime = RuntimeStats::now() - _startTime;
+            if (computeTime > getSlowComputeThreshold())
+            {
+                TF_DEBUG(GOLAEMUSD_COMPUTE).Msg("[GolaemUSD] slow compute of entity %lld at frame %g: %.3f ms\n", static_cast<long long>(_entityId), _frame, computeTime * 1e-6);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void debugLockWait(const char* lockName, int64_t waitTime)
+        {
+            if (TfDebug::IsEnabled(GOLAEMUSD_LOCKS) && waitTime > getSlowLockThreshold())
+            {
+                TF_DEBUG(GOLAEMUSD_LOCKS).Msg("[GolaemUSD] waited %.3f ms for %s\n", waitTime * 1e-6, lockName);
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,74 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/debug.h>
+USD_INCLUDES_END
+
+#include <stdint.h>
+
+// Enabled with the TF_DEBUG environment variable, e.g. TF_DEBUG="GOLAEMUSD_INIT GOLAEMUSD_COMPUTE"
+PXR_NAMESPACE_OPEN_SCOPE
+TF_DEBUG_CODES(
+    GOLAEMUSD_INIT,    // phase timings of the layer initialization
+    GOLAEMUSD_COMPUTE, // entity frame computes slower than GOLAEMUSD_SLOW_COMPUTE_MS
+    GOLAEMUSD_CACHE,   // baked geometry files and geometry disk cache
+    GOLAEMUSD_LOCKS,   // lock waits longer than GOLAEMUSD_SLOW_LOCK_MS
+    GOLAEMUSD_MEMORY   // layer memory usage after the initialization, every GOLAEMUSD_MEMORY_PERIOD_S while queried and before the release
+);
+PXR_NAMESPACE_CLOSE_SCOPE
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        // thresholds in ns
+        int64_t getSlowComputeThreshold();
+        int64_t getSlowLockThreshold();
+        int64_t getMemoryDebugPeriod();
+
+        // Logs the time spent in each phase of a function with GOLAEMUSD_INIT, does nothing if it is disabled
+        class DebugPhaseTimer
+        {
+        public:
+            DebugPhaseTimer(const char* scopeName);
+            ~DebugPhaseTimer();
+
+            // ends the current phase and starts the next one
+            void phase(const char* phaseName);
+
+        protected:
+            bool _enabled;
+            const char* _scopeName;
+            int64_t _startTime = 0;
+            int64_t _phaseStartTime = 0;
+        };
+
+        // Logs an entity frame compute with GOLAEMUSD_COMPUTE if it is slower than the threshold
+        class DebugSlowComputeTimer
+        {
+        public:
+            DebugSlowComputeTimer(int64_t entityId, double frame);
+            ~DebugSlowComputeTimer();
+
+        protected:
+            bool _enabled;
+            int64_t _entityId;
+            double _frame;
+            int64_t _startTime = 0;
+        };
+
+        // logs a lock wait with GOLAEMUSD_LOCKS if it is longer than the threshold
+        void debugLockWait(const char* lockName, int64_t waitTime);
+    } // namespace usdplugin
+} // namespace glm
@@ -60,6 +60,8 @@ namespace glm
             /// We do NOT implement WriteToFile as it doesn't make sense to write to
             /// files of this format when the contents are completely generated from the
             /// file format arguments.
+            /// These go through the usda text format, large crowds should be exported with
+            /// GolaemUSD_DataImpl::ExportToUsd (glmUsdBake --export) instead.
             bool WriteToString(const SdfLayer& layer,
                                std::string* str,
                                const std::string& comment = std::string()) const override;
@@ -0,0 +1,535 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDGeometryDiskCache.h"
+#include "glmUSDDebugCodes.h"
+
+USD_INCLUDES_START
+#include <pxr/base/arch/fileSystem.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmLog.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _MSC_VER
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        // entity frames computed while the queue is full are not cached
+        static const size_t MAX_PENDING_WRITES = 1024;
+        // the entity frames of a frame are written to one file once no entity frame was added for this delay, or once the file is big enough
+        static const std::chrono::seconds PENDING_FRAME_DELAY(2);
+        static const size_t MAX_FILE_SIZE = 256 * 1024 * 1024;
+        // eviction removes files until the cache is below this ratio of its max size, so that it does not run for every write
+        static const double EVICTION_TARGET_RATIO = 0.9;
+        // period of the eviction of old files, when the size limit is not reached
+        static const std::chrono::seconds AGE_EVICTION_PERIOD(600);
+        // temporary files older than this are left by interrupted writers
+        static const double STALE_TEMPORARY_FILE_AGE = 3600;
+
+        //-----------------------------------------------------------------------------
+        inline double getCurrentTime()
+        {
+            return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        //-----------------------------------------------------------------------------
+        inline uint64_t getFileSize(const std::string& filePath)
+        {
+            return static_cast<uint64_t>(std::max<int64_t>(ArchGetFileLength(filePath.c_str()), 0));
+        }
+
+        //-----------------------------------------------------------------------------
+        // only removes empty directories, fails silently otherwise
+        inline void removeEmptyDir(const std::string& dirPath)
+        {
+            rmdir(dirPath.c_str());
+        }
+
+        //-----------------------------------------------------------------------------
+        GeometryDiskCache::~GeometryDiskCache()
+        {
+            close();
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::open(const std::string& cacheDir, uint64_t paramsHash, bool halfNormals, uint64_t maxSize, double maxAge)
+        {
+            close();
+
+            // one sub directory per params hash, so that layers with different params never read each other's files
+            std::string paramsDir = TfStringCatPaths(cacheDir, TfStringPrintf("%016llx", static_cast<unsigned long long>(paramsHash)));
+            if (!TfIsDir(paramsDir) && !TfMakeDirs(paramsDir, -1, true))
+            {
+                GLM_CROWD_TRACE_WARNING("Could not create the geometry cache directory '" << paramsDir << "', the geometry will not be cached");
+                return;
+            }
+
+            _cacheDir = cacheDir;
+            _paramsDir = paramsDir;
+            _paramsHash = paramsHash;
+            _halfNormals = halfNormals;
+            _maxSize = maxSize;
+            _maxAge = maxAge;
+            _totalSize = 0;
+            _lastEvictionTime = std::chrono::steady_clock::now();
+            _stopWriting = false;
+            _fileNameGenerator.seed(std::random_device()());
+            _writeThread = std::thread(&GeometryDiskCache::_writeLoop, this);
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::close()
+        {
+            if (!_writeThread.joinable())
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(_queueLock);
+                _stopWriting = true;
+            }
+            _queueCondition.notify_one();
+            _writeThread.join();
+
+            std::lock_guard<std::mutex> lock(_indexLock);
+            for (auto& itFile : _files)
+            {
+                if (itFile.second.file != NULL)
+                {
+                    itFile.second.file->release();
+                }
+            }
+            _files.clear();
+            _frames.clear();
+            _totalSize = 0;
+            _paramsDir.clear();
+        }
+
+        //-----------------------------------------------------------------------------
+        bool GeometryDiskCache::isOpen() const
+        {
+            return !_paramsDir.empty();
+        }
+
+        //-----------------------------------------------------------------------------
+        std::string GeometryDiskCache::_getFrameDir(int frame) const
+        {
+            return TfStringPrintf("%s/%d", _paramsDir.c_str(), frame);
+        }
+
+        //-----------------------------------------------------------------------------
+        const BakedEntityFrameRecord* GeometryDiskCache::findEntityFrame(int64_t entityId, int frame, BakedGeometryFile*& file, VtArray<char>& fileKeepAlive)
+        {
+            if (!isOpen())
+            {
+                return NULL;
+            }
+            std::lock_guard<std::mutex> lock(_indexLock);
+            const BakedEntityFrameRecord* entityFrame = _findEntityFrame(entityId, frame, file);
+            if (entityFrame != NULL)
+            {
+                fileKeepAlive = file->getKeepAlive();
+            }
+            return entityFrame;
+        }
+
+        //-----------------------------------------------------------------------------
+        const BakedEntityFrameRecord* GeometryDiskCache::_findEntityFrame(int64_t entityId, int frame, BakedGeometryFile*& file)
+        {
+            CachedFrame& cachedFrame = _frames[frame];
+            for (int iPass = 0; iPass < 2; ++iPass)
+            {
+                for (const std::string& filePath : cachedFrame.filePaths)
+                {
+                    CachedFile& cachedFile = _files[filePath];
+                    if (cachedFile.file == NULL)
+                    {
+                        continue;
+                    }
+                    const BakedEntityFrameRecord* entityFrame = cachedFile.file->findEntityFrame(entityId, frame);
+                    if (entityFrame != NULL)
+                    {
+                        cachedFile.lastUseTime = getCurrentTime();
+                        if (!cachedFile.used)
+                        {
+                            // the modification time keeps the last use order for the next sessions
+                            TfTouchFile(filePath, false);
+                            cachedFile.used = true;
+                        }
+                        file = cachedFile.file;
+                        return entityFrame;
+                    }
+                }
+                if (iPass == 0)
+                {
+                    // files may have been written by other processes
+                    _scanFrameDir(frame, cachedFrame);
+                }
+            }
+            return NULL;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_scanFrameDir(int frame, CachedFrame& cachedFrame)
+        {
+            std::string frameDir = _getFrameDir(frame);
+            double dirModificationTime = -1;
+            if (!ArchGetModificationTime(frameDir.c_str(), &dirModificationTime) || dirModificationTime == cachedFrame.dirModificationTime)
+            {
+                return;
+            }
+            cachedFrame.dirModificationTime = dirModificationTime;
+
+            std::vector<std::string> dirNames;
+            std::vector<std::string> fileNames;
+            TfReadDir(frameDir, &dirNames, &fileNames, nullptr);
+            for (const std::string& fileName : fileNames)
+            {
+                if (!TfStringEndsWith(fileName, BAKED_GEOMETRY_FILE_EXTENSION))
+                {
+                    continue;
+                }
+                std::string filePath = TfStringCatPaths(frameDir, fileName);
+                auto itFile = _files.find(filePath);
+                if (itFile != _files.end() && itFile->second.file != NULL)
+                {
+                    continue;
+                }
+                std::string errorMessage;
+                BakedGeometryFile* file = BakedGeometryFile::open(filePath, errorMessage);
+                if (file == NULL)
+                {
+                    // removed by another process
+                    continue;
+                }
+                if (file->getHeader().paramsHash != _paramsHash)
+                {
+                    file->release();
+                    continue;
+                }
+                CachedFile& cachedFile = itFile != _files.end() ? itFile->second : _addFile(filePath, getFileSize(filePath), getCurrentTime());
+                cachedFile.frame = frame;
+                cachedFile.file = file;
+                cachedFrame.filePaths.push_back(filePath);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        GeometryDiskCache::CachedFile& GeometryDiskCache::_addFile(const std::string& filePath, uint64_t size, double lastUseTime)
+        {
+            // a file may already be indexed, e.g. found by the scan of its frame directory before its writer indexed it
+            CachedFile& cachedFile = _files[filePath];
+            _totalSize -= std::min(cachedFile.size, _totalSize);
+            cachedFile.size = size;
+            cachedFile.lastUseTime = lastUseTime;
+            _totalSize += size;
+            return cachedFile;
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_removeFile(CachedFileIterator itFile)
+        {
+            const std::string& filePath = itFile->first;
+            CachedFile& cachedFile = itFile->second;
+            // files still used by arrays stay mapped until they are released
+            ArchUnlinkFile(filePath.c_str());
+            removeEmptyDir(TfGetPathName(filePath));
+            if (cachedFile.file != NULL)
+            {
+                cachedFile.file->release();
+            }
+            auto itFrame = _frames.find(cachedFile.frame);
+            if (itFrame != _frames.end())
+            {
+                std::vector<std::string>& filePaths = itFrame->second.filePaths;
+                filePaths.erase(std::remove(filePaths.begin(), filePaths.end(), filePath), filePaths.end());
+            }
+            _totalSize -= std::min(cachedFile.size, _totalSize);
+            _files.erase(itFile);
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_evict()
+        {
+            _lastEvictionTime = std::chrono::steady_clock::now();
+            if (_maxSize == 0 && _maxAge <= 0)
+            {
+                return;
+            }
+
+            size_t removedFileCount = 0;
+            double now = getCurrentTime();
+            std::vector<CachedFileIterator> cachedFiles;
+            cachedFiles.reserve(_files.size());
+            for (auto itFile = _files.begin(); itFile != _files.end();)
+            {
+                auto itCurrentFile = itFile++;
+                if (_maxAge > 0 && now - itCurrentFile->second.lastUseTime > _maxAge)
+                {
+                    _removeFile(itCurrentFile);
+                    ++removedFileCount;
+                    continue;
+                }
+                cachedFiles.push_back(itCurrentFile);
+            }
+
+            if (_maxSize > 0 && _totalSize > _maxSize)
+            {
+                // least recently used files first
+                std::sort(cachedFiles.begin(), cachedFiles.end(), [](const CachedFileIterator& itFile, const CachedFileIterator& itOtherFile) { return itFile->second.lastUseTime < itOtherFile->second.lastUseTime; });
+                uint64_t targetSize = static_cast<uint64_t>(_maxSize * EVICTION_TARGET_RATIO);
+                for (const auto& itFile : cachedFiles)
+                {
+                    if (_totalSize <= targetSize)
+                    {
+                        break;
+                    }
+                    _removeFile(itFile);
+                    ++removedFileCount;
+                }
+            }
+            TF_DEBUG(GOLAEMUSD_CACHE).Msg("[GolaemUSD] geometry cache eviction: %zu files removed, %llu bytes kept\n", removedFileCount, static_cast<unsigned long long>(_totalSize));
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_scanCacheDir()
+        {
+            // the only scan of the whole cache directory, files of other params count in the size limit
+            double now = getCurrentTime();
+            std::vector<std::pair<std::string, CachedFile>> cachedFiles;
+            std::vector<std::string> dirPaths;
+            for (const std::string& path : TfListDir(_cacheDir, true))
+            {
+                if (TfIsDir(path))
+                {
+                    dirPaths.push_back(path);
+                    continue;
+                }
+                std::string fileName = TfGetBaseName(path);
+                double modificationTime = 0;
+                if (!ArchGetModificationTime(path.c_str(), &modificationTime))
+                {
+                    // removed by another process
+                    continue;
+                }
+                if (TfStringEndsWith(fileName, BAKED_GEOMETRY_FILE_EXTENSION))
+                {
+                    int64_t size = ArchGetFileLength(path.c_str());
+                    if (size >= 0)
+                    {
+                        cachedFiles.push_back({path, CachedFile()});
+                        cachedFiles.back().second.size = static_cast<uint64_t>(size);
+                        cachedFiles.back().second.lastUseTime = modificationTime;
+                    }
+                }
+                else if (fileName.find(std::string(BAKED_GEOMETRY_FILE_EXTENSION) + ".") != std::string::npos && now - modificationTime > STALE_TEMPORARY_FILE_AGE)
+                {
+                    // temporary file of an interrupted write
+                    ArchUnlinkFile(path.c_str());
+                }
+            }
+            // deepest directories first, the params directory is kept
+            std::sort(dirPaths.begin(), dirPaths.end(), [](const std::string& path, const std::string& otherPath) { return path.size() > otherPath.size(); });
+            for (const std::string& dirPath : dirPaths)
+            {
+                if (TfNormPath(dirPath) != TfNormPath(_paramsDir))
+                {
+                    removeEmptyDir(dirPath);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(_indexLock);
+            for (const auto& itFile : cachedFiles)
+            {
+                // files already found by a lookup are kept
+                if (_files.find(itFile.first) == _files.end())
+                {
+                    _addFile(itFile.first, itFile.second.size, itFile.second.lastUseTime);
+                }
+            }
+            _evict();
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::write(EntityFrameEntry&& entityFrame)
+        {
+            if (!isOpen())
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(_queueLock);
+                if (_writeQueue.size() >= MAX_PENDING_WRITES)
+                {
+                    return;
+                }
+                _writeQueue.push_back(std::move(entityFrame));
+            }
+            _queueCondition.notify_one();
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_writeLoop()
+        {
+            _scanCacheDir();
+
+            std::map<int, PendingFrame> pendingFrames;
+            bool writeErrorReported = false;
+            for (;;)
+            {
+                EntityFrameEntry entityFrame;
+                bool hasEntityFrame = false;
+                bool stopWriting = false;
+                {
+                    std::unique_lock<std::mutex> lock(_queueLock);
+                    _queueCondition.wait_for(lock, PENDING_FRAME_DELAY, [this]() { return _stopWriting || !_writeQueue.empty(); });
+                    if (!_writeQueue.empty())
+                    {
+                        entityFrame = std::move(_writeQueue.front());
+                        _writeQueue.pop_front();
+                        hasEntityFrame = true;
+                    }
+                    else
+                    {
+                        // pending writes are done before stopping
+                        stopWriting = _stopWriting;
+                    }
+                }
+
+                if (hasEntityFrame)
+                {
+                    _addPendingEntityFrame(pendingFrames, entityFrame);
+                }
+
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                for (auto itPendingFrame = pendingFrames.begin(); itPendingFrame != pendingFrames.end();)
+                {
+                    const PendingFrame& pendingFrame = itPendingFrame->second;
+                    if (stopWriting || now - pendingFrame.lastAddTime >= PENDING_FRAME_DELAY || pendingFrame.writer->getDataSize() >= MAX_FILE_SIZE)
+                    {
+                        _writePendingFrame(itPendingFrame->first, pendingFrame, writeErrorReported);
+                        itPendingFrame = pendingFrames.erase(itPendingFrame);
+                    }
+                    else
+                    {
+                        ++itPendingFrame;
+                    }
+                }
+
+                if (stopWriting)
+                {
+                    break;
+                }
+                if (_maxAge > 0 && now - _lastEvictionTime > AGE_EVICTION_PERIOD)
+                {
+                    std::lock_guard<std::mutex> lock(_indexLock);
+                    _evict();
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_addPendingEntityFrame(std::map<int, PendingFrame>& pendingFrames, const EntityFrameEntry& entityFrame)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_indexLock);
+                BakedGeometryFile* file = NULL;
+                if (_findEntityFrame(entityFrame.entityId, entityFrame.frame, file) != NULL)
+                {
+                    // already cached, possibly by another process
+                    return;
+                }
+            }
+
+            PendingFrame& pendingFrame = pendingFrames[entityFrame.frame];
+            if (!pendingFrame.entityIds.insert(entityFrame.entityId).second)
+            {
+                return;
+            }
+            if (pendingFrame.writer == nullptr)
+            {
+                pendingFrame.writer.reset(new BakedGeometryWriter(_paramsHash, _halfNormals));
+            }
+            pendingFrame.lastAddTime = std::chrono::steady_clock::now();
+
+            BakedGeometryWriter& writer = *pendingFrame.writer;
+            writer.addEntityFrame(entityFrame.entityId, entityFrame.frame, entityFrame.geometryFileIdx);
+            for (const MeshEntry& mesh : entityFrame.meshes)
+            {
+                if (_halfNormals)
+                {
+                    writer.addMesh(mesh.meshKey.first, mesh.meshKey.second, mesh.points, mesh.halfNormals, mesh.extent);
+                }
+                else
+                {
+                    writer.addMesh(mesh.meshKey.first, mesh.meshKey.second, mesh.points, mesh.normals, mesh.extent);
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void GeometryDiskCache::_writePendingFrame(int frame, const PendingFrame& pendingFrame, bool& writeErrorReported)
+        {
+            // unique name, several processes can write the same frame
+            std::string frameDir = _getFrameDir(frame);
+            std::string filePath = TfStringPrintf("%s/%016llx%s", frameDir.c_str(), static_cast<unsigned long long>(_fileNameGenerator()), BAKED_GEOMETRY_FILE_EXTENSION);
+
+            std::string errorMessage;
+            bool written = false;
+            // a second try in case another process removed the empty frame directory meanwhile
+            for (int iTry = 0; iTry < 2 && !written; ++iTry)
+            {
+                written = (TfIsDir(frameDir) || TfMakeDirs(frameDir, -1, true)) && pendingFrame.writer->write(filePath, errorMessage);
+            }
+            if (!written)
+            {
+                if (!writeErrorReported)
+                {
+                    GLM_CROWD_TRACE_WARNING("Could not write to the geometry cache '" << filePath << "': " << errorMessage);
+                    writeErrorReported = true;
+                }
+                return;
+            }
+            TF_DEBUG(GOLAEMUSD_CACHE).Msg("[GolaemUSD] %zu entities of frame %d written to the geometry cache\n", pendingFrame.entityIds.size(), frame);
+
+            BakedGeometryFile* file = BakedGeometryFile::open(filePath, errorMessage);
+            std::lock_guard<std::mutex> lock(_indexLock);
+            CachedFile& cachedFile = _addFile(filePath, getFileSize(filePath), getCurrentTime());
+            cachedFile.used = true;
+            if (file != NULL)
+            {
+                if (cachedFile.file == NULL)
+                {
+                    cachedFile.frame = frame;
+                    cachedFile.file = file;
+                    _frames[frame].filePaths.push_back(filePath);
+                }
+                else
+                {
+                    // already registered by the scan of the frame directory
+                    file->release();
+                }
+            }
+            if (_maxSize > 0 && _totalSize > _maxSize)
+            {
+                _evict();
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,124 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include "glmUSDBakedGeometry.h"
+
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        // Read-through cache of the deformed meshes of entity frames. The entity frames of a frame are packed in a few
+        // baked geometry files per frame, written in the background and renamed once complete, so several processes can
+        // share the same directory. The directory is only scanned when the cache is opened, files are then tracked in
+        // memory and evicted by last use.
+        class GeometryDiskCache
+        {
+        public:
+            struct MeshEntry
+            {
+                std::pair<int, int> meshKey; // gchaMeshId, meshMaterialIndex
+                VtVec3fArray points;
+                VtVec3fArray normals;
+                VtVec3hArray halfNormals;
+                VtVec3fArray extent;
+            };
+
+            struct EntityFrameEntry
+            {
+                int64_t entityId = -1;
+                int frame = 0;
+                uint32_t geometryFileIdx = 0;
+                std::vector<MeshEntry> meshes;
+            };
+
+            ~GeometryDiskCache();
+
+            // maxSize in bytes and maxAge in seconds, 0 to disable the eviction
+            void open(const std::string& cacheDir, uint64_t paramsHash, bool halfNormals, uint64_t maxSize, double maxAge);
+            // writes the pending entity frames
+            void close();
+            bool isOpen() const;
+
+            // returns NULL if the entity frame is not in the cache, the file is owned by the cache and stays valid while
+            // fileKeepAlive is held, even if it is evicted meanwhile
+            const BakedEntityFrameRecord* findEntityFrame(int64_t entityId, int frame, BakedGeometryFile*& file, VtArray<char>& fileKeepAlive);
+            // the arrays are shared, the file is written by the background thread
+            void write(EntityFrameEntry&& entityFrame);
+
+        protected:
+            struct CachedFile
+            {
+                int frame = INT_MIN;            // INT_MIN for the files of other params
+                BakedGeometryFile* file = NULL; // opened on the first lookup of its frame
+                uint64_t size = 0;
+                double lastUseTime = 0; // modification time until the file is used, the first use touches the file
+                bool used = false;
+            };
+
+            typedef std::map<std::string, CachedFile>::iterator CachedFileIterator;
+
+            struct CachedFrame
+            {
+                double dirModificationTime = -1; // the frame directory is scanned again when it changes
+                std::vector<std::string> filePaths;
+            };
+
+            struct PendingFrame
+            {
+                std::unique_ptr<BakedGeometryWriter> writer;
+                std::set<int64_t> entityIds;
+                std::chrono::steady_clock::time_point lastAddTime;
+            };
+
+            std::string _getFrameDir(int frame) const;
+            // the methods below need _indexLock
+            const BakedEntityFrameRecord* _findEntityFrame(int64_t entityId, int frame, BakedGeometryFile*& file);
+            void _scanFrameDir(int frame, CachedFrame& cachedFrame);
+            CachedFile& _addFile(const std::string& filePath, uint64_t size, double lastUseTime);
+            void _removeFile(CachedFileIterator itFile);
+            void _evict();
+
+            void _scanCacheDir();
+            void _writeLoop();
+            void _addPendingEntityFrame(std::map<int, PendingFrame>& pendingFrames, const EntityFrameEntry& entityFrame);
+            void _writePendingFrame(int frame, const PendingFrame& pendingFrame, bool& writeErrorReported);
+
+            std::string _cacheDir;
+            std::string _paramsDir;
+            uint64_t _paramsHash = 0;
+            bool _halfNormals = false;
+            uint64_t _maxSize = 0;
+            double _maxAge = 0;
+
+            mutable std::mutex _indexLock;
+            std::map<std::string, CachedFile> _files; // every file of the cache directory, per path
+            std::map<int, CachedFrame> _frames;       // files of the layer params, per frame
+            uint64_t _totalSize = 0;
+            std::chrono::steady_clock::time_point _lastEvictionTime;
+
+            std::thread _writeThread;
+            std::mutex _queueLock;
+            std::condition_variable _queueCondition;
+            std::deque<EntityFrameEntry> _writeQueue;
+            bool _stopWriting = false;
+            std::mt19937_64 _fileNameGenerator;
+        };
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,288 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDKernels.h"
+
+#include <glmCore.h>
+
+#include <fbxsdk.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        void toHalfArray(const VtVec3fArray& values, VtVec3hArray& halfValues)
+        {
+            halfValues.resize(values.size());
+            for (size_t iValue = 0, valueCount = values.size(); iValue < valueCount; ++iValue)
+            {
+                halfValues[iValue] = GfVec3h(values[iValue]);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void finalizeVertexNormals(VtVec3fArray& normals, VtVec3hArray& halfNormals, bool halfPrecision)
+        {
+            for (GfVec3f& normal : normals)
+            {
+                normal.Normalize();
+            }
+            if (halfPrecision)
+            {
+                toHalfArray(normals, halfNormals);
+                normals = VtVec3fArray();
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void gatherPoints(const glm::Array<glm::Vector3>& deformedVertices, const glm::PODArray<int>* vertexMasks, const FbxAMatrix* transform, const GfVec3f& entityPos, VtVec3fArray& points, GfRange3f& extent)
+        {
+            FbxVector4 fbxVect;
+            size_t iActualVertex = 0;
+            for (size_t iVertex = 0, vertexCount = deformedVertices.size(); iVertex < vertexCount; ++iVertex)
+            {
+                if (vertexMasks != NULL && (*vertexMasks)[iVertex] < 0)
+                {
+                    continue;
+                }
+                GfVec3f& point = points[iActualVertex];
+                const glm::Vector3& deformedVertex = deformedVertices[iVertex];
+                if (transform != NULL)
+                {
+                    // transform vertex in case of local transformation
+                    fbxVect.Set(deformedVertex.x, deformedVertex.y, deformedVertex.z);
+                    fbxVect = transform->MultT(fbxVect);
+                    point.Set((float)fbxVect[0], (float)fbxVect[1], (float)fbxVect[2]);
+                }
+                else
+                {
+                    point.Set(deformedVertex.getFloatValues());
+                }
+                point -= entityPos;
+                extent.UnionWith(point);
+                ++iActualVertex;
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void gatherPolygonVertexNormals(const glm::Array<glm::Vector3>& deformedNormals, const uint32_t* normalIndices, size_t polygonVertexCount, const int* vertexNormalIndices, VtVec3fArray& normals, VtVec3hArray& halfNormals)
+        {
+            for (size_t iVertex = 0; iVertex < polygonVertexCount; ++iVertex)
+            {
+                // do not reverse polygon order
+                const glm::Vector3& vtxNormal = deformedNormals[normalIndices != NULL ? normalIndices[iVertex] : iVertex];
+                setNormalValue(normals, halfNormals, vertexNormalIndices, iVertex, vtxNormal.getFloatValues());
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void gatherFbxPolygonVertexNormals(const glm::Array<glm::Vector3>& deformedNormals, FbxMesh* fbxMesh, const glm::PODArray<int>& polygonMasks, const FbxAMatrix* rotation, const int* vertexNormalIndices, VtVec3fArray& normals, VtVec3hArray& halfNormals)
+        {
+            // deformedNormals contains all fbx normals, not just the ones that were filtered by polygonMasks
+            FbxVector4 fbxVect;
+            for (int iFbxPoly = 0, fbxPolyCount = fbxMesh->GetPolygonCount(), iFbxNormal = 0, iActualPolyVertex = 0; iFbxPoly < fbxPolyCount; ++iFbxPoly)
+            {
+                int polySize = fbxMesh->GetPolygonSize(iFbxPoly);
+                if (!polygonMasks[iFbxPoly])
+                {
+                    iFbxNormal += polySize;
+                    continue;
+                }
+                for (int iPolyVertex = 0; iPolyVertex < polySize; ++iPolyVertex, ++iFbxNormal, ++iActualPolyVertex)
+                {
+                    // do not reverse polygon order
+                    const glm::Vector3& deformedNormal = deformedNormals[iFbxNormal];
+                    if (rotation != NULL)
+                    {
+                        fbxVect.Set(deformedNormal.x, deformedNormal.y, deformedNormal.z);
+                        fbxVect = rotation->MultT(fbxVect);
+                        float rotatedNormal[3] = {(float)fbxVect[0], (float)fbxVect[1], (float)fbxVect[2]};
+                        setNormalValue(normals, halfNormals, vertexNormalIndices, iActualPolyVertex, rotatedNormal);
+                    }
+                    else
+                    {
+                        setNormalValue(normals, halfNormals, vertexNormalIndices, iActualPolyVertex, deformedNormal.getFloatValues());
+                    }
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void computeLocalScales(const glm::PODArray<int>& fatherBoneIndices, const glm::Array<glm::Vector3>& worldScales, VtVec3hArray& scales)
+        {
+            for (size_t iBone = 0, boneCount = scales.size(); iBone < boneCount; ++iBone)
+            {
+                // skip scales parented to root, root holds the entityScale and cannot be SnS'ed
+                int fatherBoneIndex = fatherBoneIndices[iBone];
+                if (fatherBoneIndex >= 0)
+                {
+                    GfVec3h& scaleValue = scales[iBone];
+                    const glm::Vector3& fatherScale = worldScales[fatherBoneIndex];
+                    scaleValue[0] /= fatherScale[0];
+                    scaleValue[1] /= fatherScale[1];
+                    scaleValue[2] /= fatherScale[2];
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void computeLocalJoints(
+            const glm::crowdio::GlmFrameData* frameData,
+            uint32_t bonePositionOffset,
+            const glm::PODArray<size_t>& specificToCacheBoneIndices,
+            const glm::PODArray<int>& fatherBoneIndices,
+            float entityScale,
+            const glm::Array<glm::Vector3>* worldScales,
+            VtVec3fArray& translations,
+            VtQuatfArray& rotations)
+        {
+            for (size_t iBone = 0, boneCount = translations.size(); iBone < boneCount; ++iBone)
+            {
+                size_t boneIndexInCache = specificToCacheBoneIndices[iBone];
+
+                Vector3 currentPosValues(frameData->_bonePositions[bonePositionOffset + boneIndexInCache]);
+                Quaternion boneWOri(frameData->_boneOrientations[bonePositionOffset + boneIndexInCache]);
+                Quaternion fatherBoneWOri(0, 0, 0, 1);
+                // in joint reference
+                int fatherBoneIndex = fatherBoneIndices[iBone];
+                if (fatherBoneIndex >= 0)
+                {
+                    size_t fatherBoneIndexInCache = specificToCacheBoneIndices[fatherBoneIndex];
+                    Vector3 fatherBoneWPos(frameData->_bonePositions[bonePositionOffset + fatherBoneIndexInCache]);
+                    fatherBoneWOri.setValues(frameData->_boneOrientations[bonePositionOffset + fatherBoneIndexInCache]);
+
+                    // in local coordinates
+                    currentPosValues = fatherBoneWOri.computeInverse() * (currentPosValues - fatherBoneWPos);
+                    currentPosValues /= entityScale;
+
+                    // also need to take back parent scale value
+                    if (worldScales != NULL && fatherBoneIndex < worldScales->sizeInt())
+                    {
+                        const Vector3& parentScale = (*worldScales)[fatherBoneIndex];
+                        currentPosValues[0] /= parentScale.x;
+                        currentPosValues[1] /= parentScale.y;
+                        currentPosValues[2] /= parentScale.z;
+                    }
+                }
+
+                Quaternion boneLOri = fatherBoneWOri.computeInverse() * boneWOri;
+
+                translations[iBone] = GfVec3f(currentPosValues.getFloatValues());
+                rotations[iBone] = GfQuatf(boneLOri.w, boneLOri.x, boneLOri.y, boneLOri.z);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void copyShaderAttributes(
+            const glm::Array<glm::ShaderAttribute>& shaderAttributes,
+            const glm::PODArray<size_t>& globalToSpecificShaderAttrIdx,
+            const glm::PODArray<int>& intData,
+            const glm::PODArray<float>& floatData,
+            const glm::Array<glm::GlmString>& stringData,
+            const glm::Array<glm::Vector3>& vectorData,
+            glm::PODArray<int>& intValues,
+            glm::PODArray<float>& floatValues,
+            glm::Array<TfToken>& stringValues,
+            glm::Array<GfVec3f>& vectorValues)
+        {
+            for (size_t iShaderAttr = 0, shaderAttrCount = shaderAttributes.size(); iShaderAttr < shaderAttrCount; ++iShaderAttr)
+            {
+                size_t specificAttrIdx = globalToSpecificShaderAttrIdx[iShaderAttr];
+                switch (shaderAttributes[iShaderAttr]._type)
+                {
+                case glm::ShaderAttributeType::INT:
+                    intValues[specificAttrIdx] = intData[specificAttrIdx];
+                    break;
+                case glm::ShaderAttributeType::FLOAT:
+                    floatValues[specificAttrIdx] = floatData[specificAttrIdx];
+                    break;
+                case glm::ShaderAttributeType::STRING:
+                    stringValues[specificAttrIdx] = TfToken(stringData[specificAttrIdx].c_str());
+                    break;
+                case glm::ShaderAttributeType::VECTOR:
+                    vectorValues[specificAttrIdx].Set(vectorData[specificAttrIdx].getFloatValues());
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void copyPPAttributes(const glm::crowdio::GlmSimulationData* simuData, const glm::crowdio::GlmFrameData* frameData, uint32_t entityIndex, glm::PODArray<float>& floatValues, glm::Array<GfVec3f>& vectorValues)
+        {
+            floatValues.resize(simuData->_ppFloatAttributeCount, 0);
+            vectorValues.resize(simuData->_ppVectorAttributeCount, GfVec3f(0));
+            for (uint8_t iFloatPPAttr = 0; iFloatPPAttr < simuData->_ppFloatAttributeCount; ++iFloatPPAttr)
+            {
+                floatValues[iFloatPPAttr] = frameData->_ppFloatAttributeData[iFloatPPAttr][entityIndex];
+            }
+            for (uint8_t iVectPPAttr = 0; iVectPPAttr < simuData->_ppVectorAttributeCount; ++iVectPPAttr)
+            {
+                vectorValues[iVectPPAttr].Set(frameData->_ppVectorAttributeData[iVectPPAttr][entityIndex]);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void computeVelocities(const VtVec3fArray& currentPoints, const VtVec3fArray& prevPoints, float fps, VtVec3fArray& velocities)
+        {
+            velocities.resize(currentPoints.size());
+            for (size_t iPoint = 0, pointCount = currentPoints.size(); iPoint < pointCount; ++iPoint)
+            {
+                velocities[iPoint] = (currentPoints[iPoint] - prevPoints[iPoint]) * fps;
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void computeVelocities(const VtVec3fArray& currentPoints, const VtVec3fArray& prevPoints, float fps, VtVec3hArray& velocities)
+        {
+            velocities.resize(currentPoints.size());
+            for (size_t iPoint = 0, pointCount = currentPoints.size(); iPoint < pointCount; ++iPoint)
+            {
+                velocities[iPoint] = GfVec3h((currentPoints[iPoint] - prevPoints[iPoint]) * fps);
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        void computeBoxMesh(const GfVec3f& halfExtents, const VtIntArray& faceVertexIndices, bool vertexNormals, VtVec3fArray& points, VtVec3fArray& normals)
+        {
+            points.resize(8);
+            points[0].Set(-halfExtents[0], -halfExtents[1], +halfExtents[2]);
+            points[1].Set(+halfExtents[0], -halfExtents[1], +halfExtents[2]);
+            points[2].Set(+halfExtents[0], -halfExtents[1], -halfExtents[2]);
+            points[3].Set(-halfExtents[0], -halfExtents[1], -halfExtents[2]);
+            points[4].Set(-halfExtents[0], +halfExtents[1], +halfExtents[2]);
+            points[5].Set(+halfExtents[0], +halfExtents[1], +halfExtents[2]);
+            points[6].Set(+halfExtents[0], +halfExtents[1], -halfExtents[2]);
+            points[7].Set(-halfExtents[0], +halfExtents[1], -halfExtents[2]);
+
+            // one normal per face vertex, 4 per face
+            static const GfVec3f faceNormals[6] = {GfVec3f(0, -1, 0), GfVec3f(1, 0, 0), GfVec3f(0, 0, -1), GfVec3f(-1, 0, 0), GfVec3f(0, 0, 1), GfVec3f(0, 1, 0)};
+            normals.resize(24);
+            for (int iFace = 0, vertexIdx = 0; iFace < 6; ++iFace)
+            {
+                for (int iVtx = 0; iVtx < 4; ++iVtx, ++vertexIdx)
+                {
+                    normals[vertexIdx] = faceNormals[iFace];
+                }
+            }
+
+            if (vertexNormals)
+            {
+                // average the face normals at the box corners
+                VtVec3fArray pointNormals(points.size(), GfVec3f(0.0f, 0.0f, 0.0f));
+                for (size_t iPolyVertex = 0, polyVertexCount = faceVertexIndices.size(); iPolyVertex < polyVertexCount; ++iPolyVertex)
+                {
+                    pointNormals[faceVertexIndices[iPolyVertex]] += normals[iPolyVertex];
+                }
+                VtVec3hArray unusedHalfNormals;
+                finalizeVertexNormals(pointNormals, unusedHalfNormals, false);
+                normals = pointNormals;
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+// Inner loops of the entity computes. They only depend on their inputs, so that glmUsdKernelBench can measure them on
+// synthetic data, without a stage or a simulation cache.
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/gf/quatf.h>
+#include <pxr/base/gf/range3f.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3h.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/base/vt/types.h>
+USD_INCLUDES_END
+
+#include <glmCrowdIO.h>
+#include <glmGolaemCharacter.h>
+
+#include <stdint.h>
+
+namespace fbxsdk
+{
+    class FbxAMatrix;
+    class FbxMesh;
+} // namespace fbxsdk
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        //-----------------------------------------------------------------------------
+        // sets a vector in the float array, or in the half array when it was allocated instead (half precision mode)
+        inline void setVectorValue(VtVec3fArray& values, VtVec3hArray& halfValues, size_t index, const float* value)
+        {
+            if (halfValues.empty())
+            {
+                values[index].Set(value);
+            }
+            else
+            {
+                halfValues[index] = GfVec3h(GfVec3f(value));
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        // sets the normal of a polygon vertex, or adds it to the normal of its point when vertexIndices is given
+        inline void setNormalValue(VtVec3fArray& normals, VtVec3hArray& halfNormals, const int* vertexIndices, size_t iPolyVertex, const float* normal)
+        {
+            if (vertexIndices != NULL)
+            {
+                normals[vertexIndices[iPolyVertex]] += GfVec3f(normal);
+            }
+            else
+            {
+                setVectorValue(normals, halfNormals, iPolyVertex, normal);
+            }
+        }
+
+        void toHalfArray(const VtVec3fArray& values, VtVec3hArray& halfValues);
+
+        // normalizes the accumulated point normals, they are moved to the half array in half precision mode
+        void finalizeVertexNormals(VtVec3fArray& normals, VtVec3hArray& halfNormals, bool halfPrecision);
+
+        // Copies the deformed vertices kept by vertexMasks (all of them if NULL) to points, relative to the entity
+        // position, and adds them to extent. transform is the FBX mesh transform, NULL if it is the identity.
+        void gatherPoints(const glm::Array<glm::Vector3>& deformedVertices, const glm::PODArray<int>* vertexMasks, const fbxsdk::FbxAMatrix* transform, const GfVec3f& entityPos, VtVec3fArray& points, GfRange3f& extent);
+
+        // Copies the deformed normals of the polygon vertices of a GCG mesh, read through normalIndices if it is not NULL.
+        // vertexNormalIndices gives the point of each polygon vertex in vertex normals mode, NULL otherwise.
+        void gatherPolygonVertexNormals(const glm::Array<glm::Vector3>& deformedNormals, const uint32_t* normalIndices, size_t polygonVertexCount, const int* vertexNormalIndices, VtVec3fArray& normals, VtVec3hArray& halfNormals);
+
+        // Copies the deformed normals of the polygons kept by polygonMasks of an FBX mesh.
+        // rotation is the FBX mesh rotation, NULL if it is the identity.
+        void gatherFbxPolygonVertexNormals(const glm::Array<glm::Vector3>& deformedNormals, fbxsdk::FbxMesh* fbxMesh, const glm::PODArray<int>& polygonMasks, const fbxsdk::FbxAMatrix* rotation, const int* vertexNormalIndices, VtVec3fArray& normals, VtVec3hArray& halfNormals);
+
+        // Converts the world space sns values of the bones to the local scales of the joints, the root scale is left unchanged.
+        // fatherBoneIndices are specific bone indices, -1 for the root.
+        void computeLocalScales(const glm::PODArray<int>& fatherBoneIndices, const glm::Array<glm::Vector3>& worldScales, VtVec3hArray& scales);
+
+        // Converts the world space bones of an entity to the local space joints of its skel animation, translations and
+        // rotations are already sized to the bone count. worldScales is NULL when the scales are not animated.
+        void computeLocalJoints(
+            const glm::crowdio::GlmFrameData* frameData,
+            uint32_t bonePositionOffset,
+            const glm::PODArray<size_t>& specificToCacheBoneIndices,
+            const glm::PODArray<int>& fatherBoneIndices,
+            float entityScale,
+            const glm::Array<glm::Vector3>* worldScales,
+            VtVec3fArray& translations,
+            VtQuatfArray& rotations);
+
+        // Copies the shader attributes of an entity from the shader data of the simulation cache
+        void copyShaderAttributes(
+            const glm::Array<glm::ShaderAttribute>& shaderAttributes,
+            const glm::PODArray<size_t>& globalToSpecificShaderAttrIdx,
+            const glm::PODArray<int>& intData,
+            const glm::PODArray<float>& floatData,
+            const glm::Array<glm::GlmString>& stringData,
+            const glm::Array<glm::Vector3>& vectorData,
+            glm::PODArray<int>& intValues,
+            glm::PODArray<float>& floatValues,
+            glm::Array<TfToken>& stringValues,
+            glm::Array<GfVec3f>& vectorValues);
+
+        // Copies the pp attributes of an entity from the frame data of the simulation cache
+        void copyPPAttributes(const glm::crowdio::GlmSimulationData* simuData, const glm::crowdio::GlmFrameData* frameData, uint32_t entityIndex, glm::PODArray<float>& floatValues, glm::Array<GfVec3f>& vectorValues);
+
+        // Velocities of the points from the previous frame, prevPoints has the same size as currentPoints
+        void computeVelocities(const VtVec3fArray& currentPoints, const VtVec3fArray& prevPoints, float fps, VtVec3fArray& velocities);
+        void computeVelocities(const VtVec3fArray& currentPoints, const VtVec3fArray& prevPoints, float fps, VtVec3hArray& velocities);
+
+        // Bounding box mesh of an entity: 8 points and the normals of the 6 quads, averaged per point in vertex normals mode
+        void computeBoxMesh(const GfVec3f& halfExtents, const VtIntArray& faceVertexIndices, bool vertexNormals, VtVec3fArray& points, VtVec3fArray& normals);
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDLockStats.h"
+#include "glmUSDDebugCodes.h"
+
+#include <algorithm>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        LockStats::Shard LockStats::_shards[RuntimeStats::SHARD_COUNT] = {};
+
+#ifdef TRACY_ENABLE
+        // all the mutexes of a class share the same name in Tracy
+        static const tracy::SourceLocationData s_lockSourceLocations[LockStats::LOCK_CLASS_COUNT] = {
+            {nullptr, "usdWrapperUpdateLock", __FILE__, __LINE__, 0},
+            {nullptr, "entityComputeLock", __FILE__, __LINE__, 0},
+            {nullptr, "cachedSimulationLock", __FILE__, __LINE__, 0},
+            {nullptr, "fbxLock", __FILE__, __LINE__, 0},
+            {nullptr, "initLock", __FILE__, __LINE__, 0}};
+#endif
+
+        //-----------------------------------------------------------------------------
+        bool LockStats::isEnabled()
+        {
+            return RuntimeStats::isEnabled() || TfDebug::IsEnabled(GOLAEMUSD_LOCKS);
+        }
+
+        //-----------------------------------------------------------------------------
+        int64_t LockStats::get(LockClass lockClass, Value value)
+        {
+            int64_t result = 0;
+            for (const Shard& shard : _shards)
+            {
+                int64_t shardValue = shard.values[lockClass][value].load(std::memory_order_relaxed);
+                result = value == MAX_WAIT_TIME ? std::max(result, shardValue) : result + shardValue;
+            }
+            return result;
+        }
+
+        //-----------------------------------------------------------------------------
+        void LockStats::reset()
+        {
+            for (Shard& shard : _shards)
+            {
+                for (int iLockClass = 0; iLockClass < LOCK_CLASS_COUNT; ++iLockClass)
+                {
+                    for (int iValue = 0; iValue < VALUE_COUNT; ++iValue)
+                    {
+                        shard.values[iLockClass][iValue].store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        const char* LockStats::getName(LockClass lockClass)
+        {
+            switch (lockClass)
+            {
+            case USD_WRAPPER_UPDATE:
+                return "usdWrapperUpdateLock";
+            case ENTITY_COMPUTE:
+                return "entityComputeLock";
+            case CACHED_SIMULATION:
+                return "cachedSimulationLock";
+            case FBX:
+                return "fbxLock";
+            case INIT:
+                return "initLock";
+            default:
+                return "";
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        std::string LockStats::getAttributeName(LockClass lockClass, Value value)
+        {
+            switch (value)
+            {
+            case CONTENDED_ACQUISITIONS:
+                return std::string(getName(lockClass)) + "ContendedAcquisitions";
+            case WAIT_TIME:
+                return std::string(getName(lockClass)) + "WaitTimeNs";
+            case MAX_WAIT_TIME:
+                return std::string(getName(lockClass)) + "MaxWaitTimeNs";
+            default:
+                return "";
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        ProfiledMutex::ProfiledMutex(LockStats::LockClass lockClass)
+            : _lockClass(lockClass)
+#ifdef TRACY_ENABLE
+            , _mutex(&s_lockSourceLocations[lockClass])
+#endif
+        {
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include "glmUSDRuntimeStats.h"
+
+#include <glmMutex.h>
+
+#ifdef TRACY_ENABLE
+#include <glmTracy.h>
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        // Contended acquisition counts and wait times of the plugin mutexes, aggregated per lock class for the whole process.
+        // Exposed as glmStats:*Lock* attributes on the root prim of every layer when GOLAEMUSD_RUNTIME_STATS is set.
+        // Each thread adds to its own cache line aligned shard, the shards are aggregated when a value is read.
+        class LockStats
+        {
+        public:
+            enum LockClass
+            {
+                USD_WRAPPER_UPDATE, // UsdWrapper::_updateLock, one per layer
+                ENTITY_COMPUTE,     // EntityData::entityComputeLock, one per entity
+                CACHED_SIMULATION,  // EntityData::cachedSimulationLock, one per crowd field
+                FBX,                // _fbxMutex, FBX storage and baker
+                INIT,               // s_initLock, plugin init and finish
+                LOCK_CLASS_COUNT
+            };
+
+            enum Value
+            {
+                CONTENDED_ACQUISITIONS,
+                WAIT_TIME,     // ns
+                MAX_WAIT_TIME, // ns
+                VALUE_COUNT
+            };
+
+            // the contended waits are timed with GOLAEMUSD_RUNTIME_STATS or the GOLAEMUSD_LOCKS debug code
+            static bool isEnabled();
+
+            static void add(LockClass lockClass, int64_t waitTime)
+            {
+                std::atomic<int64_t>* values = _shards[RuntimeStats::getThreadShard()].values[lockClass];
+                values[CONTENDED_ACQUISITIONS].fetch_add(1, std::memory_order_relaxed);
+                values[WAIT_TIME].fetch_add(waitTime, std::memory_order_relaxed);
+                int64_t maxWaitTime = values[MAX_WAIT_TIME].load(std::memory_order_relaxed);
+                while (waitTime > maxWaitTime && !values[MAX_WAIT_TIME].compare_exchange_weak(maxWaitTime, waitTime, std::memory_order_relaxed))
+                {
+                }
+            }
+            static int64_t get(LockClass lockClass, Value value);
+            static void reset();
+
+            // name of the lock class, e.g. entityComputeLock
+            static const char* getName(LockClass lockClass);
+            // attribute name of a value, without the glmStats: namespace
+            static std::string getAttributeName(LockClass lockClass, Value value);
+
+        protected:
+            struct alignas(64) Shard
+            {
+                std::atomic<int64_t> values[LOCK_CLASS_COUNT][VALUE_COUNT];
+            };
+
+            static Shard _shards[RuntimeStats::SHARD_COUNT];
+        };
+
+        // Mutex adding its contended acquisitions to the LockStats of its class, and a Tracy lockable when TRACY_ENABLE is defined.
+        // Uncontended acquisitions only cost a try_lock.
+        class ProfiledMutex
+        {
+        public:
+            explicit ProfiledMutex(LockStats::LockClass lockClass);
+            ProfiledMutex(const ProfiledMutex&) = delete;
+            ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+            void lock()
+            {
+                if (_mutex.try_lock())
+                {
+                    _lastWaitTime = 0;
+                    return;
+                }
+                if (!LockStats::isEnabled())
+                {
+                    _mutex.lock();
+                    _lastWaitTime = 0;
+                    return;
+                }
+                int64_t startTime = RuntimeStats::now();
+                _mutex.lock();
+                _lastWaitTime = RuntimeStats::now() - startTime;
+                LockStats::add(_lockClass, _lastWaitTime);
+            }
+            void unlock()
+            {
+                _mutex.unlock();
+            }
+
+            // wait time of the current owner, only valid while the mutex is locked, 0 if it was not contended or not timed
+            int64_t getLastWaitTime() const
+            {
+                return _lastWaitTime;
+            }
+
+        protected:
+            LockStats::LockClass _lockClass;
+            int64_t _lastWaitTime = 0;
+#ifdef TRACY_ENABLE
+            tracy::Lockable<std::mutex> _mutex;
+#else
+            std::mutex _mutex;
+#endif
+        };
+    } // namespace usdplugin
+} // namespace glm
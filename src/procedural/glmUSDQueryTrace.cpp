@@ -0,0 +1,336 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDQueryTrace.h"
+#include "glmUSDRuntimeStats.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/envSetting.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/usd/sdf/schema.h>
+USD_INCLUDES_END
+
+#include <glmLog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+PXR_NAMESPACE_OPEN_SCOPE
+TF_DEFINE_ENV_SETTING(GOLAEMUSD_TRACE_DIR, "", "Directory where each Golaem USD layer records the calls it receives, to replay them with glmUsdReplay");
+PXR_NAMESPACE_CLOSE_SCOPE
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        const char* QUERY_TRACE_FILE_EXTENSION = ".glmtrace";
+
+        static const char QUERY_TRACE_MAGIC[8] = {'G', 'L', 'M', 'T', 'R', 'A', 'C', 'E'};
+        static const uint32_t QUERY_TRACE_VERSION = 2;
+
+        static_assert(sizeof(QueryTraceHeader) == 24, "unexpected query trace header size");
+        static_assert(sizeof(QueryTraceCall) == 56, "unexpected query trace call size");
+
+        //-----------------------------------------------------------------------------
+        QueryTraceWriter* QueryTraceWriter::create(const SdfFileFormat::FileFormatArguments& args)
+        {
+            static const std::string traceDir = TfGetEnvSetting(GOLAEMUSD_TRACE_DIR);
+            if (traceDir.empty())
+            {
+                return NULL;
+            }
+            if (!TfIsDir(traceDir) && !TfMakeDirs(traceDir))
+            {
+                GLM_CROWD_TRACE_WARNING("Could not create the query trace directory '" << traceDir.c_str() << "'");
+                return NULL;
+            }
+
+            static std::atomic<int> traceCount(0);
+            std::string filePath = TfStringCatPaths(traceDir, TfStringPrintf("glmusd_%d_%d%s", static_cast<int>(getpid()), traceCount++, QUERY_TRACE_FILE_EXTENSION));
+            QueryTraceWriter* writer = new QueryTraceWriter(filePath, args);
+            if (!writer->_stream)
+            {
+                GLM_CROWD_TRACE_WARNING("Could not create the query trace '" << filePath.c_str() << "'");
+                delete writer;
+                return NULL;
+            }
+            return writer;
+        }
+
+        //-----------------------------------------------------------------------------
+        QueryTraceWriter::QueryTraceWriter(const std::string& filePath, const SdfFileFormat::FileFormatArguments& args)
+            : _filePath(filePath)
+            , _stream(filePath, std::ios::binary)
+            , _openTime(RuntimeStats::now())
+        {
+            QueryTraceHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, QUERY_TRACE_MAGIC, sizeof(header.magic));
+            header.version = QUERY_TRACE_VERSION;
+            header.hashFunction = QueryTraceHashFunction::FNV1A_64;
+            header.argCount = static_cast<uint32_t>(args.size());
+            _stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const auto& arg : args)
+            {
+                _writeString(arg.first);
+                _writeString(arg.second);
+            }
+            _pathIds[SdfPath()] = 0;
+            _tokenIds[TfToken()] = 0;
+        }
+
+        //-----------------------------------------------------------------------------
+        QueryTraceWriter::~QueryTraceWriter()
+        {
+            _stream.close();
+        }
+
+        //-----------------------------------------------------------------------------
+        void QueryTraceWriter::_writeString(const std::string& value)
+        {
+            uint32_t size = static_cast<uint32_t>(value.size());
+            _stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            _stream.write(value.data(), size);
+        }
+
+        //-----------------------------------------------------------------------------
+        void QueryTraceWriter::record(QueryTraceCallType::Value callType, const SdfPath& path, const TfToken& field, double time, int64_t startTime, uint64_t result, uint64_t hash)
+        {
+            int64_t endTime = RuntimeStats::now();
+
+            QueryTraceCall call;
+            memset(&call, 0, sizeof(call));
+            call.callType = callType;
+            call.time = time;
+            call.startTime = startTime - _openTime;
+            call.duration = endTime - startTime;
+            call.result = result;
+            call.hash = hash;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto pathIt = _pathIds.find(path);
+            if (pathIt == _pathIds.end())
+            {
+                pathIt = _pathIds.emplace(path, static_cast<uint32_t>(_pathIds.size())).first;
+                _stream.put(QueryTraceRecordType::PATH_DEFINITION);
+                _writeString(path.GetString());
+            }
+            auto tokenIt = _tokenIds.find(field);
+            if (tokenIt == _tokenIds.end())
+            {
+                tokenIt = _tokenIds.emplace(field, static_cast<uint32_t>(_tokenIds.size())).first;
+                _stream.put(QueryTraceRecordType::TOKEN_DEFINITION);
+                _writeString(field.GetString());
+            }
+            auto threadIt = _threadIndices.emplace(std::this_thread::get_id(), static_cast<uint32_t>(_threadIndices.size())).first;
+            call.pathId = pathIt->second;
+            call.fieldId = tokenIt->second;
+            call.threadIndex = threadIt->second;
+            _stream.put(QueryTraceRecordType::CALL);
+            _stream.write(reinterpret_cast<const char*>(&call), sizeof(call));
+        }
+
+        //-----------------------------------------------------------------------------
+        const std::string& QueryTraceWriter::getFilePath() const
+        {
+            return _filePath;
+        }
+
+        //-----------------------------------------------------------------------------
+        static bool readString(std::ifstream& stream, std::string& value)
+        {
+            uint32_t size = 0;
+            if (!stream.read(reinterpret_cast<char*>(&size), sizeof(size)))
+            {
+                return false;
+            }
+            value.resize(size);
+            return size == 0 || stream.read(&value[0], size);
+        }
+
+        //-----------------------------------------------------------------------------
+        bool QueryTraceReader::read(const std::string& filePath, std::string& errorMessage)
+        {
+            _args.clear();
+            _entries.clear();
+            _threadCount = 0;
+
+            std::ifstream stream(filePath, std::ios::binary);
+            if (!stream)
+            {
+                errorMessage = "Could not open '" + filePath + "'";
+                return false;
+            }
+            QueryTraceHeader header;
+            if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, QUERY_TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != QUERY_TRACE_VERSION)
+            {
+                errorMessage = "'" + filePath + "' is not a query trace or has an unsupported version";
+                return false;
+            }
+            _hashFunction = header.hashFunction;
+            std::string key, value;
+            for (uint32_t iArg = 0; iArg < header.argCount; ++iArg)
+            {
+                if (!readString(stream, key) || !readString(stream, value))
+                {
+                    errorMessage = "'" + filePath + "' is truncated";
+                    return false;
+                }
+                _args[key] = value;
+            }
+
+            std::vector<SdfPath> paths(1);
+            std::vector<TfToken> tokens(1);
+            int recordType = 0;
+            // a trace is not closed if the process crashed or was killed, a partial last record is ignored
+            while ((recordType = stream.get()) != std::char_traits<char>::eof())
+            {
+                if (recordType == QueryTraceRecordType::PATH_DEFINITION || recordType == QueryTraceRecordType::TOKEN_DEFINITION)
+                {
+                    if (!readString(stream, value))
+                    {
+                        break;
+                    }
+                    if (recordType == QueryTraceRecordType::PATH_DEFINITION)
+                    {
+                        paths.push_back(SdfPath(value));
+                    }
+                    else
+                    {
+                        tokens.push_back(TfToken(value));
+                    }
+                }
+                else if (recordType == QueryTraceRecordType::CALL)
+                {
+                    QueryTraceEntry entry;
+                    if (!stream.read(reinterpret_cast<char*>(&entry.call), sizeof(entry.call)))
+                    {
+                        break;
+                    }
+                    if (entry.call.pathId >= paths.size() || entry.call.fieldId >= tokens.size() || entry.call.callType >= QueryTraceCallType::COUNT)
+                    {
+                        errorMessage = "'" + filePath + "' is corrupted";
+                        return false;
+                    }
+                    entry.path = paths[entry.call.pathId];
+                    entry.field = tokens[entry.call.fieldId];
+                    _threadCount = std::max(_threadCount, entry.call.threadIndex + 1);
+                    _entries.push_back(entry);
+                }
+                else
+                {
+                    errorMessage = "'" + filePath + "' is corrupted";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        const SdfFileFormat::FileFormatArguments& QueryTraceReader::getArgs() const
+        {
+            return _args;
+        }
+
+        //-----------------------------------------------------------------------------
+        const std::vector<QueryTraceEntry>& QueryTraceReader::getEntries() const
+        {
+            return _entries;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint32_t QueryTraceReader::getThreadCount() const
+        {
+            return _threadCount;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint32_t QueryTraceReader::getHashFunction() const
+        {
+            return _hashFunction;
+        }
+
+        //-----------------------------------------------------------------------------
+        template <typename T>
+        bool hashArrayValue(const VtValue& value, uint64_t& hash)
+        {
+            if (!value.IsHolding<VtArray<T>>())
+            {
+                return false;
+            }
+            const VtArray<T>& array = value.UncheckedGet<VtArray<T>>();
+            hash = hashQueryTraceBytes(array.cdata(), array.size() * sizeof(T));
+            return true;
+        }
+
+        //-----------------------------------------------------------------------------
+        uint64_t hashQueryTraceValue(const TfToken& field, const VtValue& value)
+        {
+            if (value.IsEmpty() || field == SdfFieldKeys->TimeSamples)
+            {
+                // time sample maps are too large to stringify
+                return 0;
+            }
+            // arrays of numbers are hashed through their bytes, they are too large to stringify
+            uint64_t hash = 0;
+            if (hashArrayValue<GfVec3f>(value, hash) || hashArrayValue<GfVec3h>(value, hash) || hashArrayValue<GfVec2f>(value, hash) ||
+                hashArrayValue<GfVec4f>(value, hash) || hashArrayValue<GfQuatf>(value, hash) || hashArrayValue<GfQuath>(value, hash) ||
+                hashArrayValue<GfMatrix4d>(value, hash) || hashArrayValue<float>(value, hash) || hashArrayValue<double>(value, hash) ||
+                hashArrayValue<int>(value, hash) || hashArrayValue<int64_t>(value, hash))
+            {
+                return hash;
+            }
+            // tokens, strings and the other values are hashed through their text
+            std::string text = TfStringify(value);
+            return hashQueryTraceBytes(text.data(), text.size());
+        }
+
+        //-----------------------------------------------------------------------------
+        const char* getQueryTraceCallName(QueryTraceCallType::Value callType)
+        {
+            switch (callType)
+            {
+            case QueryTraceCallType::GET_SPEC_TYPE:
+                return "GetSpecType";
+            case QueryTraceCallType::HAS:
+                return "Has";
+            case QueryTraceCallType::HAS_VALUE:
+                return "Has(value)";
+            case QueryTraceCallType::LIST:
+                return "List";
+            case QueryTraceCallType::VISIT_SPECS:
+                return "VisitSpecs";
+            case QueryTraceCallType::LIST_ALL_TIME_SAMPLES:
+                return "ListAllTimeSamples";
+            case QueryTraceCallType::LIST_TIME_SAMPLES_FOR_PATH:
+                return "ListTimeSamplesForPath";
+            case QueryTraceCallType::GET_NUM_TIME_SAMPLES_FOR_PATH:
+                return "GetNumTimeSamplesForPath";
+            case QueryTraceCallType::GET_BRACKETING_TIME_SAMPLES:
+                return "GetBracketingTimeSamples";
+            case QueryTraceCallType::GET_BRACKETING_TIME_SAMPLES_FOR_PATH:
+                return "GetBracketingTimeSamplesForPath";
+            case QueryTraceCallType::QUERY_TIME_SAMPLE:
+                return "QueryTimeSample";
+            case QueryTraceCallType::QUERY_TIME_SAMPLE_VALUE:
+                return "QueryTimeSample(value)";
+            default:
+                return "";
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
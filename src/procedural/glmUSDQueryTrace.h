@@ -0,0 +1,184 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/path.h>
+USD_INCLUDES_END
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        using namespace PXR_INTERNAL_NS;
+
+        // Query traces (.glmtrace) record the calls made to a GolaemUSD_Data, to replay them with glmUsdReplay.
+        // Layout: header, layer params, then a stream of records. Paths and tokens are written once, in definition
+        // records, and referenced by id by the call records. Id 0 is the empty path or token.
+        struct QueryTraceHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t hashFunction; // QueryTraceHashFunction of the call hashes
+            uint32_t argCount;     // followed by argCount key and value strings (uint32 size + chars)
+            uint32_t reserved;
+        };
+
+        struct QueryTraceHashFunction
+        {
+            enum Value : uint32_t
+            {
+                FNV1A_64 = 1, // FNV-1a 64 bits of the array bytes, or of the text of the other values
+            };
+        };
+
+        struct QueryTraceRecordType
+        {
+            enum Value : uint8_t
+            {
+                PATH_DEFINITION,  // uint32 size + chars, ids are given in order from 1
+                TOKEN_DEFINITION, // uint32 size + chars, ids are given in order from 1
+                CALL              // QueryTraceCall
+            };
+        };
+
+        struct QueryTraceCallType
+        {
+            enum Value : uint8_t
+            {
+                GET_SPEC_TYPE,
+                HAS,
+                HAS_VALUE,
+                LIST,
+                VISIT_SPECS,
+                LIST_ALL_TIME_SAMPLES,
+                LIST_TIME_SAMPLES_FOR_PATH,
+                GET_NUM_TIME_SAMPLES_FOR_PATH,
+                GET_BRACKETING_TIME_SAMPLES,
+                GET_BRACKETING_TIME_SAMPLES_FOR_PATH,
+                QUERY_TIME_SAMPLE,
+                QUERY_TIME_SAMPLE_VALUE,
+                COUNT
+            };
+        };
+
+        struct QueryTraceCall
+        {
+            uint8_t callType;
+            uint8_t reserved[3];
+            uint32_t threadIndex; // in the order the threads made their first call
+            uint32_t pathId;
+            uint32_t fieldId;
+            double time;
+            int64_t startTime; // ns since the trace was opened
+            int64_t duration;  // ns
+            uint64_t result;   // bool, count or spec type
+            uint64_t hash;     // hash of the returned values, 0 if there is none
+        };
+
+        // Records the calls of a layer, enabled by the GOLAEMUSD_TRACE_DIR env var
+        class QueryTraceWriter
+        {
+        public:
+            // returns NULL if tracing is disabled or the file could not be created
+            static QueryTraceWriter* create(const SdfFileFormat::FileFormatArguments& args);
+            ~QueryTraceWriter();
+
+            void record(QueryTraceCallType::Value callType, const SdfPath& path, const TfToken& field, double time, int64_t startTime, uint64_t result, uint64_t hash);
+
+            const std::string& getFilePath() const;
+
+        protected:
+            QueryTraceWriter(const std::string& filePath, const SdfFileFormat::FileFormatArguments& args);
+            void _writeString(const std::string& value);
+
+            std::mutex _mutex;
+            std::string _filePath;
+            std::ofstream _stream;
+            int64_t _openTime;
+            std::unordered_map<SdfPath, uint32_t, SdfPath::Hash> _pathIds;
+            std::unordered_map<TfToken, uint32_t, TfToken::HashFunctor> _tokenIds;
+            std::unordered_map<std::thread::id, uint32_t> _threadIndices;
+        };
+
+        // A call of a trace, with its path and field resolved
+        struct QueryTraceEntry
+        {
+            QueryTraceCall call;
+            SdfPath path;
+            TfToken field;
+        };
+
+        // Reads a whole trace in memory
+        class QueryTraceReader
+        {
+        public:
+            bool read(const std::string& filePath, std::string& errorMessage);
+
+            const SdfFileFormat::FileFormatArguments& getArgs() const;
+            const std::vector<QueryTraceEntry>& getEntries() const;
+            uint32_t getThreadCount() const;
+            // the hashes can only be compared to the ones of hashQueryTraceValue(s) if this is QueryTraceHashFunction::FNV1A_64
+            uint32_t getHashFunction() const;
+
+        protected:
+            SdfFileFormat::FileFormatArguments _args;
+            uint32_t _hashFunction = 0;
+            std::vector<QueryTraceEntry> _entries;
+            uint32_t _threadCount = 0;
+        };
+
+        const char* getQueryTraceCallName(QueryTraceCallType::Value callType);
+
+        // FNV-1a 64 bits, stable across processes and builds, unlike std::hash and VtValue::GetHash
+        inline uint64_t hashQueryTraceBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t iByte = 0; iByte < size; ++iByte)
+            {
+                hash = (hash ^ bytes[iByte]) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        // Hash of a returned value, to check replayed calls against the recorded ones. 0 for time sample maps.
+        uint64_t hashQueryTraceValue(const TfToken& field, const VtValue& value);
+
+        // Hash of returned fields or times
+        template <class Container>
+        uint64_t hashQueryTraceValues(const Container& values)
+        {
+            uint64_t hash = hashQueryTraceBytes(NULL, 0);
+            for (const auto& value : values)
+            {
+                // the size separates the values
+                std::string text = TfStringify(value);
+                uint32_t size = static_cast<uint32_t>(text.size());
+                hash = hashQueryTraceBytes(&size, sizeof(size), hash);
+                hash = hashQueryTraceBytes(text.data(), text.size(), hash);
+            }
+            return hash;
+        }
+
+        extern const char* QUERY_TRACE_FILE_EXTENSION;
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDRuntimeStats.h"
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/base/tf/envSetting.h>
+USD_INCLUDES_END
+
+PXR_NAMESPACE_OPEN_SCOPE
+TF_DEFINE_ENV_SETTING(GOLAEMUSD_RUNTIME_STATS, false, "Counts the queries, computes and lock waits of the Golaem USD layers, exposed as glmStats:* attributes on their root prim");
+PXR_NAMESPACE_CLOSE_SCOPE
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        //-----------------------------------------------------------------------------
+        RuntimeStats::RuntimeStats()
+            : _enabled(isEnabled())
+        {
+            reset();
+        }
+
+        //-----------------------------------------------------------------------------
+        bool RuntimeStats::isEnabled()
+        {
+            static const bool enabled = TfGetEnvSetting(GOLAEMUSD_RUNTIME_STATS);
+            return enabled;
+        }
+
+        //-----------------------------------------------------------------------------
+        int64_t RuntimeStats::get(Counter counter) const
+        {
+            int64_t value = 0;
+            for (const Shard& shard : _shards)
+            {
+                value += shard.counters[counter].load(std::memory_order_relaxed);
+            }
+            return value;
+        }
+
+        //-----------------------------------------------------------------------------
+        void RuntimeStats::reset()
+        {
+            for (Shard& shard : _shards)
+            {
+                for (int iCounter = 0; iCounter < COUNTER_COUNT; ++iCounter)
+                {
+                    shard.counters[iCounter].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //-----------------------------------------------------------------------------
+        const char* RuntimeStats::getName(Counter counter)
+        {
+            switch (counter)
+            {
+            case SPEC_QUERIES:
+                return "specQueries";
+            case HAS_QUERIES:
+                return "hasQueries";
+            case LIST_QUERIES:
+                return "listQueries";
+            case VISIT_SPECS_QUERIES:
+                return "visitSpecsQueries";
+            case TIME_SAMPLE_LIST_QUERIES:
+                return "timeSampleListQueries";
+            case TIME_SAMPLE_QUERIES:
+                return "timeSampleQueries";
+            case FRAME_CACHE_HITS:
+                return "frameCacheHits";
+            case FRAME_CACHE_MISSES:
+                return "frameCacheMisses";
+            case FRAME_CACHE_EVICTIONS:
+                return "frameCacheEvictions";
+            case COMPUTED_ENTITIES:
+                return "computedEntities";
+            case COMPUTE_ENTITY_TIME:
+                return "computeEntityTimeNs";
+            case PREPARE_GEOMETRY_TIME:
+                return "prepareGeometryTimeNs";
+            case GATHER_TIME:
+                return "gatherTimeNs";
+            default:
+                return "";
+            }
+        }
+    } // namespace usdplugin
+} // namespace glm
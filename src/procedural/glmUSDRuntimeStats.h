@@ -0,0 +1,114 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        // Cheap counters of a layer, exposed as glmStats:* attributes on the root prim when GOLAEMUSD_RUNTIME_STATS is set.
+        // Each thread adds to its own cache line aligned shard, the shards are summed when a counter is read.
+        // Counters are relaxed atomics: they are consistent on their own, not with each other.
+        class RuntimeStats
+        {
+        public:
+            enum Counter
+            {
+                SPEC_QUERIES,             // GetSpecType
+                HAS_QUERIES,              // Has
+                LIST_QUERIES,             // List
+                VISIT_SPECS_QUERIES,      // VisitSpecs
+                TIME_SAMPLE_LIST_QUERIES, // ListAllTimeSamples, ListTimeSamplesForPath, GetNumTimeSamplesForPath, GetBracketingTimeSamples(ForPath)
+                TIME_SAMPLE_QUERIES,      // QueryTimeSample, and each frame of a full time sample map
+                FRAME_CACHE_HITS,
+                FRAME_CACHE_MISSES,
+                FRAME_CACHE_EVICTIONS,
+                COMPUTED_ENTITIES,
+                COMPUTE_ENTITY_TIME,   // ns, whole entity frame computes
+                PREPARE_GEOMETRY_TIME, // ns, glmPrepareEntityGeometry
+                GATHER_TIME,           // ns, copy of the deformed points and normals to the usd meshes
+                COUNTER_COUNT
+            };
+
+            RuntimeStats();
+
+            // GOLAEMUSD_RUNTIME_STATS env setting, the counters are not updated otherwise
+            static bool isEnabled();
+
+            void add(Counter counter, int64_t value = 1)
+            {
+                if (_enabled)
+                {
+                    _shards[getThreadShard()].counters[counter].fetch_add(value, std::memory_order_relaxed);
+                }
+            }
+            void addTimeSince(Counter counter, int64_t startTime)
+            {
+                if (_enabled)
+                {
+                    add(counter, now() - startTime);
+                }
+            }
+            int64_t get(Counter counter) const;
+            void reset();
+
+            // attribute name of the counter, without the glmStats: namespace
+            static const char* getName(Counter counter);
+
+            // steady clock, in ns
+            static int64_t now()
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            // adds the time spent in a scope to a counter
+            class ScopedTimer
+            {
+            public:
+                ScopedTimer(RuntimeStats& stats, Counter counter)
+                    : _stats(stats)
+                    , _counter(counter)
+                    , _startTime(stats._enabled ? now() : 0)
+                {
+                }
+                ~ScopedTimer()
+                {
+                    _stats.addTimeSince(_counter, _startTime);
+                }
+
+            protected:
+                RuntimeStats& _stats;
+                Counter _counter;
+                int64_t _startTime;
+            };
+
+            // also used by the LockStats shards
+            static const size_t SHARD_COUNT = 16;
+
+            // threads are spread over the shards in the order of their first use
+            static size_t getThreadShard()
+            {
+                static std::atomic<size_t> nextThreadShard(0);
+                thread_local size_t threadShard = nextThreadShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+                return threadShard;
+            }
+
+        protected:
+            struct alignas(64) Shard
+            {
+                std::atomic<int64_t> counters[COUNTER_COUNT];
+            };
+
+            bool _enabled;
+            Shard _shards[SHARD_COUNT];
+        };
+    } // namespace usdplugin
+} // namespace glm
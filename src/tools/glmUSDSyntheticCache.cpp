@@ -0,0 +1,332 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#include "glmUSDSyntheticCache.h"
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmCore.h>
+#include <glmCrowdIO.h>
+#include <glmGolaemCharacter.h>
+#include <glmSimulationCacheFactory.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+using namespace PXR_INTERNAL_NS;
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        namespace
+        {
+            // bone layout of an entity type, from its character
+            struct SyntheticEntityType
+            {
+                int characterIdx = -1;
+                uint16_t boneCount = 0;
+                uint16_t snsCount = 0;
+                glm::PODArray<int> boneDepthsInCache; // hierarchy depth of each cache bone, to stack the bones
+            };
+
+            //-----------------------------------------------------------------------------
+            bool getEntityTypes(const glm::crowdio::SimulationCacheFactory& factory, std::vector<SyntheticEntityType>& entityTypes, std::string& error)
+            {
+                for (int iChar = 0, charCount = factory.getGolaemCharacters().sizeInt(); iChar < charCount; ++iChar)
+                {
+                    const glm::GolaemCharacter* character = factory.getGolaemCharacter(iChar);
+                    if (character == NULL || character->_converterMapping._skeletonDescription == NULL)
+                    {
+                        error = TfStringPrintf("Could not load character %d", iChar);
+                        return false;
+                    }
+                    const glm::PODArray<size_t>& specificToCacheBoneIndices = character->_converterMapping._skeletonDescription->getSpecificToCacheBoneIndices();
+
+                    SyntheticEntityType entityType;
+                    entityType.characterIdx = iChar;
+                    entityType.boneCount = static_cast<uint16_t>(character->_converterMapping._skeletonDescription->getBones().size());
+                    entityType.boneDepthsInCache.resize(entityType.boneCount, 0);
+                    for (uint16_t iBone = 0; iBone < entityType.boneCount; ++iBone)
+                    {
+                        if (character->_converterMapping.isBoneUsingSnSScale(iBone))
+                        {
+                            ++entityType.snsCount;
+                        }
+                        int depth = 0;
+                        for (const HierarchicalBone* bone = character->_converterMapping._skeletonDescription->getBones()[iBone]->getFather(); bone != NULL; bone = bone->getFather())
+                        {
+                            ++depth;
+                        }
+                        entityType.boneDepthsInCache[specificToCacheBoneIndices[iBone]] = depth;
+                    }
+                    entityTypes.push_back(entityType);
+                }
+                if (entityTypes.empty())
+                {
+                    error = "No character loaded";
+                    return false;
+                }
+                return true;
+            }
+
+            //-----------------------------------------------------------------------------
+            bool writeCrowdField(const SyntheticCacheParams& params, const std::vector<SyntheticEntityType>& entityTypes, int iCrowdField, std::string& error)
+            {
+                std::string crowdFieldName = TfStringPrintf("syntheticField%d", iCrowdField + 1);
+                std::string filePrefix = TfStringCatPaths(params.outputDir, params.cacheName + "." + crowdFieldName);
+
+                uint16_t entityTypeCount = static_cast<uint16_t>(entityTypes.size());
+                glm::crowdio::GlmSimulationData* simuData = NULL;
+                if (glm::crowdio::glmCreateSimulationData(&simuData, params.entityCount, entityTypeCount, params.ppFloatAttributeCount, params.ppVectorAttributeCount) != glm::crowdio::GIO_SUCCESS)
+                {
+                    error = "Could not create the simulation data of " + crowdFieldName;
+                    return false;
+                }
+
+                // entity types: bones and sns are stored by entity type, then by entity
+                for (uint16_t iType = 0; iType < entityTypeCount; ++iType)
+                {
+                    simuData->_entityCountPerEntityType[iType] = 0;
+                }
+                for (int iEntity = 0; iEntity < params.entityCount; ++iEntity)
+                {
+                    uint16_t entityType = static_cast<uint16_t>(iEntity % entityTypeCount);
+                    simuData->_entityIds[iEntity] = static_cast<int64_t>(iEntity + 1) * 1000 + iCrowdField + 1;
+                    simuData->_entityTypes[iEntity] = entityType;
+                    simuData->_characterIdx[iEntity] = entityTypes[entityType].characterIdx;
+                    simuData->_scales[iEntity] = 1.f;
+                    simuData->_indexInEntityType[iEntity] = simuData->_entityCountPerEntityType[entityType]++;
+                }
+                uint32_t boneOffset = 0, snsOffset = 0;
+                for (uint16_t iType = 0; iType < entityTypeCount; ++iType)
+                {
+                    simuData->_boneCount[iType] = entityTypes[iType].boneCount;
+                    simuData->_snsCountPerEntityType[iType] = entityTypes[iType].snsCount;
+                    simuData->_iBoneOffsetPerEntityType[iType] = boneOffset;
+                    simuData->_snsOffsetPerEntityType[iType] = snsOffset;
+                    boneOffset += simuData->_entityCountPerEntityType[iType] * entityTypes[iType].boneCount;
+                    snsOffset += simuData->_entityCountPerEntityType[iType] * entityTypes[iType].snsCount;
+                }
+                simuData->_framerate = params.framerate;
+                for (int iAttr = 0; iAttr < params.ppFloatAttributeCount; ++iAttr)
+                {
+                    snprintf(simuData->_ppFloatAttributeNames[iAttr], sizeof(simuData->_ppFloatAttributeNames[iAttr]), "syntheticFloat%d", iAttr);
+                }
+                for (int iAttr = 0; iAttr < params.ppVectorAttributeCount; ++iAttr)
+                {
+                    snprintf(simuData->_ppVectorAttributeNames[iAttr], sizeof(simuData->_ppVectorAttributeNames[iAttr]), "syntheticVector%d", iAttr);
+                }
+
+                std::string simuDataFile = filePrefix + ".gscs";
+                if (glm::crowdio::glmWriteSimulationData(simuDataFile.c_str(), simuData) != glm::crowdio::GIO_SUCCESS)
+                {
+                    error = "Could not write " + simuDataFile;
+                    glm::crowdio::glmDestroySimulationData(&simuData);
+                    return false;
+                }
+
+                // emission and kill frames, from a seed per crowd field so that adding crowd fields does not change the others
+                std::mt19937 randomGenerator(params.seed + iCrowdField);
+                std::uniform_real_distribution<float> ratioDistribution(0.f, 1.f);
+                std::uniform_int_distribution<int> frameDistribution(params.startFrame, params.startFrame + params.frameCount - 1);
+                std::vector<int> emitFrames(params.entityCount, INT_MIN);
+                std::vector<int> killFrames(params.entityCount, INT_MAX);
+                for (int iEntity = 0; iEntity < params.entityCount; ++iEntity)
+                {
+                    if (ratioDistribution(randomGenerator) < params.emitRatio)
+                    {
+                        emitFrames[iEntity] = frameDistribution(randomGenerator);
+                    }
+                    if (ratioDistribution(randomGenerator) < params.killRatio)
+                    {
+                        killFrames[iEntity] = std::max(frameDistribution(randomGenerator), emitFrames[iEntity]);
+                    }
+                }
+
+                glm::crowdio::GlmFrameData* frameData = NULL;
+                if (glm::crowdio::glmCreateFrameData(&frameData, simuData) != glm::crowdio::GIO_SUCCESS)
+                {
+                    error = "Could not create the frame data of " + crowdFieldName;
+                    glm::crowdio::glmDestroySimulationData(&simuData);
+                    return false;
+                }
+
+                int gridSize = std::max(static_cast<int>(std::ceil(std::sqrt(static_cast<float>(params.entityCount)))), 1);
+                bool success = true;
+                for (int iFrame = 0; iFrame < params.frameCount && success; ++iFrame)
+                {
+                    int frame = params.startFrame + iFrame;
+                    for (int iEntity = 0; iEntity < params.entityCount; ++iEntity)
+                    {
+                        uint16_t entityType = simuData->_entityTypes[iEntity];
+                        const SyntheticEntityType& typeInfo = entityTypes[entityType];
+                        frameData->_entityEnabled[iEntity] = frame >= emitFrames[iEntity] && frame < killFrames[iEntity] ? 1 : 0;
+
+                        // entities walk along z on a grid, the bones are stacked by depth and sway a little
+                        float rootPos[3] = {
+                            (iEntity % gridSize) * params.spacing,
+                            0.f,
+                            (iEntity / gridSize) * params.spacing + iFrame * params.speed};
+                        uint32_t bonePositionOffset = simuData->_iBoneOffsetPerEntityType[entityType] + simuData->_indexInEntityType[iEntity] * typeInfo.boneCount;
+                        for (uint16_t iBone = 0; iBone < typeInfo.boneCount; ++iBone)
+                        {
+                            float phase = 0.2f * frame + 0.1f * iBone + iEntity;
+                            float (&bonePos)[3] = frameData->_bonePositions[bonePositionOffset + iBone];
+                            bonePos[0] = rootPos[0] + 0.02f * std::sin(phase);
+                            bonePos[1] = rootPos[1] + 0.1f * typeInfo.boneDepthsInCache[iBone];
+                            bonePos[2] = rootPos[2];
+                            float halfAngle = 0.05f * std::sin(phase);
+                            float (&boneOri)[4] = frameData->_boneOrientations[bonePositionOffset + iBone];
+                            boneOri[0] = 0.f;
+                            boneOri[1] = std::sin(halfAngle);
+                            boneOri[2] = 0.f;
+                            boneOri[3] = std::cos(halfAngle);
+                        }
+
+                        uint32_t entitySnsOffset = simuData->_snsOffsetPerEntityType[entityType] + simuData->_indexInEntityType[iEntity] * typeInfo.snsCount;
+                        for (uint16_t iSns = 0; iSns < typeInfo.snsCount; ++iSns)
+                        {
+                            float (&snsValues)[4] = frameData->_snsValues[entitySnsOffset + iSns];
+                            snsValues[0] = snsValues[1] = snsValues[2] = snsValues[3] = 1.f;
+                        }
+
+                        for (int iAttr = 0; iAttr < params.ppFloatAttributeCount; ++iAttr)
+                        {
+                            frameData->_ppFloatAttributeData[iAttr][iEntity] = std::sin(0.1f * frame + iAttr + iEntity);
+                        }
+                        for (int iAttr = 0; iAttr < params.ppVectorAttributeCount; ++iAttr)
+                        {
+                            float (&vectorValue)[3] = frameData->_ppVectorAttributeData[iAttr][iEntity];
+                            vectorValue[0] = static_cast<float>(iAttr);
+                            vectorValue[1] = static_cast<float>(iEntity);
+                            vectorValue[2] = static_cast<float>(frame);
+                        }
+                    }
+
+                    std::string frameDataFile = TfStringPrintf("%s.%d.gscf", filePrefix.c_str(), frame);
+                    if (glm::crowdio::glmWriteFrameData(frameDataFile.c_str(), frameData, simuData) != glm::crowdio::GIO_SUCCESS)
+                    {
+                        error = "Could not write " + frameDataFile;
+                        success = false;
+                    }
+                }
+
+                glm::crowdio::glmDestroyFrameData(&frameData, simuData);
+                glm::crowdio::glmDestroySimulationData(&simuData);
+                return success;
+            }
+
+            //-----------------------------------------------------------------------------
+            bool writeStage(const SyntheticCacheParams& params, std::string& error)
+            {
+                // the .glmusd file is only an asset path for the payload, the layer is generated from the GolaemUSD_Params metadata
+                std::string glmusdFile = TfStringCatPaths(params.outputDir, params.cacheName + ".glmusd");
+                std::ofstream glmusdStream(glmusdFile);
+                if (!glmusdStream)
+                {
+                    error = "Could not write " + glmusdFile;
+                    return false;
+                }
+
+                std::string characterFiles;
+                for (const std::string& characterFile : params.characterFiles)
+                {
+                    characterFiles += (characterFiles.empty() ? "" : ";") + TfAbsPath(characterFile);
+                }
+
+                std::string stageFile = TfStringCatPaths(params.outputDir, params.cacheName + ".usda");
+                std::ofstream stageStream(stageFile);
+                if (!stageStream)
+                {
+                    error = "Could not write " + stageFile;
+                    return false;
+                }
+                stageStream << "#usda 1.0\n"
+                            << "(\n"
+                            << "    defaultPrim = \"Root\"\n"
+                            << "    startTimeCode = " << params.startFrame << "\n"
+                            << "    endTimeCode = " << params.startFrame + params.frameCount - 1 << "\n"
+                            << "    timeCodesPerSecond = " << params.framerate << "\n"
+                            << ")\n\n"
+                            << "def Xform \"Root\" (\n"
+                            << "    GolaemUSD_Params = {\n"
+                            << "        token glmCacheDir = \"" << TfAbsPath(params.outputDir) << "\"\n"
+                            << "        token glmCacheName = \"" << params.cacheName << "\"\n"
+                            << "        token glmCharacterFiles = \"" << characterFiles << "\"\n"
+                            << "        token glmCrowdFields = \"" << getSyntheticCrowdFields(params) << "\"\n"
+                            << "    }\n"
+                            << "    payload = @./" << params.cacheName << ".glmusd@\n"
+                            << ")\n"
+                            << "{\n"
+                            << "}\n";
+                return true;
+            }
+        } // namespace
+
+        //-----------------------------------------------------------------------------
+        std::string getSyntheticCrowdFields(const SyntheticCacheParams& params)
+        {
+            std::string crowdFields;
+            for (int iCrowdField = 0; iCrowdField < params.crowdFieldCount; ++iCrowdField)
+            {
+                crowdFields += TfStringPrintf("%ssyntheticField%d", iCrowdField > 0 ? ";" : "", iCrowdField + 1);
+            }
+            return crowdFields;
+        }
+
+        //-----------------------------------------------------------------------------
+        bool writeSyntheticCache(const SyntheticCacheParams& params, std::string& error)
+        {
+            if (params.characterFiles.empty() || params.entityCount <= 0 || params.frameCount <= 0 || params.crowdFieldCount <= 0)
+            {
+                error = "Expected characters, and positive entity, frame and crowd field counts";
+                return false;
+            }
+            if (params.ppFloatAttributeCount < 0 || params.ppFloatAttributeCount > UINT8_MAX || params.ppVectorAttributeCount < 0 || params.ppVectorAttributeCount > UINT8_MAX)
+            {
+                error = "Expected at most 255 float and 255 vector pp attributes";
+                return false;
+            }
+            if (!TfIsDir(params.outputDir) && !TfMakeDirs(params.outputDir))
+            {
+                error = "Could not create " + params.outputDir;
+                return false;
+            }
+
+            // the characters give the bone count of each entity type, for the cache to be valid for the plugin
+            glm::crowdio::SimulationCacheFactory factory;
+            std::string characterFiles = TfStringJoin(params.characterFiles, ";");
+            factory.loadGolaemCharacters(characterFiles.c_str());
+            std::vector<SyntheticEntityType> entityTypes;
+            if (!getEntityTypes(factory, entityTypes, error))
+            {
+                return false;
+            }
+
+            for (int iCrowdField = 0; iCrowdField < params.crowdFieldCount; ++iCrowdField)
+            {
+                if (!writeCrowdField(params, entityTypes, iCrowdField, error))
+                {
+                    return false;
+                }
+            }
+            return !params.writeStage || writeStage(params, error);
+        }
+    } // namespace usdplugin
+} // namespace glm
@@ -0,0 +1,44 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace glm
+{
+    namespace usdplugin
+    {
+        // Parameters of a synthetic simulation cache
+        struct SyntheticCacheParams
+        {
+            std::string outputDir;
+            std::string cacheName = "synthetic";
+            std::vector<std::string> characterFiles; // .gcha, one entity type per character, assigned in turn to the entities
+            int crowdFieldCount = 1;
+            int entityCount = 100; // per crowd field
+            int startFrame = 1;
+            int frameCount = 100;
+            float framerate = 24.f;
+            int ppFloatAttributeCount = 0;
+            int ppVectorAttributeCount = 0;
+            float spacing = 2.f;   // distance between the entities, laid out on a grid
+            float speed = 1.f;     // distance per frame
+            float killRatio = 0.f; // ratio of the entities killed at a random frame
+            float emitRatio = 0.f; // ratio of the entities emitted at a random frame
+            unsigned int seed = 0;
+            bool writeStage = true; // also writes <cacheName>.usda and <cacheName>.glmusd loading the cache
+        };
+
+        // Writes a valid Golaem simulation cache with the devkit: <cacheName>.<crowdField>.gscs and <cacheName>.<crowdField>.<frame>.gscf files.
+        // The bone count, meshes, LODs and shader attributes come from the characters. Returns false and sets error on failure.
+        bool writeSyntheticCache(const SyntheticCacheParams& params, std::string& error);
+
+        // Crowd field names of a synthetic cache: syntheticField1, syntheticField2...
+        std::string getSyntheticCrowdFields(const SyntheticCacheParams& params);
+    } // namespace usdplugin
+} // namespace glm
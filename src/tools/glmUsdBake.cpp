@@ -0,0 +1,363 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+// Bakes the deformed meshes of a Golaem USD layer to .glmusdgeo files, read back with the glmBakedGeometryFiles param.
+//
+// The frames and entities are split in chunks, one file per chunk. Existing chunk files are skipped so an interrupted bake
+// can be resumed, and --worker lets several processes share the chunks of the same bake without any coordination.
+//
+// With --export, the whole generated layer is written to a usd file instead (usually .usdc), the time samples in value
+// clips written next to it.
+
+#include "glmUSD.h"
+#include "glmUSDData.h"
+#include "glmUSDDataImpl.h"
+#include "glmUSDBakedGeometry.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/prim.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/threadLimits.h>
+USD_INCLUDES_END
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace PXR_INTERNAL_NS;
+using namespace glm::usdplugin;
+
+namespace
+{
+    struct BakeOptions
+    {
+        std::string layerFile;
+        std::string primPath;
+        std::string outputDir;
+        std::string outputName = "glmBake";
+        std::string exportFile;
+        int framesPerClip = 50;
+        std::vector<std::string> params; // name=value
+        int startFrame = INT_MIN;
+        int endFrame = INT_MAX;
+        size_t firstEntity = 0;
+        size_t lastEntity = SIZE_MAX;
+        int framesPerFile = 10;
+        size_t entitiesPerFile = SIZE_MAX;
+        int workerIndex = 0;
+        int workerCount = 1;
+        int threadCount = 0;
+    };
+
+    //-----------------------------------------------------------------------------
+    void printUsage()
+    {
+        printf("Usage: glmUsdBake -o outputDir [options]\n"
+               "       glmUsdBake --export file.usdc [options]\n"
+               "  -o, --output dir          output directory of the .glmusdgeo files\n"
+               "  -n, --name name           prefix of the output files (default glmBake)\n"
+               "  -l, --layer file          USD file containing the prim that loads the Golaem USD layer\n"
+               "  --prim path               path of the prim with the GolaemUSD_Params metadata\n"
+               "  -p, --param name=value    sets or overrides a GolaemUSD param, can be repeated\n"
+               "  -f, --frames start:end    frame range to bake (default all cached frames)\n"
+               "  -e, --entities first:last range of entity indices to bake, in the sorted entity ids (default all)\n"
+               "  --frames-per-file count   number of frames in each file (default 10)\n"
+               "  --entities-per-file count number of entities in each file (default all)\n"
+               "  -w, --worker index/count  only bakes one chunk out of count, to run several processes on the same bake\n"
+               "  -t, --threads count       number of threads used to compute the entities (default all cores)\n"
+               "  --export file             writes the generated layer to a usd file instead of baking the meshes\n"
+               "  --frames-per-clip count   number of frames in each value clip of the exported file, 0 for no clips (default 50)\n");
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseRange(const std::string& value, long long& first, long long& last)
+    {
+        std::vector<std::string> bounds = TfStringSplit(value, ":");
+        if (bounds.size() != 2)
+        {
+            return false;
+        }
+        char* endPtr = nullptr;
+        first = std::strtoll(bounds[0].c_str(), &endPtr, 10);
+        if (endPtr == bounds[0].c_str())
+        {
+            return false;
+        }
+        last = std::strtoll(bounds[1].c_str(), &endPtr, 10);
+        return endPtr != bounds[1].c_str() && first <= last;
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseArgs(int argc, char** argv, BakeOptions& options)
+    {
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            std::string arg = argv[iArg];
+            if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            if (iArg + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for argument '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = argv[++iArg];
+            long long first = 0, last = 0;
+            if (arg == "-o" || arg == "--output")
+            {
+                options.outputDir = value;
+            }
+            else if (arg == "-n" || arg == "--name")
+            {
+                options.outputName = value;
+            }
+            else if (arg == "-l" || arg == "--layer")
+            {
+                options.layerFile = value;
+            }
+            else if (arg == "--prim")
+            {
+                options.primPath = value;
+            }
+            else if (arg == "-p" || arg == "--param")
+            {
+                options.params.push_back(value);
+            }
+            else if ((arg == "-f" || arg == "--frames") && parseRange(value, first, last))
+            {
+                options.startFrame = static_cast<int>(first);
+                options.endFrame = static_cast<int>(last);
+            }
+            else if ((arg == "-e" || arg == "--entities") && parseRange(value, first, last) && first >= 0)
+            {
+                options.firstEntity = static_cast<size_t>(first);
+                options.lastEntity = static_cast<size_t>(last);
+            }
+            else if (arg == "--frames-per-file")
+            {
+                options.framesPerFile = std::max(std::atoi(value.c_str()), 1);
+            }
+            else if (arg == "--entities-per-file")
+            {
+                options.entitiesPerFile = static_cast<size_t>(std::max(std::atoi(value.c_str()), 1));
+            }
+            else if (arg == "-w" || arg == "--worker")
+            {
+                if (sscanf(value.c_str(), "%d/%d", &options.workerIndex, &options.workerCount) != 2 || options.workerCount < 1 ||
+                    options.workerIndex < 0 || options.workerIndex >= options.workerCount)
+                {
+                    fprintf(stderr, "Invalid worker '%s', expected index/count\n", value.c_str());
+                    return false;
+                }
+            }
+            else if (arg == "-t" || arg == "--threads")
+            {
+                options.threadCount = std::atoi(value.c_str());
+            }
+            else if (arg == "--export")
+            {
+                options.exportFile = value;
+            }
+            else if (arg == "--frames-per-clip")
+            {
+                options.framesPerClip = std::max(std::atoi(value.c_str()), 0);
+            }
+            else
+            {
+                fprintf(stderr, "Invalid argument '%s %s'\n", arg.c_str(), value.c_str());
+                return false;
+            }
+        }
+        if (options.outputDir.empty() && options.exportFile.empty())
+        {
+            fprintf(stderr, "No output directory or export file\n");
+            return false;
+        }
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    bool getParams(const BakeOptions& options, GolaemUSD_DataParams& params)
+    {
+        SdfFileFormat::FileFormatArguments args;
+        if (!options.layerFile.empty())
+        {
+            // the GolaemUSD_Params metadata is only registered when the plugin is found in PXR_PLUGINPATH_NAME
+            UsdStageRefPtr stage = UsdStage::Open(options.layerFile, UsdStage::LoadNone);
+            if (!stage)
+            {
+                fprintf(stderr, "Could not open '%s'\n", options.layerFile.c_str());
+                return false;
+            }
+            UsdPrim prim = stage->GetPrimAtPath(SdfPath(options.primPath));
+            // GolaemUSDFileFormatTokens->Params, the plugin static data is not exported on Windows
+            const TfToken paramsToken("GolaemUSD_Params");
+            VtDictionary paramsDict;
+            if (!prim || !prim.GetMetadata(paramsToken, &paramsDict))
+            {
+                fprintf(stderr, "Could not find the %s metadata on prim '%s'\n", paramsToken.GetText(), options.primPath.c_str());
+                return false;
+            }
+            GolaemUSD_DataParams layerParams = GolaemUSD_DataParams::FromDict(paramsDict);
+            if (layerParams.glmProceduralFile.IsEmpty())
+            {
+                layerParams.glmProceduralFile = TfToken(options.layerFile);
+            }
+            args = layerParams.ToArgs();
+        }
+        else
+        {
+            args = GolaemUSD_DataParams().ToArgs();
+        }
+
+        for (const std::string& param : options.params)
+        {
+            size_t separatorPos = param.find('=');
+            if (separatorPos == std::string::npos)
+            {
+                fprintf(stderr, "Invalid param '%s', expected name=value\n", param.c_str());
+                return false;
+            }
+            args[param.substr(0, separatorPos)] = param.substr(separatorPos + 1);
+        }
+        params = GolaemUSD_DataParams::FromArgs(args);
+
+        // every entity is baked, and the geometry is always computed
+        params.glmFrustumCulling = false;
+        params.glmBakedGeometryFiles = TfToken();
+        params.glmCompressCachedFrames = false;
+        if (!options.exportFile.empty())
+        {
+            return true;
+        }
+        if (params.glmDisplayMode != GolaemDisplayMode::SKINMESH)
+        {
+            fprintf(stderr, "Only the skinmesh display mode can be baked\n");
+            return false;
+        }
+        if (params.glmLodMode == 2)
+        {
+            fprintf(stderr, "The dynamic lod mode cannot be baked\n");
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    BakeOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    GolaemUSD_DataParams params;
+    if (!getParams(options, params))
+    {
+        return 1;
+    }
+    if (options.threadCount > 0)
+    {
+        WorkSetConcurrencyLimit(static_cast<unsigned>(options.threadCount));
+    }
+
+    if (!options.exportFile.empty())
+    {
+        auto exportStartTime = std::chrono::steady_clock::now();
+        GolaemUSD_DataImpl dataImpl(params);
+        std::string errorMessage;
+        if (!dataImpl.ExportToUsd(options.exportFile, options.framesPerClip, errorMessage))
+        {
+            fprintf(stderr, "%s\n", errorMessage.c_str());
+            return 1;
+        }
+        double exportSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - exportStartTime).count();
+        printf("Exported %s in %.1fs\n", options.exportFile.c_str(), exportSeconds);
+        return 0;
+    }
+
+    if (!TfIsDir(options.outputDir) && !TfMakeDirs(options.outputDir, -1, true))
+    {
+        fprintf(stderr, "Could not create output directory '%s'\n", options.outputDir.c_str());
+        return 1;
+    }
+
+    GolaemUSD_DataImpl dataImpl(params);
+    uint64_t paramsHash = dataImpl.GetGeometryParamsHash();
+
+    std::vector<int64_t> entityIds;
+    dataImpl.GetSkinMeshEntityIds(entityIds);
+    int startFrame = 0, endFrame = 0;
+    dataImpl.GetFrameRange(startFrame, endFrame);
+    startFrame = std::max(startFrame, options.startFrame);
+    endFrame = std::min(endFrame, options.endFrame);
+    size_t lastEntity = std::min(options.lastEntity, entityIds.size() - 1);
+    if (entityIds.empty() || startFrame > endFrame || options.firstEntity > lastEntity)
+    {
+        fprintf(stderr, "Nothing to bake\n");
+        return 1;
+    }
+
+    size_t chunkIdx = 0;
+    size_t bakedChunkCount = 0;
+    size_t skippedChunkCount = 0;
+    for (size_t chunkFirstEntity = options.firstEntity; chunkFirstEntity <= lastEntity; chunkFirstEntity += std::min(options.entitiesPerFile, lastEntity + 1 - chunkFirstEntity))
+    {
+        size_t chunkLastEntity = chunkFirstEntity + std::min(options.entitiesPerFile, lastEntity + 1 - chunkFirstEntity) - 1;
+        std::vector<int64_t> chunkEntityIds(entityIds.begin() + chunkFirstEntity, entityIds.begin() + chunkLastEntity + 1);
+
+        for (int chunkStartFrame = startFrame; chunkStartFrame <= endFrame; chunkStartFrame += options.framesPerFile, ++chunkIdx)
+        {
+            if (static_cast<int>(chunkIdx % options.workerCount) != options.workerIndex)
+            {
+                // baked by another worker
+                continue;
+            }
+            int chunkEndFrame = std::min(chunkStartFrame + options.framesPerFile - 1, endFrame);
+            std::string chunkFile = TfStringPrintf("%s/%s.f%d-%d.e%zu-%zu%s", options.outputDir.c_str(), options.outputName.c_str(),
+                                                   chunkStartFrame, chunkEndFrame, chunkFirstEntity, chunkLastEntity, BAKED_GEOMETRY_FILE_EXTENSION);
+            if (TfIsFile(chunkFile))
+            {
+                // files are renamed once complete, an existing file was fully baked by a previous run
+                ++skippedChunkCount;
+                continue;
+            }
+
+            auto chunkStartTime = std::chrono::steady_clock::now();
+            BakedGeometryWriter writer(paramsHash, params.glmHalfPrecision);
+            for (int frame = chunkStartFrame; frame <= chunkEndFrame; ++frame)
+            {
+                dataImpl.BakeGeometry(chunkEntityIds, frame, writer);
+            }
+            std::string errorMessage;
+            if (!writer.write(chunkFile, errorMessage))
+            {
+                fprintf(stderr, "%s\n", errorMessage.c_str());
+                return 1;
+            }
+            double chunkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - chunkStartTime).count();
+            printf("Baked %s: %zu entity frames, %.1f MB in %.1fs\n", TfGetBaseName(chunkFile).c_str(), writer.getEntityFrameCount(), writer.getDataSize() / (1024.0 * 1024.0), chunkSeconds);
+            fflush(stdout);
+            ++bakedChunkCount;
+        }
+    }
+
+    printf("Baked %zu files, %zu files already existed\n", bakedChunkCount, skippedChunkCount);
+    return 0;
+}
@@ -0,0 +1,554 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+// Benchmarks the Golaem USD plugin through a usd stage, with the query patterns of renderers and DCCs.
+//
+// The plugin is not linked: it is loaded like in production, from PXR_PLUGINPATH_NAME or --plugin-path, so that
+// different builds of the plugin can be compared on the same caches. Each pattern runs on a newly opened stage so
+// that the patterns do not share the frame caches. The results are written as json, with the glmStats:* runtime statistics
+// of the layers when GOLAEMUSD_RUNTIME_STATS is set.
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/js/json.h>
+#include <pxr/base/plug/plugin.h>
+#include <pxr/base/plug/registry.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usd/attribute.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/mesh.h>
+USD_INCLUDES_END
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace PXR_INTERNAL_NS;
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::string stageFile;
+        std::string glmusdFile;
+        std::vector<std::string> params; // name=value
+        std::string pluginPath;
+        std::vector<std::string> patterns = {"traverse", "points", "playback", "scrub", "motionblur"};
+        int startFrame = INT_MIN;
+        int endFrame = INT_MAX;
+        int threadCount = 0;
+        int scrubCount = 100;
+        unsigned seed = 0;
+        std::vector<double> subframes = {-0.25, 0.0, 0.25};
+        std::string outputFile;
+    };
+
+    // attributes read by the patterns, collected once per stage
+    struct StageAttributes
+    {
+        std::vector<UsdAttribute> points;
+        std::vector<UsdAttribute> velocities;
+        std::vector<UsdAttribute> animated;
+        std::vector<UsdAttribute> all;
+        std::vector<UsdAttribute> stats;
+        size_t primCount = 0;
+    };
+
+    struct PatternResult
+    {
+        double openTime = 0; // s
+        double collectTime = 0;
+        std::vector<double> frameLatencies; // s
+        size_t readCount = 0;
+        std::atomic<uint64_t> readBytes{0};
+    };
+
+    //-----------------------------------------------------------------------------
+    void printUsage()
+    {
+        printf("Usage: glmUsdBench --glmusd file.glmusd [-p name=value]... [options]\n"
+               "       glmUsdBench --stage file.usd [options]\n"
+               "  --glmusd file             Golaem USD payload file, opened with the params given by -p\n"
+               "  -p, --param name=value    sets a GolaemUSD param of the --glmusd file, can be repeated\n"
+               "  --stage file              USD file loading one or several Golaem USD payloads\n"
+               "  --plugin-path dir         directory of the plugInfo.json of the plugin to benchmark\n"
+               "  --patterns list           comma separated patterns (default traverse,points,playback,scrub,motionblur)\n"
+               "                              traverse:   reads every attribute default value of the stage\n"
+               "                              points:     reads the points of all the meshes, frame by frame, in parallel\n"
+               "                              playback:   reads all the animated attributes, frame by frame, on one thread\n"
+               "                              scrub:      reads the points of all the meshes at random frames, in parallel\n"
+               "                              motionblur: reads the points and velocities of all the meshes at subframes, in parallel\n"
+               "  -f, --frames start:end    frame range (default the stage frame range)\n"
+               "  -t, --threads count       number of threads of the parallel patterns (default all cores)\n"
+               "  --scrub-count count       number of random frames of the scrub pattern (default 100)\n"
+               "  --seed seed               seed of the scrub pattern (default 0)\n"
+               "  --subframes list          comma separated subframe offsets of the motionblur pattern (default -0.25,0,0.25)\n"
+               "  -o, --output file         json output file (default stdout)\n");
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseArgs(int argc, char** argv, BenchOptions& options)
+    {
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            std::string arg = argv[iArg];
+            if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            if (iArg + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for argument '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = argv[++iArg];
+            if (arg == "--glmusd")
+            {
+                options.glmusdFile = value;
+            }
+            else if (arg == "-p" || arg == "--param")
+            {
+                options.params.push_back(value);
+            }
+            else if (arg == "--stage")
+            {
+                options.stageFile = value;
+            }
+            else if (arg == "--plugin-path")
+            {
+                options.pluginPath = value;
+            }
+            else if (arg == "--patterns")
+            {
+                options.patterns = TfStringSplit(value, ",");
+            }
+            else if ((arg == "-f" || arg == "--frames") && sscanf(value.c_str(), "%d:%d", &options.startFrame, &options.endFrame) == 2 && options.startFrame <= options.endFrame)
+            {
+            }
+            else if (arg == "-t" || arg == "--threads")
+            {
+                options.threadCount = std::atoi(value.c_str());
+            }
+            else if (arg == "--scrub-count")
+            {
+                options.scrubCount = std::max(std::atoi(value.c_str()), 1);
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            }
+            else if (arg == "--subframes")
+            {
+                options.subframes.clear();
+                for (const std::string& subframe : TfStringSplit(value, ","))
+                {
+                    options.subframes.push_back(std::atof(subframe.c_str()));
+                }
+            }
+            else if (arg == "-o" || arg == "--output")
+            {
+                options.outputFile = value;
+            }
+            else
+            {
+                fprintf(stderr, "Invalid argument '%s %s'\n", arg.c_str(), value.c_str());
+                return false;
+            }
+        }
+        if (options.stageFile.empty() == options.glmusdFile.empty())
+        {
+            fprintf(stderr, "Expected one of --glmusd or --stage\n");
+            return false;
+        }
+        for (const std::string& pattern : options.patterns)
+        {
+            if (pattern != "traverse" && pattern != "points" && pattern != "playback" && pattern != "scrub" && pattern != "motionblur")
+            {
+                fprintf(stderr, "Invalid pattern '%s'\n", pattern.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    double getElapsedTime(const std::chrono::steady_clock::time_point& startTime)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t getPeakRss()
+    {
+#ifdef _MSC_VER
+        PROCESS_MEMORY_COUNTERS memoryCounters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+        {
+            return static_cast<uint64_t>(memoryCounters.PeakWorkingSetSize);
+        }
+        return 0;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return 0;
+        }
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss); // bytes
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // KB
+#endif
+#endif
+    }
+
+    //-----------------------------------------------------------------------------
+    UsdStageRefPtr openStage(const BenchOptions& options, SdfLayerRefPtr& glmusdLayer)
+    {
+        if (!options.stageFile.empty())
+        {
+            return UsdStage::Open(options.stageFile, UsdStage::LoadAll);
+        }
+
+        // the file format arguments are parsed by the plugin, like the args composed from the GolaemUSD_Params metadata
+        SdfLayer::FileFormatArguments args;
+        for (const std::string& param : options.params)
+        {
+            size_t separatorPos = param.find('=');
+            if (separatorPos != std::string::npos)
+            {
+                args[param.substr(0, separatorPos)] = param.substr(separatorPos + 1);
+            }
+        }
+        if (args.find("glmProceduralFile") == args.end())
+        {
+            // relative paths are relative to the payload file
+            args["glmProceduralFile"] = options.glmusdFile;
+        }
+        glmusdLayer = SdfLayer::FindOrOpen(options.glmusdFile, args);
+        if (!glmusdLayer)
+        {
+            return UsdStageRefPtr();
+        }
+        return UsdStage::Open(glmusdLayer, UsdStage::LoadAll);
+    }
+
+    //-----------------------------------------------------------------------------
+    void collectAttributes(const UsdStageRefPtr& stage, StageAttributes& attributes)
+    {
+        for (const UsdPrim& prim : stage->Traverse())
+        {
+            ++attributes.primCount;
+            if (prim.IsA<UsdGeomMesh>())
+            {
+                UsdGeomMesh mesh(prim);
+                attributes.points.push_back(mesh.GetPointsAttr());
+                if (UsdAttribute velocitiesAttr = mesh.GetVelocitiesAttr())
+                {
+                    if (velocitiesAttr.HasAuthoredValue())
+                    {
+                        attributes.velocities.push_back(velocitiesAttr);
+                    }
+                }
+            }
+            for (const UsdAttribute& attribute : prim.GetAttributes())
+            {
+                attributes.all.push_back(attribute);
+                if (TfStringStartsWith(attribute.GetName().GetString(), "glmStats:"))
+                {
+                    attributes.stats.push_back(attribute);
+                }
+                else if (attribute.ValueMightBeTimeVarying())
+                {
+                    attributes.animated.push_back(attribute);
+                }
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    uint64_t getValueSize(const VtValue& value)
+    {
+        if (value.IsHolding<VtVec3fArray>())
+        {
+            return value.UncheckedGet<VtVec3fArray>().size() * sizeof(GfVec3f);
+        }
+        if (value.IsHolding<VtVec3hArray>())
+        {
+            return value.UncheckedGet<VtVec3hArray>().size() * sizeof(GfVec3h);
+        }
+        if (value.IsHolding<VtQuatfArray>())
+        {
+            return value.UncheckedGet<VtQuatfArray>().size() * sizeof(GfQuatf);
+        }
+        return 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    void readAttributes(const std::vector<UsdAttribute>& attributes, UsdTimeCode time, bool parallel, PatternResult& result)
+    {
+        auto readRange = [&](size_t start, size_t end)
+        {
+            uint64_t readBytes = 0;
+            for (size_t iAttr = start; iAttr < end; ++iAttr)
+            {
+                VtValue value;
+                attributes[iAttr].Get(&value, time);
+                readBytes += getValueSize(value);
+            }
+            result.readBytes += readBytes;
+        };
+        if (parallel)
+        {
+            WorkParallelForN(attributes.size(), readRange);
+        }
+        else
+        {
+            readRange(0, attributes.size());
+        }
+        result.readCount += attributes.size();
+    }
+
+    //-----------------------------------------------------------------------------
+    void runPattern(const std::string& pattern, const BenchOptions& options, const StageAttributes& attributes, const std::vector<int>& frames, PatternResult& result)
+    {
+        if (pattern == "traverse")
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            readAttributes(attributes.all, UsdTimeCode::Default(), false, result);
+            result.frameLatencies.push_back(getElapsedTime(startTime));
+        }
+        else if (pattern == "points" || pattern == "playback")
+        {
+            bool parallel = pattern == "points";
+            const std::vector<UsdAttribute>& frameAttributes = parallel ? attributes.points : attributes.animated;
+            for (int frame : frames)
+            {
+                auto startTime = std::chrono::steady_clock::now();
+                readAttributes(frameAttributes, UsdTimeCode(frame), parallel, result);
+                result.frameLatencies.push_back(getElapsedTime(startTime));
+            }
+        }
+        else if (pattern == "scrub")
+        {
+            std::mt19937 randomGenerator(options.seed);
+            std::uniform_int_distribution<size_t> frameDistribution(0, frames.size() - 1);
+            for (int iScrub = 0; iScrub < options.scrubCount; ++iScrub)
+            {
+                int frame = frames[frameDistribution(randomGenerator)];
+                auto startTime = std::chrono::steady_clock::now();
+                readAttributes(attributes.points, UsdTimeCode(frame), true, result);
+                result.frameLatencies.push_back(getElapsedTime(startTime));
+            }
+        }
+        else if (pattern == "motionblur")
+        {
+            for (int frame : frames)
+            {
+                auto startTime = std::chrono::steady_clock::now();
+                for (double subframe : options.subframes)
+                {
+                    readAttributes(attributes.points, UsdTimeCode(frame + subframe), true, result);
+                    readAttributes(attributes.velocities, UsdTimeCode(frame + subframe), true, result);
+                }
+                result.frameLatencies.push_back(getElapsedTime(startTime));
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    double getPercentile(const std::vector<double>& sortedValues, double percentile)
+    {
+        if (sortedValues.empty())
+        {
+            return 0;
+        }
+        size_t index = static_cast<size_t>(percentile * 0.01 * (sortedValues.size() - 1) + 0.5);
+        return sortedValues[std::min(index, sortedValues.size() - 1)];
+    }
+
+    //-----------------------------------------------------------------------------
+    JsObject toJson(const PatternResult& result, const StageAttributes& attributes)
+    {
+        std::vector<double> sortedLatencies = result.frameLatencies;
+        std::sort(sortedLatencies.begin(), sortedLatencies.end());
+        double totalTime = 0;
+        for (double latency : sortedLatencies)
+        {
+            totalTime += latency;
+        }
+        size_t frameCount = sortedLatencies.size();
+
+        JsObject latencies;
+        latencies["mean"] = frameCount > 0 ? totalTime * 1000 / frameCount : 0.0;
+        latencies["p50"] = getPercentile(sortedLatencies, 50) * 1000;
+        latencies["p90"] = getPercentile(sortedLatencies, 90) * 1000;
+        latencies["p99"] = getPercentile(sortedLatencies, 99) * 1000;
+        latencies["max"] = frameCount > 0 ? sortedLatencies.back() * 1000 : 0.0;
+
+        JsObject json;
+        json["openTimeMs"] = result.openTime * 1000;
+        json["collectTimeMs"] = result.collectTime * 1000;
+        json["primCount"] = static_cast<uint64_t>(attributes.primCount);
+        json["meshCount"] = static_cast<uint64_t>(attributes.points.size());
+        json["frameCount"] = static_cast<uint64_t>(frameCount);
+        json["readCount"] = static_cast<uint64_t>(result.readCount);
+        json["readBytes"] = static_cast<uint64_t>(result.readBytes);
+        json["totalTimeMs"] = totalTime * 1000;
+        json["frameLatencyMs"] = latencies;
+        json["framesPerSecond"] = totalTime > 0 ? frameCount / totalTime : 0.0;
+        json["readsPerSecond"] = totalTime > 0 ? result.readCount / totalTime : 0.0;
+        json["megabytesPerSecond"] = totalTime > 0 ? result.readBytes / (1024.0 * 1024.0) / totalTime : 0.0;
+
+        // runtime statistics of the layers, summed when the stage loads several layers
+        // except the lock statistics, which are shared by all the layers of the process
+        JsObject stats;
+        for (const UsdAttribute& attribute : attributes.stats)
+        {
+            int64_t value = 0;
+            if (attribute.Get(&value))
+            {
+                std::string name = attribute.GetName().GetString().substr(strlen("glmStats:"));
+                int64_t previousValue = stats.count(name) ? stats[name].GetInt64() : 0;
+                stats[name] = name.find("Lock") != std::string::npos ? std::max(previousValue, value) : previousValue + value;
+            }
+        }
+        json["stats"] = stats;
+        return json;
+    }
+} // namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+    if (!options.pluginPath.empty())
+    {
+        PlugRegistry::GetInstance().RegisterPlugins(options.pluginPath);
+    }
+    if (options.threadCount > 0)
+    {
+        WorkSetConcurrencyLimit(static_cast<unsigned>(options.threadCount));
+    }
+    PlugPluginPtr plugin = PlugRegistry::GetInstance().GetPluginWithName("glmUsdFormat");
+    if (!plugin)
+    {
+        fprintf(stderr, "The Golaem USD plugin was not found, set PXR_PLUGINPATH_NAME or --plugin-path\n");
+        return 1;
+    }
+
+    JsObject patternsJson;
+    JsArray frameRangeJson;
+    for (const std::string& pattern : options.patterns)
+    {
+        PatternResult result;
+        {
+            auto openStartTime = std::chrono::steady_clock::now();
+            SdfLayerRefPtr glmusdLayer;
+            UsdStageRefPtr stage = openStage(options, glmusdLayer);
+            if (!stage)
+            {
+                fprintf(stderr, "Could not open the stage\n");
+                return 1;
+            }
+            result.openTime = getElapsedTime(openStartTime);
+
+            StageAttributes attributes;
+            auto collectStartTime = std::chrono::steady_clock::now();
+            collectAttributes(stage, attributes);
+            result.collectTime = getElapsedTime(collectStartTime);
+
+            int startFrame = static_cast<int>(stage->GetStartTimeCode());
+            int endFrame = static_cast<int>(stage->GetEndTimeCode());
+            std::vector<double> pointsTimes;
+            if (!attributes.points.empty() && attributes.points[0].GetTimeSamples(&pointsTimes) && !pointsTimes.empty())
+            {
+                startFrame = static_cast<int>(pointsTimes.front());
+                endFrame = static_cast<int>(pointsTimes.back());
+            }
+            startFrame = std::max(startFrame, options.startFrame);
+            endFrame = std::min(endFrame, options.endFrame);
+            std::vector<int> frames;
+            for (int frame = startFrame; frame <= endFrame; ++frame)
+            {
+                frames.push_back(frame);
+            }
+            if (frames.empty())
+            {
+                fprintf(stderr, "Empty frame range\n");
+                return 1;
+            }
+            frameRangeJson = JsArray({JsValue(startFrame), JsValue(endFrame)});
+
+            runPattern(pattern, options, attributes, frames, result);
+            patternsJson[pattern] = toJson(result, attributes);
+        } // releases the stage and its layers before the next pattern
+        fprintf(stderr, "%s done\n", pattern.c_str());
+    }
+
+    JsObject paramsJson;
+    for (const std::string& param : options.params)
+    {
+        size_t separatorPos = param.find('=');
+        if (separatorPos != std::string::npos)
+        {
+            paramsJson[param.substr(0, separatorPos)] = param.substr(separatorPos + 1);
+        }
+    }
+
+    JsObject json;
+    json["plugin"] = plugin->GetPath();
+    json["stage"] = options.stageFile.empty() ? options.glmusdFile : options.stageFile;
+    json["params"] = paramsJson;
+    json["threads"] = static_cast<int>(WorkGetConcurrencyLimit());
+    json["frameRange"] = frameRangeJson;
+    json["patterns"] = patternsJson;
+    json["peakRssBytes"] = getPeakRss();
+
+    if (options.outputFile.empty())
+    {
+        JsWriteToStream(json, std::cout);
+        std::cout << std::endl;
+    }
+    else
+    {
+        std::ofstream outputStream(options.outputFile);
+        if (!outputStream)
+        {
+            fprintf(stderr, "Could not write '%s'\n", options.outputFile.c_str());
+            return 1;
+        }
+        JsWriteToStream(json, outputStream);
+    }
+    return 0;
+}
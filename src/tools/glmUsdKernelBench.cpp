@@ -0,0 +1,660 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+// Microbenchmarks of the inner loops of the entity computes (glmUSDKernels), on synthetic inputs.
+//
+// No stage, character or simulation cache is needed: the meshes, skeletons and attributes are generated from the
+// command line sizes. Each kernel reports its time per vertex, bone or entity, to compare builds and compilers on
+// the hot loops without the noise of the rest of the plugin.
+
+#include "glmUSD.h"
+#include "glmUSDKernels.h"
+#include "glmUSDRuntimeStats.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <glmCore.h>
+#include <glmCrowdIO.h>
+#include <glmGolaemCharacter.h>
+
+#include <fbxsdk.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace PXR_INTERNAL_NS;
+using namespace glm::usdplugin;
+
+namespace
+{
+    enum class NormalsMode
+    {
+        NONE,
+        FACE_VARYING,
+        VERTEX
+    };
+
+    struct KernelBenchOptions
+    {
+        int vertexCount = 10000;
+        int boneCount = 100;
+        int entityCount = 1000;
+        int attributeCount = 8; // per attribute type
+        int iterationCount = 100;
+        std::set<std::string> kernels; // all if empty
+        bool halfPrecision = false;
+        NormalsMode normalsMode = NormalsMode::FACE_VARYING;
+        unsigned int seed = 0;
+    };
+
+    const char* const s_kernelNames[] = {"fbxPoints", "fbxNormals", "gcgPoints", "gcgNormals", "joints", "shaderAttributes", "ppAttributes", "velocities", "bbox"};
+
+    //-----------------------------------------------------------------------------
+    void printUsage()
+    {
+        printf("Usage: glmUsdKernelBench [options]\n"
+               "  -v, --vertices count      vertices of the synthetic mesh (default 10000)\n"
+               "  -b, --bones count         bones of the synthetic skeleton (default 100)\n"
+               "  -e, --entities count      entities of the joints, attributes and bbox kernels (default 1000)\n"
+               "  -a, --attributes count    shader attributes per type, and pp attributes per type (default 8)\n"
+               "  -i, --iterations count    iterations of each kernel (default 100)\n"
+               "  -k, --kernels names       comma separated kernels to run (default all):\n"
+               "                            fbxPoints, fbxNormals, gcgPoints, gcgNormals, joints, shaderAttributes,\n"
+               "                            ppAttributes, velocities, bbox\n"
+               "  --half                    half precision normals and velocities, like glmHalfPrecision\n"
+               "  --normals mode            none, faceVarying or vertex, like glmNormalsMode (default faceVarying)\n"
+               "  --seed seed               seed of the synthetic values (default 0)\n");
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseArgs(int argc, char** argv, KernelBenchOptions& options)
+    {
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            std::string arg = argv[iArg];
+            if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            if (arg == "--half")
+            {
+                options.halfPrecision = true;
+                continue;
+            }
+            if (iArg + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for argument '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = argv[++iArg];
+            if (arg == "-v" || arg == "--vertices")
+            {
+                options.vertexCount = std::atoi(value.c_str());
+            }
+            else if (arg == "-b" || arg == "--bones")
+            {
+                options.boneCount = std::atoi(value.c_str());
+            }
+            else if (arg == "-e" || arg == "--entities")
+            {
+                options.entityCount = std::atoi(value.c_str());
+            }
+            else if (arg == "-a" || arg == "--attributes")
+            {
+                options.attributeCount = std::atoi(value.c_str());
+            }
+            else if (arg == "-i" || arg == "--iterations")
+            {
+                options.iterationCount = std::atoi(value.c_str());
+            }
+            else if (arg == "-k" || arg == "--kernels")
+            {
+                for (const std::string& kernel : TfStringSplit(value, ","))
+                {
+                    if (std::find(std::begin(s_kernelNames), std::end(s_kernelNames), kernel) == std::end(s_kernelNames))
+                    {
+                        fprintf(stderr, "Unknown kernel '%s'\n", kernel.c_str());
+                        return false;
+                    }
+                    options.kernels.insert(kernel);
+                }
+            }
+            else if (arg == "--normals")
+            {
+                if (value == "none")
+                {
+                    options.normalsMode = NormalsMode::NONE;
+                }
+                else if (value == "faceVarying")
+                {
+                    options.normalsMode = NormalsMode::FACE_VARYING;
+                }
+                else if (value == "vertex")
+                {
+                    options.normalsMode = NormalsMode::VERTEX;
+                }
+                else
+                {
+                    fprintf(stderr, "Invalid normals mode '%s'\n", value.c_str());
+                    return false;
+                }
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = static_cast<unsigned int>(std::strtoul(value.c_str(), NULL, 10));
+            }
+            else
+            {
+                fprintf(stderr, "Invalid argument '%s %s'\n", arg.c_str(), value.c_str());
+                return false;
+            }
+        }
+        if (options.vertexCount < 4 || options.boneCount < 1 || options.entityCount < 1 || options.attributeCount < 0 || options.iterationCount < 1)
+        {
+            fprintf(stderr, "Expected at least 4 vertices, 1 bone, 1 entity and 1 iteration\n");
+            return false;
+        }
+        // pp attribute counts are stored on 8 bits in the simulation data
+        options.attributeCount = std::min(options.attributeCount, 255);
+        return true;
+    }
+
+    // Grid mesh of quads, the shape does not matter to the kernels, only the vertex and polygon counts do
+    struct SyntheticMesh
+    {
+        size_t vertexCount = 0;
+        size_t polygonVertexCount = 0;
+        VtIntArray faceVertexIndices;
+        std::vector<uint32_t> normalIndices; // per control point normals
+        glm::Array<glm::Vector3> deformedVertices;
+        glm::Array<glm::Vector3> deformedPolygonVertexNormals;
+        glm::Array<glm::Vector3> deformedPointNormals;
+        glm::PODArray<int> vertexMasks;
+        glm::PODArray<int> polygonMasks;
+        FbxManager* fbxManager = NULL;
+        FbxMesh* fbxMesh = NULL;
+
+        ~SyntheticMesh()
+        {
+            if (fbxManager != NULL)
+            {
+                fbxManager->Destroy();
+            }
+        }
+    };
+
+    //-----------------------------------------------------------------------------
+    void createSyntheticMesh(int requestedVertexCount, std::mt19937& randomGenerator, SyntheticMesh& mesh)
+    {
+        std::uniform_real_distribution<float> noiseDistribution(-0.01f, 0.01f);
+
+        int gridSize = std::max(static_cast<int>(std::ceil(std::sqrt(static_cast<float>(requestedVertexCount)))), 2);
+        mesh.vertexCount = static_cast<size_t>(gridSize) * gridSize;
+        mesh.deformedVertices.resize(mesh.vertexCount);
+        mesh.deformedPointNormals.resize(mesh.vertexCount);
+        mesh.vertexMasks.resize(mesh.vertexCount);
+        for (int iRow = 0; iRow < gridSize; ++iRow)
+        {
+            for (int iColumn = 0; iColumn < gridSize; ++iColumn)
+            {
+                size_t iVertex = static_cast<size_t>(iRow) * gridSize + iColumn;
+                mesh.deformedVertices[iVertex] = glm::Vector3(iColumn * 0.1f, 1.f + noiseDistribution(randomGenerator), iRow * 0.1f);
+                mesh.deformedPointNormals[iVertex] = glm::Vector3(noiseDistribution(randomGenerator), 1.f, noiseDistribution(randomGenerator));
+                mesh.vertexMasks[iVertex] = static_cast<int>(iVertex);
+            }
+        }
+
+        mesh.fbxManager = FbxManager::Create();
+        mesh.fbxMesh = FbxMesh::Create(mesh.fbxManager, "kernelBenchMesh");
+        mesh.fbxMesh->InitControlPoints(static_cast<int>(mesh.vertexCount));
+        for (int iRow = 0; iRow < gridSize - 1; ++iRow)
+        {
+            for (int iColumn = 0; iColumn < gridSize - 1; ++iColumn)
+            {
+                int quadVertices[4] = {iRow * gridSize + iColumn, (iRow + 1) * gridSize + iColumn, (iRow + 1) * gridSize + iColumn + 1, iRow * gridSize + iColumn + 1};
+                mesh.fbxMesh->BeginPolygon();
+                for (int iQuadVertex = 0; iQuadVertex < 4; ++iQuadVertex)
+                {
+                    mesh.fbxMesh->AddPolygon(quadVertices[iQuadVertex]);
+                    mesh.faceVertexIndices.push_back(quadVertices[iQuadVertex]);
+                    mesh.normalIndices.push_back(static_cast<uint32_t>(quadVertices[iQuadVertex]));
+                }
+                mesh.fbxMesh->EndPolygon();
+            }
+        }
+        mesh.polygonVertexCount = mesh.faceVertexIndices.size();
+        mesh.polygonMasks.assign(mesh.fbxMesh->GetPolygonCount(), 1);
+        mesh.deformedPolygonVertexNormals.resize(mesh.polygonVertexCount);
+        for (size_t iPolyVertex = 0; iPolyVertex < mesh.polygonVertexCount; ++iPolyVertex)
+        {
+            mesh.deformedPolygonVertexNormals[iPolyVertex] = mesh.deformedPointNormals[mesh.faceVertexIndices[iPolyVertex]];
+        }
+    }
+
+    // Output normals of a mesh, allocated like _ComputeSkinMeshEntity does for each computed frame
+    struct MeshNormals
+    {
+        VtVec3fArray normals;
+        VtVec3hArray halfNormals;
+
+        void allocate(const KernelBenchOptions& options, const SyntheticMesh& mesh)
+        {
+            normals = VtVec3fArray();
+            halfNormals = VtVec3hArray();
+            if (options.normalsMode == NormalsMode::VERTEX)
+            {
+                // accumulated in float, even in half precision mode
+                normals.assign(mesh.vertexCount, GfVec3f(0.0f, 0.0f, 0.0f));
+            }
+            else if (options.halfPrecision)
+            {
+                halfNormals.resize(mesh.polygonVertexCount);
+            }
+            else
+            {
+                normals.resize(mesh.polygonVertexCount);
+            }
+        }
+
+        float checksum() const
+        {
+            return normals.empty() ? (halfNormals.empty() ? 0.f : float(halfNormals[0][1])) : normals[0][1];
+        }
+    };
+
+    struct KernelResult
+    {
+        std::string name;
+        std::string unit;
+        uint64_t unitCount = 0;
+        int64_t time = 0; // ns
+    };
+
+    //-----------------------------------------------------------------------------
+    void printResults(const std::vector<KernelResult>& results)
+    {
+        printf("%-20s %10s %14s %12s %12s\n", "kernel", "unit", "units", "total ms", "ns/unit");
+        for (const KernelResult& result : results)
+        {
+            printf("%-20s %10s %14llu %12.3f %12.3f\n",
+                   result.name.c_str(),
+                   result.unit.c_str(),
+                   static_cast<unsigned long long>(result.unitCount),
+                   result.time * 1e-6,
+                   result.unitCount > 0 ? static_cast<double>(result.time) / result.unitCount : 0.0);
+        }
+    }
+} // namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    KernelBenchOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+    auto runKernel = [&options](const char* kernel)
+    {
+        return options.kernels.empty() || options.kernels.count(kernel) > 0;
+    };
+
+    glm::usdplugin::init();
+
+    std::mt19937 randomGenerator(options.seed);
+    std::uniform_real_distribution<float> valueDistribution(-1.f, 1.f);
+
+    SyntheticMesh mesh;
+    createSyntheticMesh(options.vertexCount, randomGenerator, mesh);
+
+    // one entity type, every entity has the same skeleton
+    uint32_t entityCount = static_cast<uint32_t>(options.entityCount);
+    uint16_t boneCount = static_cast<uint16_t>(std::min(options.boneCount, 65535));
+    uint8_t ppAttributeCount = static_cast<uint8_t>(options.attributeCount);
+    glm::crowdio::GlmSimulationData* simuData = NULL;
+    glm::crowdio::GlmFrameData* frameData = NULL;
+    if (glm::crowdio::glmCreateSimulationData(&simuData, entityCount, 1, ppAttributeCount, ppAttributeCount) != glm::crowdio::GIO_SUCCESS)
+    {
+        fprintf(stderr, "Could not create the simulation data\n");
+        glm::usdplugin::finish();
+        return 1;
+    }
+    simuData->_boneCount[0] = boneCount;
+    simuData->_entityCountPerEntityType[0] = entityCount;
+    simuData->_iBoneOffsetPerEntityType[0] = 0;
+    for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+    {
+        simuData->_entityTypes[iEntity] = 0;
+        simuData->_indexInEntityType[iEntity] = iEntity;
+        simuData->_scales[iEntity] = 1.f;
+    }
+    if (glm::crowdio::glmCreateFrameData(&frameData, simuData) != glm::crowdio::GIO_SUCCESS)
+    {
+        fprintf(stderr, "Could not create the frame data\n");
+        glm::crowdio::glmDestroySimulationData(&simuData);
+        glm::usdplugin::finish();
+        return 1;
+    }
+    for (size_t iBone = 0, totalBoneCount = static_cast<size_t>(entityCount) * boneCount; iBone < totalBoneCount; ++iBone)
+    {
+        float* position = frameData->_bonePositions[iBone];
+        float* orientation = frameData->_boneOrientations[iBone];
+        GfQuatf rotation(1.f + valueDistribution(randomGenerator), valueDistribution(randomGenerator), valueDistribution(randomGenerator), valueDistribution(randomGenerator));
+        rotation.Normalize();
+        for (int iAxis = 0; iAxis < 3; ++iAxis)
+        {
+            position[iAxis] = valueDistribution(randomGenerator);
+            orientation[iAxis] = rotation.GetImaginary()[iAxis];
+        }
+        orientation[3] = rotation.GetReal();
+    }
+    for (uint8_t iAttr = 0; iAttr < ppAttributeCount; ++iAttr)
+    {
+        for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+        {
+            frameData->_ppFloatAttributeData[iAttr][iEntity] = valueDistribution(randomGenerator);
+            for (int iAxis = 0; iAxis < 3; ++iAxis)
+            {
+                frameData->_ppVectorAttributeData[iAttr][iEntity][iAxis] = valueDistribution(randomGenerator);
+            }
+        }
+    }
+
+    // binary tree skeleton, with identity mapping between the character and the cache bones
+    glm::PODArray<int> fatherBoneIndices;
+    glm::PODArray<size_t> specificToCacheBoneIndices;
+    glm::Array<glm::Vector3> worldScales;
+    fatherBoneIndices.resize(boneCount, -1);
+    specificToCacheBoneIndices.resize(boneCount, 0);
+    worldScales.resize(boneCount, glm::Vector3(1, 1, 1));
+    for (int iBone = 0; iBone < boneCount; ++iBone)
+    {
+        fatherBoneIndices[iBone] = iBone == 0 ? -1 : (iBone - 1) / 2;
+        specificToCacheBoneIndices[iBone] = iBone;
+        worldScales[iBone] = glm::Vector3(1.f + 0.1f * valueDistribution(randomGenerator), 1.f, 1.f);
+    }
+
+    // shader attributes, cycling through the attribute types
+    size_t attributeCount = static_cast<size_t>(options.attributeCount);
+    glm::Array<glm::ShaderAttribute> shaderAttributes;
+    glm::PODArray<size_t> globalToSpecificShaderAttrIdx;
+    shaderAttributes.resize(attributeCount * 4);
+    globalToSpecificShaderAttrIdx.resize(attributeCount * 4, 0);
+    for (size_t iShaderAttr = 0, shaderAttrCount = shaderAttributes.size(); iShaderAttr < shaderAttrCount; ++iShaderAttr)
+    {
+        glm::ShaderAttribute& shaderAttribute = shaderAttributes[iShaderAttr];
+        switch (iShaderAttr % 4)
+        {
+        case 0:
+            shaderAttribute._type = glm::ShaderAttributeType::INT;
+            break;
+        case 1:
+            shaderAttribute._type = glm::ShaderAttributeType::FLOAT;
+            break;
+        case 2:
+            shaderAttribute._type = glm::ShaderAttributeType::STRING;
+            break;
+        default:
+            shaderAttribute._type = glm::ShaderAttributeType::VECTOR;
+            break;
+        }
+        globalToSpecificShaderAttrIdx[iShaderAttr] = iShaderAttr / 4;
+    }
+    glm::Array<glm::PODArray<int>> intShaderData;
+    glm::Array<glm::PODArray<float>> floatShaderData;
+    glm::Array<glm::Array<glm::GlmString>> stringShaderData;
+    glm::Array<glm::Array<glm::Vector3>> vectorShaderData;
+    intShaderData.resize(entityCount);
+    floatShaderData.resize(entityCount);
+    stringShaderData.resize(entityCount);
+    vectorShaderData.resize(entityCount);
+    for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+    {
+        intShaderData[iEntity].resize(attributeCount, 0);
+        floatShaderData[iEntity].resize(attributeCount, 0.f);
+        stringShaderData[iEntity].resize(attributeCount);
+        vectorShaderData[iEntity].resize(attributeCount);
+        for (size_t iAttr = 0; iAttr < attributeCount; ++iAttr)
+        {
+            intShaderData[iEntity][iAttr] = static_cast<int>(iEntity + iAttr);
+            floatShaderData[iEntity][iAttr] = valueDistribution(randomGenerator);
+            // a few distinct strings, like texture or variation names
+            stringShaderData[iEntity][iAttr] = TfStringPrintf("syntheticString%zu", (iEntity + iAttr) % 16).c_str();
+            vectorShaderData[iEntity][iAttr] = glm::Vector3(valueDistribution(randomGenerator), valueDistribution(randomGenerator), valueDistribution(randomGenerator));
+        }
+    }
+
+    // FBX mesh transform, not the identity so that the transformed paths are measured
+    FbxAMatrix nodeTransform;
+    nodeTransform.SetTRS(FbxVector4(1, 2, 3), FbxVector4(10, 20, 30), FbxVector4(1, 1, 1));
+    FbxAMatrix globalRotate;
+    globalRotate.SetIdentity();
+    globalRotate.SetR(nodeTransform.GetR());
+
+    GfVec3f entityPos(0.5f, 0.f, 0.5f);
+    const int* vertexNormalIndices = options.normalsMode == NormalsMode::VERTEX ? mesh.faceVertexIndices.cdata() : NULL;
+    bool normalsEnabled = options.normalsMode != NormalsMode::NONE;
+    int iterationCount = options.iterationCount;
+    float checksum = 0.f; // keeps the outputs alive
+    std::vector<KernelResult> results;
+
+    if (runKernel("fbxPoints"))
+    {
+        VtVec3fArray points;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            points = VtVec3fArray(mesh.vertexCount);
+            GfRange3f extent;
+            gatherPoints(mesh.deformedVertices, &mesh.vertexMasks, &nodeTransform, entityPos, points, extent);
+            checksum += points[0][0] + extent.GetMax()[1];
+        }
+        results.push_back({"fbxPoints", "vertex", static_cast<uint64_t>(iterationCount) * mesh.vertexCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("fbxNormals") && normalsEnabled)
+    {
+        MeshNormals meshNormals;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            meshNormals.allocate(options, mesh);
+            gatherFbxPolygonVertexNormals(mesh.deformedPolygonVertexNormals, mesh.fbxMesh, mesh.polygonMasks, &globalRotate, vertexNormalIndices, meshNormals.normals, meshNormals.halfNormals);
+            if (options.normalsMode == NormalsMode::VERTEX)
+            {
+                finalizeVertexNormals(meshNormals.normals, meshNormals.halfNormals, options.halfPrecision);
+            }
+            checksum += meshNormals.checksum();
+        }
+        results.push_back({"fbxNormals", "polyVertex", static_cast<uint64_t>(iterationCount) * mesh.polygonVertexCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("gcgPoints"))
+    {
+        VtVec3fArray points;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            points = VtVec3fArray(mesh.vertexCount);
+            GfRange3f extent;
+            gatherPoints(mesh.deformedVertices, NULL, NULL, entityPos, points, extent);
+            checksum += points[0][0] + extent.GetMax()[1];
+        }
+        results.push_back({"gcgPoints", "vertex", static_cast<uint64_t>(iterationCount) * mesh.vertexCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("gcgNormals") && normalsEnabled)
+    {
+        MeshNormals meshNormals;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            meshNormals.allocate(options, mesh);
+            gatherPolygonVertexNormals(mesh.deformedPointNormals, mesh.normalIndices.data(), mesh.polygonVertexCount, vertexNormalIndices, meshNormals.normals, meshNormals.halfNormals);
+            if (options.normalsMode == NormalsMode::VERTEX)
+            {
+                finalizeVertexNormals(meshNormals.normals, meshNormals.halfNormals, options.halfPrecision);
+            }
+            checksum += meshNormals.checksum();
+        }
+        results.push_back({"gcgNormals", "polyVertex", static_cast<uint64_t>(iterationCount) * mesh.polygonVertexCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("joints"))
+    {
+        VtVec3hArray scales(boneCount, GfVec3h(1, 1, 1));
+        VtVec3fArray translations(boneCount);
+        VtQuatfArray rotations(boneCount);
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                scales.assign(boneCount, GfVec3h(1, 1, 1));
+                computeLocalScales(fatherBoneIndices, worldScales, scales);
+                computeLocalJoints(frameData, iEntity * boneCount, specificToCacheBoneIndices, fatherBoneIndices, 1.f, &worldScales, translations, rotations);
+            }
+            checksum += translations[boneCount - 1][0] + float(scales[boneCount - 1][0]);
+        }
+        results.push_back({"joints", "bone", static_cast<uint64_t>(iterationCount) * entityCount * boneCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("shaderAttributes"))
+    {
+        // sized like _ComputeEntity does from the specific attribute counters
+        glm::PODArray<int> intValues;
+        glm::PODArray<float> floatValues;
+        glm::Array<TfToken> stringValues;
+        glm::Array<GfVec3f> vectorValues;
+        intValues.resize(attributeCount, 0);
+        floatValues.resize(attributeCount, 0);
+        stringValues.resize(attributeCount);
+        vectorValues.resize(attributeCount, GfVec3f(0));
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                copyShaderAttributes(
+                    shaderAttributes,
+                    globalToSpecificShaderAttrIdx,
+                    intShaderData[iEntity],
+                    floatShaderData[iEntity],
+                    stringShaderData[iEntity],
+                    vectorShaderData[iEntity],
+                    intValues,
+                    floatValues,
+                    stringValues,
+                    vectorValues);
+            }
+            checksum += attributeCount > 0 ? floatValues[0] : 0.f;
+        }
+        results.push_back({"shaderAttributes", "entity", static_cast<uint64_t>(iterationCount) * entityCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("ppAttributes"))
+    {
+        glm::PODArray<float> floatValues;
+        glm::Array<GfVec3f> vectorValues;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                copyPPAttributes(simuData, frameData, iEntity, floatValues, vectorValues);
+            }
+            checksum += attributeCount > 0 ? floatValues[0] : 0.f;
+        }
+        results.push_back({"ppAttributes", "entity", static_cast<uint64_t>(iterationCount) * entityCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("velocities"))
+    {
+        VtVec3fArray prevPoints(mesh.vertexCount);
+        VtVec3fArray currentPoints(mesh.vertexCount);
+        for (size_t iVertex = 0; iVertex < mesh.vertexCount; ++iVertex)
+        {
+            prevPoints[iVertex].Set(mesh.deformedVertices[iVertex].getFloatValues());
+            currentPoints[iVertex] = prevPoints[iVertex] + GfVec3f(0.01f, 0.f, 0.02f);
+        }
+        VtVec3fArray velocities;
+        VtVec3hArray halfVelocities;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            if (options.halfPrecision)
+            {
+                halfVelocities = VtVec3hArray();
+                computeVelocities(currentPoints, prevPoints, 24.f, halfVelocities);
+                checksum += float(halfVelocities[0][0]);
+            }
+            else
+            {
+                velocities = VtVec3fArray();
+                computeVelocities(currentPoints, prevPoints, 24.f, velocities);
+                checksum += velocities[0][0];
+            }
+        }
+        results.push_back({"velocities", "vertex", static_cast<uint64_t>(iterationCount) * mesh.vertexCount, RuntimeStats::now() - startTime});
+    }
+
+    if (runKernel("bbox"))
+    {
+        // faces of the BBOX template mesh
+        const int boxFaceVertexIndices[24] = {3, 2, 1, 0, 2, 6, 5, 1, 3, 7, 6, 2, 0, 4, 7, 3, 1, 5, 4, 0, 5, 6, 7, 4};
+        VtIntArray faceVertexIndices(std::begin(boxFaceVertexIndices), std::end(boxFaceVertexIndices));
+        VtVec3fArray points;
+        VtVec3fArray normals;
+        VtVec3hArray halfNormals;
+        int64_t startTime = RuntimeStats::now();
+        for (int iIteration = 0; iIteration < iterationCount; ++iIteration)
+        {
+            for (uint32_t iEntity = 0; iEntity < entityCount; ++iEntity)
+            {
+                GfVec3f halfExtents(0.5f, 1.f + 0.001f * (iEntity % 100), 0.5f);
+                points = VtVec3fArray();
+                normals = VtVec3fArray();
+                computeBoxMesh(halfExtents, faceVertexIndices, options.normalsMode == NormalsMode::VERTEX, points, normals);
+                if (options.halfPrecision)
+                {
+                    toHalfArray(normals, halfNormals);
+                }
+            }
+            checksum += points[5][1];
+        }
+        results.push_back({"bbox", "entity", static_cast<uint64_t>(iterationCount) * entityCount, RuntimeStats::now() - startTime});
+    }
+
+    printf("%zu vertices, %zu polygon vertices, %u bones, %u entities, %zu attributes per type, %d iterations%s\n",
+           mesh.vertexCount,
+           mesh.polygonVertexCount,
+           static_cast<unsigned int>(boneCount),
+           entityCount,
+           attributeCount,
+           iterationCount,
+           options.halfPrecision ? ", half precision" : "");
+    if (!normalsEnabled)
+    {
+        printf("Normals mode none, the normals kernels are skipped\n");
+    }
+    printResults(results);
+    printf("checksum %g\n", checksum);
+
+    glm::crowdio::glmDestroyFrameData(&frameData, simuData);
+    glm::crowdio::glmDestroySimulationData(&simuData);
+    glm::usdplugin::finish();
+    return 0;
+}
@@ -0,0 +1,324 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+// Replays a query trace recorded with GOLAEMUSD_TRACE_DIR against this build of the plugin.
+//
+// The layer is created with the params of the trace, then the recorded calls are issued again. By default each
+// recorded thread is replayed by its own thread, in its recorded order; --threads 1 replays the whole trace serially.
+// With --verify, the results and value hashes are compared to the recorded ones, the tool fails on any difference.
+
+#include "glmUSD.h"
+#include "glmUSDData.h"
+#include "glmUSDQueryTrace.h"
+#include "glmUSDRuntimeStats.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/usd/sdf/schema.h>
+USD_INCLUDES_END
+
+#include <glmCoreDefinitions.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PXR_INTERNAL_NS;
+using namespace glm::usdplugin;
+
+namespace
+{
+    struct ReplayOptions
+    {
+        std::string traceFile;
+        std::vector<std::string> params; // name=value
+        int threadCount = 0;             // 0: one thread per recorded thread
+        bool realtime = false;
+        bool verify = false;
+    };
+
+    struct CallStats
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<int64_t> recordedTime{0};
+        std::atomic<int64_t> replayedTime{0};
+        std::atomic<uint64_t> mismatches{0};
+    };
+
+    // Visits all the specs, like a layer export
+    class NullSpecVisitor : public SdfAbstractDataSpecVisitor
+    {
+    public:
+        bool VisitSpec(const SdfAbstractData& data, const SdfPath& path) override
+        {
+            GLM_UNREFERENCED(data);
+            GLM_UNREFERENCED(path);
+            ++specCount;
+            return true;
+        }
+        void Done(const SdfAbstractData& data) override
+        {
+            GLM_UNREFERENCED(data);
+        }
+        uint64_t specCount = 0;
+    };
+
+    //-----------------------------------------------------------------------------
+    void printUsage()
+    {
+        printf("Usage: glmUsdReplay trace.glmtrace [options]\n"
+               "  -p, --param name=value    overrides a GolaemUSD param of the trace, can be repeated\n"
+               "  -t, --threads count       number of replay threads (default one per recorded thread)\n"
+               "  --realtime                waits for the recorded start time of each call instead of replaying as fast as possible\n"
+               "  --verify                  compares the results to the recorded ones, fails on any difference\n");
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseArgs(int argc, char** argv, ReplayOptions& options)
+    {
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            std::string arg = argv[iArg];
+            if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            if (arg == "--realtime")
+            {
+                options.realtime = true;
+                continue;
+            }
+            if (arg == "--verify")
+            {
+                options.verify = true;
+                continue;
+            }
+            if (arg[0] != '-')
+            {
+                options.traceFile = arg;
+                continue;
+            }
+            if (iArg + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for argument '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = argv[++iArg];
+            if (arg == "-p" || arg == "--param")
+            {
+                options.params.push_back(value);
+            }
+            else if (arg == "-t" || arg == "--threads")
+            {
+                options.threadCount = std::atoi(value.c_str());
+            }
+            else
+            {
+                fprintf(stderr, "Invalid argument '%s %s'\n", arg.c_str(), value.c_str());
+                return false;
+            }
+        }
+        if (options.traceFile.empty())
+        {
+            fprintf(stderr, "Expected a trace file\n");
+            return false;
+        }
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    void replayCall(const SdfAbstractData& data, const QueryTraceEntry& entry, uint64_t& result, uint64_t& hash)
+    {
+        result = 0;
+        hash = 0;
+        double tLower = 0, tUpper = 0;
+        switch (entry.call.callType)
+        {
+        case QueryTraceCallType::GET_SPEC_TYPE:
+            result = data.GetSpecType(entry.path);
+            break;
+        case QueryTraceCallType::HAS:
+            result = data.Has(entry.path, entry.field, static_cast<VtValue*>(nullptr));
+            break;
+        case QueryTraceCallType::HAS_VALUE:
+        {
+            VtValue value;
+            result = data.Has(entry.path, entry.field, &value);
+            hash = result ? hashQueryTraceValue(entry.field, value) : 0;
+            break;
+        }
+        case QueryTraceCallType::LIST:
+        {
+            std::vector<TfToken> fields = data.List(entry.path);
+            result = fields.size();
+            hash = hashQueryTraceValues(fields);
+            break;
+        }
+        case QueryTraceCallType::VISIT_SPECS:
+        {
+            NullSpecVisitor visitor;
+            data.VisitSpecs(&visitor);
+            result = visitor.specCount;
+            break;
+        }
+        case QueryTraceCallType::LIST_ALL_TIME_SAMPLES:
+        {
+            std::set<double> times = data.ListAllTimeSamples();
+            result = times.size();
+            hash = hashQueryTraceValues(times);
+            break;
+        }
+        case QueryTraceCallType::LIST_TIME_SAMPLES_FOR_PATH:
+        {
+            std::set<double> times = data.ListTimeSamplesForPath(entry.path);
+            result = times.size();
+            hash = hashQueryTraceValues(times);
+            break;
+        }
+        case QueryTraceCallType::GET_NUM_TIME_SAMPLES_FOR_PATH:
+            result = data.GetNumTimeSamplesForPath(entry.path);
+            break;
+        case QueryTraceCallType::GET_BRACKETING_TIME_SAMPLES:
+            result = data.GetBracketingTimeSamples(entry.call.time, &tLower, &tUpper);
+            hash = result ? hashQueryTraceValues(std::vector<double>{tLower, tUpper}) : 0;
+            break;
+        case QueryTraceCallType::GET_BRACKETING_TIME_SAMPLES_FOR_PATH:
+            result = data.GetBracketingTimeSamplesForPath(entry.path, entry.call.time, &tLower, &tUpper);
+            hash = result ? hashQueryTraceValues(std::vector<double>{tLower, tUpper}) : 0;
+            break;
+        case QueryTraceCallType::QUERY_TIME_SAMPLE:
+            result = data.QueryTimeSample(entry.path, entry.call.time, static_cast<VtValue*>(nullptr));
+            break;
+        case QueryTraceCallType::QUERY_TIME_SAMPLE_VALUE:
+        {
+            VtValue value;
+            result = data.QueryTimeSample(entry.path, entry.call.time, &value);
+            hash = result ? hashQueryTraceValue(SdfFieldKeys->Default, value) : 0;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+} // namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ReplayOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    QueryTraceReader reader;
+    std::string errorMessage;
+    if (!reader.read(options.traceFile, errorMessage))
+    {
+        fprintf(stderr, "%s\n", errorMessage.c_str());
+        return 1;
+    }
+    if (options.verify && reader.getHashFunction() != QueryTraceHashFunction::FNV1A_64)
+    {
+        fprintf(stderr, "'%s' was recorded with an unsupported hash function, it cannot be verified\n", options.traceFile.c_str());
+        return 1;
+    }
+    SdfFileFormat::FileFormatArguments args = reader.getArgs();
+    for (const std::string& param : options.params)
+    {
+        size_t separatorPos = param.find('=');
+        if (separatorPos == std::string::npos)
+        {
+            fprintf(stderr, "Invalid param '%s', expected name=value\n", param.c_str());
+            return 1;
+        }
+        args[param.substr(0, separatorPos)] = param.substr(separatorPos + 1);
+    }
+    const std::vector<QueryTraceEntry>& entries = reader.getEntries();
+
+    auto openStartTime = std::chrono::steady_clock::now();
+    GolaemUSD_DataRefPtr data = GolaemUSD_Data::New(GolaemUSD_DataParams::FromArgs(args));
+    double openSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStartTime).count();
+
+    // calls of each replay thread, in their recorded order
+    uint32_t replayThreadCount = options.threadCount > 0 ? static_cast<uint32_t>(options.threadCount) : std::max(reader.getThreadCount(), 1u);
+    std::vector<std::vector<size_t>> entriesPerThread(replayThreadCount);
+    for (size_t iEntry = 0, entryCount = entries.size(); iEntry < entryCount; ++iEntry)
+    {
+        entriesPerThread[entries[iEntry].call.threadIndex % replayThreadCount].push_back(iEntry);
+    }
+
+    CallStats callStats[QueryTraceCallType::COUNT];
+    int64_t replayStartTime = RuntimeStats::now();
+    auto replayThread = [&](const std::vector<size_t>& threadEntries)
+    {
+        for (size_t iEntry : threadEntries)
+        {
+            const QueryTraceEntry& entry = entries[iEntry];
+            if (options.realtime)
+            {
+                int64_t delay = entry.call.startTime - (RuntimeStats::now() - replayStartTime);
+                if (delay > 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(delay));
+                }
+            }
+            uint64_t result = 0, hash = 0;
+            int64_t startTime = RuntimeStats::now();
+            replayCall(*data, entry, result, hash);
+            CallStats& stats = callStats[entry.call.callType];
+            stats.replayedTime += RuntimeStats::now() - startTime;
+            stats.recordedTime += entry.call.duration;
+            ++stats.count;
+            if (options.verify && (result != entry.call.result || hash != entry.call.hash))
+            {
+                if (stats.mismatches++ == 0)
+                {
+                    fprintf(stderr, "%s mismatch on '%s' '%s' at %g\n", getQueryTraceCallName(static_cast<QueryTraceCallType::Value>(entry.call.callType)), entry.path.GetText(), entry.field.GetText(), entry.call.time);
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t iThread = 1; iThread < replayThreadCount; ++iThread)
+    {
+        threads.emplace_back(replayThread, std::cref(entriesPerThread[iThread]));
+    }
+    replayThread(entriesPerThread[0]);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    double replaySeconds = (RuntimeStats::now() - replayStartTime) * 1e-9;
+
+    printf("Replayed %zu calls on %u threads in %.3fs (layer created in %.3fs)\n", entries.size(), replayThreadCount, replaySeconds, openSeconds);
+    printf("%-36s %12s %14s %14s %12s\n", "call", "count", "recorded ms", "replayed ms", "mismatches");
+    uint64_t mismatchCount = 0;
+    for (int iCallType = 0; iCallType < QueryTraceCallType::COUNT; ++iCallType)
+    {
+        const CallStats& stats = callStats[iCallType];
+        if (stats.count == 0)
+        {
+            continue;
+        }
+        printf("%-36s %12llu %14.3f %14.3f %12llu\n",
+               getQueryTraceCallName(static_cast<QueryTraceCallType::Value>(iCallType)),
+               static_cast<unsigned long long>(stats.count),
+               stats.recordedTime * 1e-6,
+               stats.replayedTime * 1e-6,
+               static_cast<unsigned long long>(stats.mismatches));
+        mismatchCount += stats.mismatches;
+    }
+    return mismatchCount > 0 ? 2 : 0;
+}
@@ -0,0 +1,517 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+// Stress test of the Golaem USD layers: randomized queries from many threads, checked against a single threaded reference.
+//
+// A set of random queries (spec types, fields, time samples and bracketing times of random paths at random frames) is
+// first evaluated on one thread. Then all the threads issue random queries of the set concurrently, while another thread
+// sends stage notices to the layers, and every result is compared to its reference. Like glmUsdBench, the plugin is
+// loaded from PXR_PLUGINPATH_NAME or --plugin-path, so that any build of the plugin can be checked.
+
+#include "glmUSD.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/plug/plugin.h>
+#include <pxr/base/plug/registry.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/usd/sdf/fileFormat.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/attribute.h>
+#include <pxr/usd/usd/editContext.h>
+#include <pxr/usd/usd/stage.h>
+USD_INCLUDES_END
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PXR_INTERNAL_NS;
+
+namespace
+{
+    struct StressOptions
+    {
+        std::string stageFile;
+        std::string glmusdFile;
+        std::vector<std::string> params; // name=value
+        std::string pluginPath;
+        int threadCount = 0; // 0: all cores
+        int queryCount = 10000;
+        int callCount = 100000; // per thread
+        int noticeInterval = 10; // ms, 0: no notices
+        bool subframes = false;
+        unsigned seed = 0;
+    };
+
+    struct QueryType
+    {
+        enum Value
+        {
+            SPEC_TYPE,
+            FIELD,
+            TIME_SAMPLE,
+            TIME_SAMPLES_FOR_PATH,
+            BRACKETING_TIME_SAMPLES_FOR_PATH,
+            COUNT
+        };
+    };
+
+    const char* QUERY_TYPE_NAMES[QueryType::COUNT] = {"GetSpecType", "HasField", "QueryTimeSample", "ListTimeSamplesForPath", "GetBracketingTimeSamplesForPath"};
+
+    struct Query
+    {
+        QueryType::Value type = QueryType::SPEC_TYPE;
+        SdfLayerHandle layer;
+        SdfPath path;
+        TfToken field;
+        double time = 0;
+    };
+
+    // array values are only kept as hashes, the reference of a large set would not fit in memory otherwise
+    struct QueryResult
+    {
+        uint64_t result = 0; // bool, count or spec type
+        size_t hash = 0;
+        VtValue value;
+
+        bool operator==(const QueryResult& other) const
+        {
+            return result == other.result && hash == other.hash && value == other.value;
+        }
+    };
+
+    struct QueryStats
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> mismatches{0};
+    };
+
+    //-----------------------------------------------------------------------------
+    void printUsage()
+    {
+        printf("Usage: glmUsdStress --glmusd file.glmusd [-p name=value]... [options]\n"
+               "       glmUsdStress --stage file.usd [options]\n"
+               "  --glmusd file             Golaem USD payload file, opened with the params given by -p\n"
+               "  -p, --param name=value    sets a GolaemUSD param of the --glmusd file, can be repeated\n"
+               "  --stage file              USD file loading one or several Golaem USD payloads\n"
+               "  --plugin-path dir         directory of the plugInfo.json of the plugin to check\n"
+               "  -t, --threads count       number of query threads (default all cores)\n"
+               "  --queries count           number of distinct random queries (default 10000)\n"
+               "  --calls count             number of queries issued by each thread (default 100000)\n"
+               "  --notice-interval ms      interval between two stage notices, 0 to disable them (default 10)\n"
+               "  --subframes               also queries time samples at subframes\n"
+               "  --seed seed               seed of the queries (default 0)\n");
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseArgs(int argc, char** argv, StressOptions& options)
+    {
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            std::string arg = argv[iArg];
+            if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            if (arg == "--subframes")
+            {
+                options.subframes = true;
+                continue;
+            }
+            if (iArg + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for argument '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = argv[++iArg];
+            if (arg == "--glmusd")
+            {
+                options.glmusdFile = value;
+            }
+            else if (arg == "-p" || arg == "--param")
+            {
+                options.params.push_back(value);
+            }
+            else if (arg == "--stage")
+            {
+                options.stageFile = value;
+            }
+            else if (arg == "--plugin-path")
+            {
+                options.pluginPath = value;
+            }
+            else if (arg == "-t" || arg == "--threads")
+            {
+                options.threadCount = std::atoi(value.c_str());
+            }
+            else if (arg == "--queries")
+            {
+                options.queryCount = std::max(std::atoi(value.c_str()), 1);
+            }
+            else if (arg == "--calls")
+            {
+                options.callCount = std::max(std::atoi(value.c_str()), 1);
+            }
+            else if (arg == "--notice-interval")
+            {
+                options.noticeInterval = std::max(std::atoi(value.c_str()), 0);
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            }
+            else
+            {
+                fprintf(stderr, "Invalid argument '%s %s'\n", arg.c_str(), value.c_str());
+                return false;
+            }
+        }
+        if (options.stageFile.empty() == options.glmusdFile.empty())
+        {
+            fprintf(stderr, "Expected one of --glmusd or --stage\n");
+            return false;
+        }
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    UsdStageRefPtr openStage(const StressOptions& options, SdfLayerRefPtr& glmusdLayer)
+    {
+        if (!options.stageFile.empty())
+        {
+            return UsdStage::Open(options.stageFile, UsdStage::LoadAll);
+        }
+
+        // the file format arguments are parsed by the plugin, like the args composed from the GolaemUSD_Params metadata
+        SdfLayer::FileFormatArguments args;
+        for (const std::string& param : options.params)
+        {
+            size_t separatorPos = param.find('=');
+            if (separatorPos != std::string::npos)
+            {
+                args[param.substr(0, separatorPos)] = param.substr(separatorPos + 1);
+            }
+        }
+        if (args.find("glmProceduralFile") == args.end())
+        {
+            // relative paths are relative to the payload file
+            args["glmProceduralFile"] = options.glmusdFile;
+        }
+        glmusdLayer = SdfLayer::FindOrOpen(options.glmusdFile, args);
+        if (!glmusdLayer)
+        {
+            return UsdStageRefPtr();
+        }
+        return UsdStage::Open(glmusdLayer, UsdStage::LoadAll);
+    }
+
+    //-----------------------------------------------------------------------------
+    size_t hashTimes(const std::set<double>& times)
+    {
+        size_t hash = times.size();
+        for (double time : times)
+        {
+            hash = hash * 31 + std::hash<double>()(time);
+        }
+        return hash;
+    }
+
+    //-----------------------------------------------------------------------------
+    void setValue(const VtValue& value, QueryResult& result)
+    {
+        if (value.IsArrayValued())
+        {
+            result.hash = value.GetHash();
+        }
+        else
+        {
+            result.value = value;
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    QueryResult runQuery(const Query& query)
+    {
+        QueryResult result;
+        const SdfLayerHandle& layer = query.layer;
+        switch (query.type)
+        {
+        case QueryType::SPEC_TYPE:
+            result.result = layer->GetSpecType(query.path);
+            break;
+        case QueryType::FIELD:
+        {
+            VtValue value;
+            result.result = layer->HasField(query.path, query.field, &value);
+            setValue(value, result);
+            break;
+        }
+        case QueryType::TIME_SAMPLE:
+        {
+            VtValue value;
+            result.result = layer->QueryTimeSample(query.path, query.time, &value);
+            setValue(value, result);
+            break;
+        }
+        case QueryType::TIME_SAMPLES_FOR_PATH:
+        {
+            std::set<double> times = layer->ListTimeSamplesForPath(query.path);
+            result.result = times.size();
+            result.hash = hashTimes(times);
+            break;
+        }
+        case QueryType::BRACKETING_TIME_SAMPLES_FOR_PATH:
+        {
+            double tLower = 0, tUpper = 0;
+            result.result = layer->GetBracketingTimeSamplesForPath(query.path, query.time, &tLower, &tUpper);
+            result.hash = hashTimes({tLower, tUpper});
+            break;
+        }
+        default:
+            break;
+        }
+        return result;
+    }
+
+    //-----------------------------------------------------------------------------
+    void generateQueries(const std::vector<SdfLayerHandle>& layers, const StressOptions& options, std::vector<Query>& queries)
+    {
+        struct LayerSpecs
+        {
+            std::vector<SdfPath> paths;
+            std::vector<std::vector<TfToken>> fields;
+            std::vector<double> times;
+        };
+        std::vector<LayerSpecs> specsPerLayer(layers.size());
+        for (size_t iLayer = 0, layerCount = layers.size(); iLayer < layerCount; ++iLayer)
+        {
+            LayerSpecs& specs = specsPerLayer[iLayer];
+            layers[iLayer]->Traverse(SdfPath::AbsoluteRootPath(), [&specs](const SdfPath& path)
+                                     {
+                                         // the glmStats:* attributes of the root prim change with the queries themselves
+                                         if (!path.IsPropertyPath() || !TfStringStartsWith(path.GetName(), "glmStats:"))
+                                         {
+                                             specs.paths.push_back(path);
+                                         }
+                                     });
+            specs.fields.resize(specs.paths.size());
+            for (size_t iPath = 0, pathCount = specs.paths.size(); iPath < pathCount; ++iPath)
+            {
+                for (const TfToken& field : layers[iLayer]->ListFields(specs.paths[iPath]))
+                {
+                    // time samples are queried with QueryTimeSample, the whole map would be computed otherwise
+                    if (field != SdfFieldKeys->TimeSamples)
+                    {
+                        specs.fields[iPath].push_back(field);
+                    }
+                }
+            }
+            std::set<double> times = layers[iLayer]->ListAllTimeSamples();
+            specs.times.assign(times.begin(), times.end());
+        }
+
+        std::mt19937 random(options.seed);
+        const double SUBFRAMES[] = {-0.25, 0.25};
+        queries.resize(options.queryCount);
+        for (Query& query : queries)
+        {
+            size_t iLayer = random() % layers.size();
+            const LayerSpecs& specs = specsPerLayer[iLayer];
+            size_t iPath = random() % specs.paths.size();
+            query.layer = layers[iLayer];
+            query.path = specs.paths[iPath];
+            if (!specs.times.empty())
+            {
+                query.time = specs.times[random() % specs.times.size()];
+                if (options.subframes && random() % 2 == 0)
+                {
+                    query.time += SUBFRAMES[random() % 2];
+                }
+            }
+            // time sample queries on attributes only, they make most of the queries of a render
+            if (query.path.IsPropertyPath() && random() % 4 != 0)
+            {
+                query.type = random() % 4 == 0 ? static_cast<QueryType::Value>(QueryType::TIME_SAMPLES_FOR_PATH + random() % 2) : QueryType::TIME_SAMPLE;
+            }
+            else if (!specs.fields[iPath].empty() && random() % 4 != 0)
+            {
+                query.type = QueryType::FIELD;
+                query.field = specs.fields[iPath][random() % specs.fields[iPath].size()];
+            }
+            else
+            {
+                query.type = QueryType::SPEC_TYPE;
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    void collectNoticeAttributes(const UsdStageRefPtr& stage, std::vector<std::pair<UsdAttribute, VtValue>>& noticeAttributes)
+    {
+        // the params of the Golaem prims: changing their opinions sends the notices handled by the layers
+        static const TfToken nodeTypeToken("__glmNodeType__");
+        static const TfToken formatIdToken("glmUsdFormat");
+        for (const UsdPrim& prim : stage->Traverse())
+        {
+            TfToken nodeType;
+            UsdAttribute nodeTypeAttribute = prim.GetAttribute(nodeTypeToken);
+            if (!nodeTypeAttribute || !nodeTypeAttribute.Get(&nodeType) || nodeType != formatIdToken)
+            {
+                continue;
+            }
+            for (const UsdAttribute& attribute : prim.GetAttributes())
+            {
+                // an opinion on an animated param would hide its time samples and change the results
+                VtValue value;
+                if (TfStringStartsWith(attribute.GetName().GetString(), "__glm") || attribute.GetNumTimeSamples() > 0 || !attribute.Get(&value))
+                {
+                    continue;
+                }
+                noticeAttributes.push_back(std::make_pair(attribute, value));
+            }
+        }
+    }
+} // namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    StressOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+    if (!options.pluginPath.empty())
+    {
+        PlugRegistry::GetInstance().RegisterPlugins(options.pluginPath);
+    }
+    PlugPluginPtr plugin = PlugRegistry::GetInstance().GetPluginWithName("glmUsdFormat");
+    if (!plugin)
+    {
+        fprintf(stderr, "The Golaem USD plugin was not found, set PXR_PLUGINPATH_NAME or --plugin-path\n");
+        return 1;
+    }
+
+    SdfLayerRefPtr glmusdLayer;
+    UsdStageRefPtr stage = openStage(options, glmusdLayer);
+    if (!stage)
+    {
+        fprintf(stderr, "Could not open the stage\n");
+        return 1;
+    }
+    std::vector<SdfLayerHandle> layers;
+    for (const SdfLayerHandle& layer : stage->GetUsedLayers())
+    {
+        if (layer->GetFileFormat()->GetFormatId() == TfToken("glmUsdFormat"))
+        {
+            layers.push_back(layer);
+        }
+    }
+    if (layers.empty())
+    {
+        fprintf(stderr, "The stage does not load any Golaem USD layer\n");
+        return 1;
+    }
+
+    // single threaded reference
+    std::vector<Query> queries;
+    generateQueries(layers, options, queries);
+    std::vector<QueryResult> references(queries.size());
+    auto referenceStartTime = std::chrono::steady_clock::now();
+    for (size_t iQuery = 0, queryCount = queries.size(); iQuery < queryCount; ++iQuery)
+    {
+        references[iQuery] = runQuery(queries[iQuery]);
+    }
+    double referenceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - referenceStartTime).count();
+
+    std::vector<std::pair<UsdAttribute, VtValue>> noticeAttributes;
+    if (options.noticeInterval > 0)
+    {
+        collectNoticeAttributes(stage, noticeAttributes);
+        if (noticeAttributes.empty())
+        {
+            fprintf(stderr, "No static param found on the Golaem prims, no notice will be sent\n");
+        }
+    }
+
+    QueryStats queryStats[QueryType::COUNT];
+    std::atomic<int> runningThreadCount(0);
+    auto queryThread = [&](unsigned threadIndex)
+    {
+        std::mt19937 random(options.seed + 1 + threadIndex);
+        for (int iCall = 0; iCall < options.callCount; ++iCall)
+        {
+            size_t iQuery = random() % queries.size();
+            const Query& query = queries[iQuery];
+            QueryResult result = runQuery(query);
+            QueryStats& stats = queryStats[query.type];
+            ++stats.count;
+            if (!(result == references[iQuery]) && stats.mismatches++ == 0)
+            {
+                fprintf(stderr, "%s mismatch on '%s' '%s' at %g\n", QUERY_TYPE_NAMES[query.type], query.path.GetText(), query.field.GetText(), query.time);
+            }
+        }
+        --runningThreadCount;
+    };
+
+    unsigned threadCount = options.threadCount > 0 ? static_cast<unsigned>(options.threadCount) : std::max(std::thread::hardware_concurrency(), 1u);
+    runningThreadCount = static_cast<int>(threadCount);
+    auto stressStartTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned iThread = 0; iThread < threadCount; ++iThread)
+    {
+        threads.emplace_back(queryThread, iThread);
+    }
+
+    // notices are sent from this thread while the queries run, by alternately setting and clearing the same values in the session layer
+    uint64_t noticeCount = 0;
+    if (!noticeAttributes.empty())
+    {
+        UsdEditContext editContext(stage, stage->GetSessionLayer());
+        while (runningThreadCount > 0)
+        {
+            std::pair<UsdAttribute, VtValue>& noticeAttribute = noticeAttributes[noticeCount / 2 % noticeAttributes.size()];
+            if (noticeCount % 2 == 0)
+            {
+                noticeAttribute.first.Set(noticeAttribute.second);
+            }
+            else
+            {
+                noticeAttribute.first.Clear();
+            }
+            ++noticeCount;
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.noticeInterval));
+        }
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    double stressSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stressStartTime).count();
+
+    printf("%zu layers, %zu queries, reference computed in %.3fs\n", layers.size(), queries.size(), referenceSeconds);
+    printf("%llu calls on %u threads in %.3fs, %llu notices\n", static_cast<unsigned long long>(threadCount) * options.callCount, threadCount, stressSeconds, static_cast<unsigned long long>(noticeCount));
+    printf("%-36s %12s %12s\n", "query", "count", "mismatches");
+    uint64_t mismatchCount = 0;
+    for (int iQueryType = 0; iQueryType < QueryType::COUNT; ++iQueryType)
+    {
+        const QueryStats& stats = queryStats[iQueryType];
+        printf("%-36s %12llu %12llu\n", QUERY_TYPE_NAMES[iQueryType], static_cast<unsigned long long>(stats.count), static_cast<unsigned long long>(stats.mismatches));
+        mismatchCount += stats.mismatches;
+    }
+    return mismatchCount > 0 ? 2 : 0;
+}
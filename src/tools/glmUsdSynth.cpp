@@ -0,0 +1,167 @@
+/***************************************************************************
+ *                                                                          *
+ *  Copyright (C) Golaem S.A.  All Rights Reserved.                         *
+ *                                                                          *
+ ***************************************************************************/
+
+// Writes a synthetic Golaem simulation cache, to run performance tests of the plugin without production caches.
+//
+// The cache is written with the devkit and is valid for the given characters. A usda stage loading the cache with
+// the plugin is written next to it, ready for glmUsdBench --stage.
+
+#include "glmUSD.h"
+#include "glmUSDSyntheticCache.h"
+
+USD_INCLUDES_START
+#include <pxr/pxr.h>
+#include <pxr/base/tf/stringUtils.h>
+USD_INCLUDES_END
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace PXR_INTERNAL_NS;
+using namespace glm::usdplugin;
+
+namespace
+{
+    //-----------------------------------------------------------------------------
+    void printUsage()
+    {
+        printf("Usage: glmUsdSynth -o outputDir -c character.gcha [options]\n"
+               "  -o, --output dir          output directory of the cache\n"
+               "  -n, --name name           cache name (default synthetic)\n"
+               "  -c, --characters files    semicolon separated Golaem characters, one entity type per character\n"
+               "  --crowd-fields count      number of crowd fields (default 1)\n"
+               "  -e, --entities count      number of entities per crowd field (default 100)\n"
+               "  -f, --frames start:end    frame range (default 1:100)\n"
+               "  --framerate fps           frame rate (default 24)\n"
+               "  --pp-floats count         number of float pp attributes (default 0)\n"
+               "  --pp-vectors count        number of vector pp attributes (default 0)\n"
+               "  --spacing distance        distance between the entities (default 2)\n"
+               "  --speed distance          distance walked by the entities per frame (default 1)\n"
+               "  --kill-ratio ratio        ratio of the entities killed at a random frame (default 0)\n"
+               "  --emit-ratio ratio        ratio of the entities emitted at a random frame (default 0)\n"
+               "  --seed seed               seed of the kill and emit frames (default 0)\n"
+               "  --no-stage                does not write the usda stage loading the cache\n");
+    }
+
+    //-----------------------------------------------------------------------------
+    bool parseArgs(int argc, char** argv, SyntheticCacheParams& params)
+    {
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            std::string arg = argv[iArg];
+            if (arg == "-h" || arg == "--help")
+            {
+                return false;
+            }
+            if (arg == "--no-stage")
+            {
+                params.writeStage = false;
+                continue;
+            }
+            if (iArg + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for argument '%s'\n", arg.c_str());
+                return false;
+            }
+            std::string value = argv[++iArg];
+            int startFrame = 0, endFrame = 0;
+            if (arg == "-o" || arg == "--output")
+            {
+                params.outputDir = value;
+            }
+            else if (arg == "-n" || arg == "--name")
+            {
+                params.cacheName = value;
+            }
+            else if (arg == "-c" || arg == "--characters")
+            {
+                params.characterFiles = TfStringSplit(value, ";");
+            }
+            else if (arg == "--crowd-fields")
+            {
+                params.crowdFieldCount = std::atoi(value.c_str());
+            }
+            else if (arg == "-e" || arg == "--entities")
+            {
+                params.entityCount = std::atoi(value.c_str());
+            }
+            else if ((arg == "-f" || arg == "--frames") && sscanf(value.c_str(), "%d:%d", &startFrame, &endFrame) == 2 && startFrame <= endFrame)
+            {
+                params.startFrame = startFrame;
+                params.frameCount = endFrame - startFrame + 1;
+            }
+            else if (arg == "--framerate")
+            {
+                params.framerate = static_cast<float>(std::atof(value.c_str()));
+            }
+            else if (arg == "--pp-floats")
+            {
+                params.ppFloatAttributeCount = std::atoi(value.c_str());
+            }
+            else if (arg == "--pp-vectors")
+            {
+                params.ppVectorAttributeCount = std::atoi(value.c_str());
+            }
+            else if (arg == "--spacing")
+            {
+                params.spacing = static_cast<float>(std::atof(value.c_str()));
+            }
+            else if (arg == "--speed")
+            {
+                params.speed = static_cast<float>(std::atof(value.c_str()));
+            }
+            else if (arg == "--kill-ratio")
+            {
+                params.killRatio = static_cast<float>(std::atof(value.c_str()));
+            }
+            else if (arg == "--emit-ratio")
+            {
+                params.emitRatio = static_cast<float>(std::atof(value.c_str()));
+            }
+            else if (arg == "--seed")
+            {
+                params.seed = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+            }
+            else
+            {
+                fprintf(stderr, "Invalid argument '%s %s'\n", arg.c_str(), value.c_str());
+                return false;
+            }
+        }
+        if (params.outputDir.empty() || params.characterFiles.empty())
+        {
+            fprintf(stderr, "Expected an output directory and characters\n");
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    SyntheticCacheParams params;
+    if (!parseArgs(argc, argv, params))
+    {
+        printUsage();
+        return 1;
+    }
+
+    glm::usdplugin::init();
+    std::string error;
+    bool success = writeSyntheticCache(params, error);
+    if (success)
+    {
+        printf("Wrote %d entities x %d crowd fields x %d frames to '%s'\n", params.entityCount, params.crowdFieldCount, params.frameCount, params.outputDir.c_str());
+    }
+    else
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+    }
+    glm::usdplugin::finish();
+    return success ? 0 : 1;
+}